@@ -89,6 +89,7 @@ operator<<(std::ostream& os, const ClassHint &ch)
 //! @brief Constructor for AutoProperties class
 AutoProperties::AutoProperties(ImageHandler *image_handler)
     : _image_handler(image_handler),
+      _hash(0),
       _extended(false),
       _harbour_sort(false),
       _apply_on_start(true)
@@ -110,13 +111,12 @@ AutoProperties::load(void)
         return false;
     }
 
-    // dealloc memory
-    unload();
-
     CfgParser a_cfg;
     if (! a_cfg.parse(cfg_file, CfgParserSource::SOURCE_FILE, false)) {
         cfg_file = SYSCONFDIR "/autoproperties";
         if (! a_cfg.parse (cfg_file, CfgParserSource::SOURCE_FILE, false)) {
+          unload();
+          _hash = 0;
           setDefaultTypeProperties();
           return false;
         }
@@ -131,6 +131,15 @@ AutoProperties::load(void)
         _cfg_files = a_cfg.getCfgFiles();
     }
 
+    auto hash = a_cfg.getEntryRoot()->getHash();
+    if (hash == _hash) {
+        return false;
+    }
+    _hash = hash;
+
+    // dealloc memory
+    unload();
+
     // reset values
     _apply_on_start = true;
 
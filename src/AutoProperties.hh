@@ -301,6 +301,8 @@ private:
     ImageHandler *_image_handler;
 
     TimeFiles _cfg_files;
+    /** Hash of the last loaded configuration. */
+    uint64_t _hash;
     bool _extended; /**< Extended syntax enabled for autoproperties? */
 
     std::map<AtomName, AutoProperty*> _window_type_prop_map;
@@ -6,12 +6,14 @@
 //
 
 #include "CfgParser.hh"
+#include "CfgParserCache.hh"
 #include "Debug.hh"
 #include "Compat.hh"
 #include "Util.hh"
 
 #include <algorithm>
 #include <cstring>
+#include <new>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -19,11 +21,19 @@
 #include <time.h>
 
 enum {
-    PARSE_BUF_SIZE = 1024
+    PARSE_BUF_SIZE = 1024,
+    /** Entries per arena block. */
+    CFG_PARSER_ARENA_BLOCK_ENTRIES = 256,
+    /** Sections with fewer entries are searched without an index. */
+    CFG_PARSER_INDEX_MIN_ENTRIES = 8
 };
 
 const std::string CfgParser::_root_source_name = std::string("");
 const char *CP_PARSE_BLANKS = " \t\n";
+/** Characters ending a span of name characters in parse. */
+static const CfgParserSource::Delims CP_PARSE_NAME_DELIMS("\n;{}=#/");
+/** Characters ending a span of value characters in parseValue. */
+static const CfgParserSource::Delims CP_PARSE_VALUE_DELIMS("\"\\");
 
 bool
 TimeFiles::requireReload(const std::string &file)
@@ -51,41 +61,53 @@ TimeFiles::requireReload(const std::string &file)
     return false;
 }
 
-//! @brief CfgParser::Entry constructor.
-CfgParser::Entry::Entry(const std::string &source_name, int line,
-                        const std::string &name, const std::string &value,
-                        CfgParser::Entry *section)
-    : _section(section),
-      _name(name), _value(value),
-      _line(line), _source_name(source_name)
+std::ostream&
+operator<<(std::ostream &os, const CfgParser::Stats &stats)
 {
+    os << "entries " << stats.entries
+       << " names " << stats.names
+       << " arena_bytes " << stats.arena_bytes
+       << " lookups " << stats.lookups
+       << " indexed_lookups " << stats.indexed_lookups
+       << " index_builds " << stats.index_builds;
+    return os;
 }
 
-/**
- * Copy Entry together with the content.
- */
-CfgParser::Entry::Entry(const CfgParser::Entry &entry)
-    : _section(0),
-      _name(entry._name), _value(entry._value),
-      _line(entry._line), _source_name(entry._source_name)
+CfgParser::iterator&
+CfgParser::iterator::operator++(void)
 {
-    for (auto it : entry._entries) {
-        _entries.push_back(new Entry(*it));
-    }
-    if (entry._section) {
-        _section = new Entry(*entry._section);
-    }
+    _entry = _entry->_next;
+    return *this;
 }
 
-//! @brief CfgParser::Entry destructor.
-CfgParser::Entry::~Entry(void)
+//! @brief CfgParser::Entry constructor.
+CfgParser::Entry::Entry(CfgParser::Arena *arena,
+                        const std::string *source_name, int line,
+                        const std::string *name, const std::string *key,
+                        const std::string &value, CfgParser::Entry *section)
+    : _arena(arena),
+      _section(section),
+      _name(name),
+      _key(key),
+      _value(value),
+      _line(line),
+      _source_name(source_name),
+      _first(nullptr),
+      _last(nullptr),
+      _next(nullptr),
+      _next_key(nullptr),
+      _size(0),
+      _index(nullptr)
 {
-    for_each(_entries.begin(), _entries.end(), Util::Free<CfgParser::Entry*>());
+}
 
-    if (_section) {
-        delete _section;
-        _section = 0;
-    }
+/**
+ * CfgParser::Entry destructor, only called by the Arena. Sub-sections
+ * and entries are released by the arena.
+ */
+CfgParser::Entry::~Entry(void)
+{
+    delete _index;
 }
 
 /**
@@ -114,12 +136,10 @@ CfgParser::Entry::addEntry(CfgParser::Entry *entry, bool overwrite)
         entry_search->_value = entry->getValue();
         entry_search->setSection(entry->getSection(), overwrite);
 
-        // Clear resources used by entry
-        entry->_section = 0;
-        delete entry;
+        // entry is left unused in the arena
         entry = entry_search;
     } else {
-        _entries.push_back(entry);
+        append(entry);
     }
 
     return entry;
@@ -131,7 +151,7 @@ CfgParser::Entry::addEntry(const std::string &source_name, int line,
                            const std::string &name, const std::string &value,
                            CfgParser::Entry *section, bool overwrite)
 {
-    return addEntry(new Entry(source_name, line, name, value, section),
+    return addEntry(_arena->newEntry(source_name, line, name, value, section),
                     overwrite);
 }
 
@@ -141,14 +161,8 @@ CfgParser::Entry::addEntry(const std::string &source_name, int line,
 CfgParser::Entry*
 CfgParser::Entry::setSection(CfgParser::Entry *section, bool overwrite)
 {
-    if (_section) {
-        if (overwrite) {
-            _section->copyTreeInto(section, overwrite);
-            delete section;
-        } else {
-            delete _section;
-            _section = section;
-        }
+    if (_section && overwrite) {
+        _section->copyTreeInto(section, overwrite);
     } else {
         _section = section;
     }
@@ -162,11 +176,24 @@ CfgParser::Entry*
 CfgParser::Entry::findEntry(const std::string &name, bool include_sections,
                             const char *value) const
 {
-    CfgParser::Entry *value_check;
-    for (auto it : _entries) {
-        value_check = include_sections ? it->getSection() : it;
+    _arena->getStats().lookups++;
+    auto key = _arena->findKey(name);
+    if (key == nullptr) {
+        return nullptr;
+    }
 
-        if (*it == name.c_str()
+    CfgParser::Entry *it;
+    auto index = getIndex();
+    if (index) {
+        auto index_it = index->find(key);
+        it = index_it == index->end() ? nullptr : index_it->second.first;
+    } else {
+        it = _first;
+    }
+
+    for (; it; it = index ? it->_next_key : it->_next) {
+        auto value_check = include_sections ? it->getSection() : it;
+        if (it->_key == key
             && (! it->getSection() || include_sections)
             && (! value || (value_check && value_check->getValue() == value))) {
             return it;
@@ -181,8 +208,23 @@ CfgParser::Entry::findEntry(const std::string &name, bool include_sections,
 CfgParser::Entry*
 CfgParser::Entry::findSection(const std::string &name, const char *value) const
 {
-    for (auto it : _entries) {
-        if (it->getSection() && *it == name.c_str()
+    _arena->getStats().lookups++;
+    auto key = _arena->findKey(name);
+    if (key == nullptr) {
+        return nullptr;
+    }
+
+    CfgParser::Entry *it;
+    auto index = getIndex();
+    if (index) {
+        auto index_it = index->find(key);
+        it = index_it == index->end() ? nullptr : index_it->second.first;
+    } else {
+        it = _first;
+    }
+
+    for (; it; it = index ? it->_next_key : it->_next) {
+        if (it->getSection() && it->_key == key
             && (! value || it->getSection()->getValue() == value)) {
             return it->getSection();
         }
@@ -191,6 +233,67 @@ CfgParser::Entry::findSection(const std::string &name, const char *value) const
     return 0;
 }
 
+/**
+ * Get index of entries in section, built on first use if the section
+ * has at least CFG_PARSER_INDEX_MIN_ENTRIES entries.
+ *
+ * @return Index or nullptr if the section is to small to be indexed.
+ */
+const CfgParser::Entry::Index*
+CfgParser::Entry::getIndex(void) const
+{
+    if (_index) {
+        _arena->getStats().indexed_lookups++;
+        return _index;
+    } else if (_size < CFG_PARSER_INDEX_MIN_ENTRIES) {
+        return nullptr;
+    }
+
+    _arena->getStats().index_builds++;
+    _index = new Index();
+    for (auto it = _first; it; it = it->_next) {
+        indexEntry(it);
+    }
+    _arena->getStats().indexed_lookups++;
+    return _index;
+}
+
+/**
+ * Append entry to the end of the section, updating the index if built.
+ */
+void
+CfgParser::Entry::append(CfgParser::Entry *entry)
+{
+    entry->_next = nullptr;
+    entry->_next_key = nullptr;
+    if (_last) {
+        _last->_next = entry;
+    } else {
+        _first = entry;
+    }
+    _last = entry;
+    _size++;
+
+    if (_index) {
+        indexEntry(entry);
+    }
+}
+
+/**
+ * Add entry, being the last entry in the section, to the index.
+ */
+void
+CfgParser::Entry::indexEntry(CfgParser::Entry *entry) const
+{
+    entry->_next_key = nullptr;
+    auto it = _index->find(entry->_key);
+    if (it == _index->end()) {
+        (*_index)[entry->_key] = std::make_pair(entry, entry);
+    } else {
+        it->second.second->_next_key = entry;
+        it->second.second = entry;
+    }
+}
 
 //! @brief Sets and validates data specified by key list.
 void
@@ -249,20 +352,67 @@ CfgParser::Entry::copyTreeInto(CfgParser::Entry *from, bool overwrite)
         if (_section) {
             _section->copyTreeInto(from->getSection(), overwrite);
         } else {
-            _section = new Entry(*(from->getSection()));
+            _section = _arena->copy(from->getSection());
         }
     }
 
     // Copy elements
-    CfgParser::iterator it(from->begin());
-    for (; it != from->end(); ++it) {
+    for (auto it = from->_first; it; it = it->_next) {
         CfgParser::Entry *entry_section = 0;
-        if ((*it)->getSection()) {
-            entry_section = new Entry(*((*it)->getSection()));
+        if (it->_section) {
+            entry_section = _arena->copy(it->_section);
         }
-        addEntry((*it)->getSourceName(), (*it)->getLine(), (*it)->getName(),
-                 (*it)->getValue(), entry_section, true);
+        addEntry(_arena->alloc(it->_source_name, it->_line, it->_name,
+                               it->_key, it->_value, entry_section),
+                 true);
+    }
+}
+
+/**
+ * FNV-1a hash of len bytes of data.
+ */
+static uint64_t
+hashBytes(uint64_t hash, const void *data, size_t len)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
     }
+    return hash;
+}
+
+/**
+ * Hash of str including its length, separating the end of one string
+ * from the start of the next.
+ */
+static uint64_t
+hashString(uint64_t hash, const std::string &str)
+{
+    uint64_t len = str.size();
+    hash = hashBytes(hash, str.data(), str.size());
+    return hashBytes(hash, &len, sizeof(len));
+}
+
+/**
+ * Hash of the name, value, sub-section and entries. Source and line
+ * numbers are not included, making the hash only change when the
+ * content does.
+ */
+uint64_t
+CfgParser::Entry::getHash(void) const
+{
+    uint64_t hash = hashString(14695981039346656037ULL, *_name);
+    hash = hashString(hash, _value);
+    if (_section) {
+        uint64_t section = _section->getHash();
+        hash = hashBytes(hash, &section, sizeof(section));
+    }
+    for (auto it = _first; it; it = it->_next) {
+        uint64_t entry = it->getHash();
+        hash = hashBytes(hash, &entry, sizeof(entry));
+    }
+    return hash;
 }
 
 //! @brief Operator <<, return info on source, line, name and value.
@@ -274,12 +424,191 @@ operator<<(std::ostream &stream, const CfgParser::Entry &entry)
     return stream;
 }
 
+CfgParser::Arena::Arena(void)
+    : _block_used(CFG_PARSER_ARENA_BLOCK_ENTRIES)
+{
+}
+
+CfgParser::Arena::~Arena(void)
+{
+    release();
+}
+
+/**
+ * Create new entry, name and source_name are interned.
+ */
+CfgParser::Entry*
+CfgParser::Arena::newEntry(const std::string &source_name, int line,
+                           const std::string &name, const std::string &value,
+                           CfgParser::Entry *section)
+{
+    const std::string *key;
+    auto name_p = intern(name, &key);
+    return alloc(intern(source_name), line, name_p, key, value, section);
+}
+
+/**
+ * Copy entry together with the content.
+ */
+CfgParser::Entry*
+CfgParser::Arena::copy(const CfgParser::Entry *entry)
+{
+    auto section = entry->_section ? copy(entry->_section) : nullptr;
+    auto entry_copy = alloc(entry->_source_name, entry->_line, entry->_name,
+                            entry->_key, entry->_value, section);
+    for (auto it = entry->_first; it; it = it->_next) {
+        entry_copy->append(copy(it));
+    }
+    return entry_copy;
+}
+
+/**
+ * Find interned upper case name for name.
+ *
+ * @return Interned name or nullptr if no entry has the name.
+ */
+const std::string*
+CfgParser::Arena::findKey(const std::string &name) const
+{
+    auto it = _names.find(name);
+    if (it != _names.end()) {
+        return it->second;
+    }
+
+    std::string key(name);
+    Util::to_upper(key);
+    it = _names.find(key);
+    return it == _names.end() ? nullptr : it->second;
+}
+
+/**
+ * Release all entries and interned names.
+ */
+void
+CfgParser::Arena::release(void)
+{
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        uint used = i + 1 == _blocks.size()
+            ? _block_used : CFG_PARSER_ARENA_BLOCK_ENTRIES;
+        for (uint j = 0; j < used; j++) {
+            _blocks[i][j].~Entry();
+        }
+        ::operator delete(_blocks[i]);
+    }
+    _blocks.clear();
+    _block_used = CFG_PARSER_ARENA_BLOCK_ENTRIES;
+    _names.clear();
+
+    _stats.entries = 0;
+    _stats.names = 0;
+    _stats.arena_bytes = 0;
+}
+
+/**
+ * Allocate entry in the current block, starting a new block if full.
+ */
+CfgParser::Entry*
+CfgParser::Arena::alloc(const std::string *source_name, int line,
+                        const std::string *name, const std::string *key,
+                        const std::string &value, CfgParser::Entry *section)
+{
+    if (_block_used == CFG_PARSER_ARENA_BLOCK_ENTRIES) {
+        size_t size = sizeof(CfgParser::Entry) * CFG_PARSER_ARENA_BLOCK_ENTRIES;
+        _blocks.push_back(static_cast<CfgParser::Entry*>(
+                              ::operator new(size)));
+        _block_used = 0;
+        _stats.arena_bytes += size;
+    }
+    _stats.entries++;
+    auto entry = _blocks.back() + _block_used++;
+    return new(entry) CfgParser::Entry(this, source_name, line, name, key,
+                                       value, section);
+}
+
+/**
+ * Intern name, setting key to the interned upper case version of the
+ * name if not null.
+ */
+const std::string*
+CfgParser::Arena::intern(const std::string &name, const std::string **key)
+{
+    auto it = _names.find(name);
+    if (it == _names.end()) {
+        std::string upper(name);
+        Util::to_upper(upper);
+
+        auto key_it = _names.find(upper);
+        if (key_it == _names.end()) {
+            key_it = _names.insert(std::make_pair(upper, nullptr)).first;
+            key_it->second = &key_it->first;
+            _stats.names++;
+        }
+        if (upper == name) {
+            it = key_it;
+        } else {
+            it = _names.insert(std::make_pair(name, key_it->second)).first;
+            _stats.names++;
+        }
+    }
+
+    if (key) {
+        *key = it->second;
+    }
+    return &it->first;
+}
+
+/**
+ * Read modification time and size of file, exists is set to false if
+ * the file can not be found.
+ */
+bool
+CfgParser::Deps::File::read(void)
+{
+    struct stat stat_buf;
+    exists = stat(path.c_str(), &stat_buf) == 0;
+    mtime = exists ? stat_buf.st_mtime : 0;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = exists ? stat_buf.st_mtim.tv_nsec : 0;
+#else // ! HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = 0;
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+    size = exists ? stat_buf.st_size : 0;
+    return exists;
+}
+
+void
+CfgParser::Deps::clear(void)
+{
+    vars.clear();
+    files.clear();
+    env.clear();
+    env_defined.clear();
+}
+
+/**
+ * Add environment variable expanded while parsing, variables defined
+ * by the parsed files and already added variables are ignored.
+ */
+void
+CfgParser::Deps::addEnv(const std::string &name, const char *value)
+{
+    if (env_defined.count(name)) {
+        return;
+    }
+    for (auto &it : env) {
+        if (it.name == name) {
+            return;
+        }
+    }
+    env.push_back(Env(name, value));
+}
+
 //! @brief CfgParser constructor.
 CfgParser::CfgParser(void)
     : _source(0), _root_entry(0), _is_dynamic_content(false),
       _section(_root_entry), _overwrite(false)
 {
-    _root_entry = new CfgParser::Entry(_root_source_name, 0, "ROOT", "");
+    _root_entry = _arena.newEntry(_root_source_name, 0, "ROOT", "");
     _section = _root_entry;
 }
 
@@ -300,10 +629,11 @@ void
 CfgParser::clear(bool realloc)
 {
     _source = 0;
-    delete _root_entry;
+    _section_map.clear();
+    _arena.release();
 
     if (realloc) {
-        _root_entry = new CfgParser::Entry(_root_source_name, 0, "ROOT", "");
+        _root_entry = _arena.newEntry(_root_source_name, 0, "ROOT", "");
     } else {
         _root_entry = 0;
     }
@@ -317,12 +647,7 @@ CfgParser::clear(bool realloc)
     _source_name_set.clear();
     _sections.clear();
     _var_map.clear();
-
-    // Remove sections
-    for (auto it : _section_map) {
-        delete it.second;
-    }
-    _section_map.clear();
+    _commands.clear();
 }
 
 /**
@@ -339,16 +664,31 @@ CfgParser::parse(const std::string &src, CfgParserSource::Type type,
     // Set overwrite
     _overwrite = overwrite;
 
-    // Init parse buffer and reserve memory.
-    std::string buf, value;
-    buf.reserve(PARSE_BUF_SIZE);
+    // Files parsed into an empty parser can be loaded from, and stored
+    // in, the cache.
+    bool use_cache = type == CfgParserSource::SOURCE_FILE && isEmpty();
+    if (use_cache) {
+        _deps.clear();
+        _deps.vars = _var_map;
+        if (CfgParserCache::load(*this, src, overwrite)) {
+            return true;
+        }
+    }
 
     // Open initial source.
     parseSourceNew(src, type);
     if (_sources.size() == 0) {
         return false;
     }
-    return parse();
+    bool success = parse();
+
+    // Only refresh compiled trees, compiling is requested with
+    // pekwm_cfg.
+    if (use_cache && success && ! _is_dynamic_content
+        && CfgParserCache::exists(src, overwrite)) {
+        CfgParserCache::save(*this, src, overwrite);
+    }
+    return success;
 }
 
 /**
@@ -370,6 +710,16 @@ CfgParser::parse(CfgParserSource* source, bool overwrite)
 }
 
 
+/**
+ * Return true if nothing has been parsed since construction or clear.
+ */
+bool
+CfgParser::isEmpty(void) const
+{
+    return _root_entry && _root_entry->begin() == _root_entry->end()
+        && _sections.empty() && _section_map.empty();
+}
+
 bool
 CfgParser::parse()
 {
@@ -425,7 +775,7 @@ CfgParser::parse()
                 break;
             case '=':
                 value.clear();
-                have_value = parseValue(value);
+                have_value = parseValue(_source, value);
                 break;
             case '#':
                 parseCommentLine(_source);
@@ -443,6 +793,7 @@ CfgParser::parse()
                 break;
             default:
                 buf += c;
+                _source->getUntil(CP_PARSE_NAME_DELIMS, &buf);
                 break;
             }
         }
@@ -452,19 +803,23 @@ CfgParser::parse()
         } catch (std::string &ex) {
             LOG("Exception: " << ex);
         }
-        delete _source;
+        auto source = _source;
         _sources.pop_back();
         _source_names.pop_back();
 
         // done inside of the loop to ensure COMMAND and INCLUDE
         // statements without a new line at the end of the file will
-        // be used.
+        // be used. The source is deleted after finishing the entry
+        // as the entry refers to it.
         if (buf.size()) {
             parseEntryFinish(buf, value, have_value);
         }
-
+        delete source;
     }
 
+    // Commands started but never reached.
+    _commands.clear();
+
     return true;
 }
 
@@ -486,6 +841,9 @@ CfgParser::parseSourceNew(const std::string &name_orig,
             time_t time;
             // Add source to file list if file
             if (type == CfgParserSource::SOURCE_FILE) {
+                commandsStart(static_cast<CfgParserSourceFile*>(source));
+                _deps.files.push_back(Deps::File(name));
+                _deps.files.back().read();
                 time = Util::getMtime(name);
                 _cfg_files.files.push_back(name);
                 if (_cfg_files.mtime < time) {
@@ -499,6 +857,10 @@ CfgParser::parseSourceNew(const std::string &name_orig,
 
         } catch (std::string &ex) {
             delete source;
+            if (type == CfgParserSource::SOURCE_FILE) {
+                // a file appearing later changes the result
+                _deps.files.push_back(Deps::File(name));
+            }
             // Previously added in source_new
             _source_names.pop_back();
 
@@ -519,6 +881,105 @@ CfgParser::parseSourceNew(const std::string &name_orig,
     } while (! done++ && (type == CfgParserSource::SOURCE_FILE));
 }
 
+/**
+ * Creates command source with output from an already started command.
+ */
+void
+CfgParser::parseSourceOutput(const std::string &name, std::string &output)
+{
+    auto source = static_cast<CfgParserSourceCommand*>(
+        sourceNew(name, CfgParserSource::SOURCE_COMMAND));
+    source->setOutput(output);
+    source->open();
+
+    _source = source;
+    _sources.push_back(_source);
+}
+
+/**
+ * Scan file for COMMAND entries and start the commands, the output is
+ * collected while parsing and taken when the entry is reached. Only
+ * commands with input final when the file is opened are started,
+ * commands using variables defined in the file or following an
+ * environment variable definition or INCLUDE are left to run when
+ * reached.
+ */
+void
+CfgParser::commandsStart(CfgParserSourceFile *file)
+{
+    const std::string &data = file->getData();
+    if (data.find("COMMAND") == std::string::npos) {
+        return;
+    }
+
+    std::set<std::string> defined;
+    bool is_final = true;
+    auto finish = [&](std::string &buf, std::string &value, bool &have_value) {
+        if (have_value && is_final && buf.size() && parseName(buf)) {
+            if (buf == "INCLUDE" || (buf.size() > 2 && buf[0] == '$'
+                                     && buf[1] == '_')) {
+                is_final = false;
+            } else if (buf[0] == '$') {
+                defined.insert(buf);
+            } else if (buf == "COMMAND" && variableIsKnown(value, defined)) {
+                std::string command(value);
+                variableExpand(command);
+                _commands.start(value, command);
+            }
+        }
+        buf.clear();
+        value.clear();
+        have_value = false;
+    };
+
+    CfgParserSourceString source(file->getName(), data);
+    bool have_value = false;
+    std::string buf, value;
+    int c, next;
+    while (is_final && (c = source.getc()) != EOF) {
+        switch (c) {
+        case '\n':
+            next = parseSkipBlank(&source);
+            if (next != '{') {
+                finish(buf, value, have_value);
+            }
+            break;
+        case ';':
+        case '}':
+            finish(buf, value, have_value);
+            break;
+        case '{':
+            buf.clear();
+            value.clear();
+            have_value = false;
+            break;
+        case '=':
+            value.clear();
+            have_value = parseValue(&source, value);
+            break;
+        case '#':
+            parseCommentLine(&source);
+            break;
+        case '/':
+            next = source.getc();
+            if (next == '/') {
+                parseCommentLine(&source);
+            } else if (next == '*') {
+                parseCommentC(&source);
+            } else {
+                buf += c;
+                source.ungetc(next);
+            }
+            break;
+        default:
+            buf += c;
+            source.getUntil(CP_PARSE_NAME_DELIMS, &buf);
+            break;
+        }
+    }
+    finish(buf, value, have_value);
+}
+
 //! @brief Parses from beginning to first blank.
 bool
 CfgParser::parseName(std::string &buf)
@@ -549,33 +1010,33 @@ CfgParser::parseName(std::string &buf)
 }
 
 /**
- * Parse _source after = to end of " pair.
+ * Parse source after = to end of " pair.
  */
 bool
-CfgParser::parseValue(std::string &value)
+CfgParser::parseValue(CfgParserSource *source, std::string &value)
 {
     // Expect to get a " after the =, ignore anything else.
-    int c;
-    while ((c = _source->getc()) != EOF && c != '"') {
-         ;
-    }
+    int c = source->getUntil('"', nullptr);
 
     // Check if EOF before getting a quotation mark.
     if (c == EOF) {
         USER_WARN("Reached EOF before opening \" in value.");
         return false;
     }
+    source->getc();
 
     // Parse until next ", and escape characters after \.
-    while ((c = _source->getc()) != EOF && c != '"') {
+    while ((c = source->getUntil(CP_PARSE_VALUE_DELIMS, &value)) != EOF) {
+        source->getc();
+        if (c == '"') {
+            break;
+        }
+
         // Escape character after \, if newline drop it.
-        if (c == '\\') {
-            c = _source->getc();
-            if (c == '\n' || c == EOF) {
-                continue;
-            }
+        c = source->getc();
+        if (c != '\n' && c != EOF) {
+            value += c;
         }
-        value += c;
     }
 
     LOG_IF(c == EOF, "Reached EOF before closing \" in value.");
@@ -610,9 +1071,18 @@ CfgParser::parseEntryFinishStandard(std::string &buf, std::string &value,
         if (buf[0] == '$') {
             variableDefine(buf, value);
         } else  {
+            std::string command, output;
+            bool started = buf == "COMMAND"
+                && _commands.take(value, command, output);
             variableExpand(value);
 
-            if (buf == "INCLUDE")  {
+            if (started) {
+                if (command != value) {
+                    USER_WARN("COMMAND input changed after start, using "
+                              "output of: " << command);
+                }
+                parseSourceOutput(command, output);
+            } else if (buf == "INCLUDE")  {
                 parseSourceNew(value, CfgParserSource::SOURCE_FILE);
             } else if (buf == "COMMAND") {
                 parseSourceNew(value, CfgParserSource::SOURCE_COMMAND);
@@ -653,17 +1123,14 @@ CfgParser::parseSectionFinish(std::string &buf, std::string &value)
     Entry *section = 0;
     if (buf.size() == 6 && strcasecmp(buf.c_str(), "DEFINE") == 0) {
         // Look for define section, started with Define = "Name" {
-        auto it(_section_map.find(value));
-        if (it != _section_map.end()) {
-            delete it->second;
-            _section_map.erase(it);
-        }
-
-        section = new Entry(_source->getName(), _source->getLine(), buf, value);
+        // redefined sections are left unused in the arena
+        section = _arena.newEntry(_source->getName(), _source->getLine(),
+                                  buf, value);
         _section_map[value] = section;
     } else {
         // Create Entry for sub-section.
-        section = new Entry(_source->getName(), _source->getLine(), buf, value);
+        section = _arena.newEntry(_source->getName(), _source->getLine(),
+                                  buf, value);
 
         // Add parent section, get section from parent section as it
         // can be different from the newly created if it is not
@@ -682,14 +1149,8 @@ CfgParser::parseSectionFinish(std::string &buf, std::string &value)
 void
 CfgParser::parseCommentLine(CfgParserSource *source)
 {
-    int c;
-    while (((c = source->getc()) != EOF) && (c != '\n'))
-        ;
-
-    // Give back the newline, needed for flushing value before comment
-    if (c == '\n') {
-        source->ungetc(c);
-    }
+    // Leave the newline, needed for flushing value before comment
+    source->getUntil('\n', nullptr);
 }
 
 //! @brief Parses Source until */ is found.
@@ -697,13 +1158,12 @@ void
 CfgParser::parseCommentC(CfgParserSource *source)
 {
     int c;
-    while ((c = source->getc()) != EOF) {
-        if (c == '*') {
-            if ((c = source->getc()) == '/') {
-                break;
-            } else if (c != EOF) {
-                source->ungetc(c);
-            }
+    while ((c = source->getUntil('*', nullptr)) != EOF) {
+        source->getc();
+        if ((c = source->getc()) == '/') {
+            break;
+        } else if (c != EOF) {
+            source->ungetc(c);
         }
     }
 
@@ -754,10 +1214,50 @@ CfgParser::variableDefine(const std::string &name, const std::string &value)
 
     // If the variable begins with $_ it should update the environment aswell.
     if ((name.size() > 2) && (name[1] == '_')) {
+        _deps.env_defined.insert(name.substr(2));
         setenv(name.c_str() + 2, value.c_str(), 1);
     }
 }
 
+/**
+ * Return true if all variables in var are defined and not in the
+ * redefined set.
+ */
+bool
+CfgParser::variableIsKnown(const std::string &var,
+                           const std::set<std::string> &redefined) const
+{
+    std::string::size_type begin = 0, end = 0;
+    while ((begin = var.find_first_of('$', end)) != std::string::npos) {
+        end = begin + 1;
+        if ((begin > 0) && (var[begin - 1] == '\\')) {
+            continue;
+        }
+        for (; end != var.size(); ++end) {
+            if ((isalnum(var[end]) == 0) && (var[end] != '_'))  {
+                break;
+            }
+        }
+
+        std::string var_name(var.substr(begin, end - begin));
+        if (redefined.count(var_name)) {
+            return false;
+        }
+        if (var_name.size() > 2 && var_name[1] == '_') {
+            if (! getenv(var_name.c_str() + 2)) {
+                return false;
+            }
+        } else {
+            auto it(_var_map.find(var_name));
+            if (it == _var_map.end()
+                || ! variableIsKnown(it->second, redefined)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 //! @brief Expands all $ variables in a string.
 void
 CfgParser::variableExpand(std::string &var)
@@ -800,6 +1300,7 @@ CfgParser::variableExpandName(std::string &var,
     // variable, use getenv to see if it is available
     if (var_name.size() > 2 && var_name[1] == '_') {
         char *value = getenv(var_name.c_str() + 2);
+        _deps.addEnv(var_name.substr(2), value);
         if (value) {
             var.replace(begin, end - begin, value);
             end = begin + strlen(value);
@@ -25,13 +25,18 @@
 
 #include "CfgParserKey.hh"
 #include "CfgParserSource.hh"
+#include "Types.hh"
 
 #include <vector>
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <cstdlib>
 
 //! @brief Helper class
@@ -49,30 +54,81 @@ public:
 //! @brief Configuration file parser.
 class CfgParser {
 public:
-    //! @brief Entry in parsed data structure.
-    class Entry {
+    class Arena;
+    class Entry;
+
+    /** Parse tree statistics, reported by pekwm_cfg. */
+    class Stats {
     public:
-        Entry(const std::string &source_name, int line,
-              const std::string &name, const std::string &value,
-              CfgParser::Entry *section=0);
-        Entry(const Entry &entry);
-        ~Entry(void);
+        Stats(void)
+            : entries(0),
+              names(0),
+              arena_bytes(0),
+              lookups(0),
+              indexed_lookups(0),
+              index_builds(0)
+        {
+        }
 
-        std::vector<CfgParser::Entry*>::const_iterator begin(void) {
-            return _entries.begin();
+        /** Entries allocated in the arena. */
+        ulong entries;
+        /** Interned names. */
+        ulong names;
+        /** Bytes allocated by the arena. */
+        ulong arena_bytes;
+        /** Calls to findEntry and findSection. */
+        ulong lookups;
+        /** Lookups answered using a section index. */
+        ulong indexed_lookups;
+        /** Section indexes built. */
+        ulong index_builds;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
+    /** Iterator over the entries in a section. */
+    class iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Entry* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Entry* const* pointer;
+        typedef Entry* const& reference;
+
+        iterator(Entry *entry) : _entry(entry) { }
+
+        Entry* const& operator*(void) const { return _entry; }
+        iterator &operator++(void);
+        iterator operator++(int) {
+            iterator it(*this);
+            ++(*this);
+            return it;
+        }
+        bool operator==(const iterator &rhs) const {
+            return _entry == rhs._entry;
         }
-        std::vector<CfgParser::Entry*>::const_iterator end(void) {
-            return _entries.end();
+        bool operator!=(const iterator &rhs) const {
+            return _entry != rhs._entry;
         }
 
+    private:
+        Entry *_entry;
+    };
+
+    //! @brief Entry in parsed data structure.
+    class Entry {
+    public:
+        iterator begin(void) const { return iterator(_first); }
+        iterator end(void) const { return iterator(nullptr); }
+
         //! @brief Returns the name.
-        const std::string &getName(void) const { return _name; }
+        const std::string &getName(void) const { return *_name; }
         //! @brief Returns the value.
         const std::string &getValue(void) const { return _value; }
         //! @brief Returns the linenumber in the source this was parsed.
         int getLine(void) const { return _line; }
         //! @brief Returns the name of the source this was parsed.
-        const std::string &getSourceName(void) const { return _source_name; }
+        const std::string &getSourceName(void) const { return *_source_name; }
 
         Entry *addEntry(Entry *entry, bool overwrite=false);
         Entry *addEntry(const std::string &source_name, int line,
@@ -91,33 +147,164 @@ public:
 
         void print(uint level = 0);
         void copyTreeInto(CfgParser::Entry *from, bool overwrite=false);
+        uint64_t getHash(void) const;
 
         //! @brief Matches Entry name agains op_rhs.
         bool operator==(const char *rhs) {
-            return (strcasecmp(rhs, _name.c_str()) == 0);
+            return (strcasecmp(rhs, _name->c_str()) == 0);
         }
         friend std::ostream &operator<<(std::ostream &stream, const CfgParser::Entry &entry);
 
     private:
-        /** List of entries in section. */
-        std::vector<CfgParser::Entry*> _entries;
-        Entry *_section; /**< Sub-section of node. */
+        /** First and last entry in each chain of entries with the
+            same key. */
+        typedef std::unordered_map<const std::string*,
+                                   std::pair<Entry*, Entry*>> Index;
+
+        Entry(Arena *arena, const std::string *source_name, int line,
+              const std::string *name, const std::string *key,
+              const std::string &value, Entry *section);
+        Entry(const Entry &entry) = delete;
+        Entry &operator=(const Entry &entry) = delete;
+        ~Entry(void);
+
+        const Index *getIndex(void) const;
+        void indexEntry(Entry *entry) const;
+        void append(Entry *entry);
 
-        std::string _name; /**< Name of node. */
+        /** Arena the entry is allocated from. */
+        Arena *_arena;
+        /** Sub-section of node. */
+        Entry *_section;
+
+        /** Name of node, interned. */
+        const std::string *_name;
+        /** Upper case name of node, interned. */
+        const std::string *_key;
         std::string _value; /**< Value of node. */
 
         int _line;
-        std::string _source_name;
+        /** Name of source, interned. */
+        const std::string *_source_name;
+
+        /** First entry in section. */
+        Entry *_first;
+        /** Last entry in section. */
+        Entry *_last;
+        /** Next entry in parent section. */
+        Entry *_next;
+        /** Next entry in parent section with the same key, only
+            valid if the parent section has an index. */
+        Entry *_next_key;
+        /** Number of entries in section. */
+        uint _size;
+        /** Lazily built index of entries in section. */
+        mutable Index *_index;
+
+        friend class Arena;
+        friend class iterator;
     };
 
+    /**
+     * Storage for a parse tree. Entries are allocated in blocks and
+     * all of them are released at once, names are interned so entries
+     * with the same name share the string and lookups compare
+     * pointers instead of strings.
+     */
+    class Arena {
+    public:
+        Arena(void);
+        ~Arena(void);
+
+        Entry *newEntry(const std::string &source_name, int line,
+                        const std::string &name, const std::string &value,
+                        Entry *section = nullptr);
+        Entry *copy(const Entry *entry);
+        const std::string *findKey(const std::string &name) const;
+        void release(void);
+
+        Stats &getStats(void) { return _stats; }
+
+    private:
+        Arena(const Arena &arena) = delete;
+        Arena &operator=(const Arena &arena) = delete;
+
+        Entry *alloc(const std::string *source_name, int line,
+                     const std::string *name, const std::string *key,
+                     const std::string &value, Entry *section);
+        const std::string *intern(const std::string &name,
+                                  const std::string **key = nullptr);
+
+        /** Blocks of CFG_PARSER_ARENA_BLOCK_ENTRIES entries. */
+        std::vector<Entry*> _blocks;
+        /** Entries used in the last block. */
+        uint _block_used;
+        /** Interned names, mapped to the interned upper case name. */
+        std::unordered_map<std::string, const std::string*> _names;
 
-    typedef std::vector<CfgParser::Entry*>::const_iterator iterator;
+        Stats _stats;
+
+        friend class Entry;
+    };
+
+    /**
+     * Input, besides the text of the parsed files, that the parse
+     * result depends on. Used to validate compiled trees in the
+     * CfgParserCache.
+     */
+    class Deps {
+    public:
+        /** File read, or tried, while parsing. */
+        class File {
+        public:
+            File(const std::string &path_)
+                : path(path_), exists(false), mtime(0), mtime_nsec(0),
+                  size(0) { }
+
+            std::string path;
+            bool exists;
+            time_t mtime;
+            /** Nanoseconds of mtime, 0 if not supported. */
+            long mtime_nsec;
+            off_t size;
+
+            bool read(void);
+        };
+
+        /** Environment variable expanded while parsing. */
+        class Env {
+        public:
+            Env(const std::string &name_, const char *value_)
+                : name(name_), set(value_ != nullptr),
+                  value(value_ ? value_ : "") { }
+
+            std::string name;
+            bool set;
+            std::string value;
+        };
+
+        void clear(void);
+        void addEnv(const std::string &name, const char *value);
+
+        /** Variables set before parsing started. */
+        std::map<std::string, std::string> vars;
+        std::vector<File> files;
+        std::vector<Env> env;
+        /** Environment variables defined while parsing, not
+            dependencies when expanded. */
+        std::set<std::string> env_defined;
+    };
 
     CfgParser(void);
     ~CfgParser(void);
 
     TimeFiles getCfgFiles(void) const { return _cfg_files; }
 
+    /** Returns input the last parse depends on. */
+    const Deps &getDeps(void) const { return _deps; }
+    /** Returns parse tree statistics. */
+    const Stats &getStats(void) { return _arena.getStats(); }
+
     /** Returns the root Entry node. */
     Entry *getEntryRoot(void) { return _root_entry; }
     /** Return true if data parsed included dynamic content such as
@@ -139,10 +326,12 @@ public:
     }
 
 private:
+    bool isEmpty(void) const;
     bool parse(void);
     void parseSourceNew(const std::string &name, CfgParserSource::Type type);
+    void parseSourceOutput(const std::string &name, std::string &output);
     bool parseName(std::string &buf);
-    bool parseValue(std::string &value);
+    bool parseValue(CfgParserSource *source, std::string &value);
     void parseEntryFinish(std::string &buf, std::string &value,
                           bool &have_value);
     void parseEntryFinishStandard(std::string &buf, std::string &value,
@@ -155,8 +344,11 @@ private:
 
     CfgParserSource *sourceNew(const std::string &name,
                                CfgParserSource::Type type);
+    void commandsStart(CfgParserSourceFile *file);
 
     void variableDefine(const std::string &name, const std::string &value);
+    bool variableIsKnown(const std::string &var,
+                         const std::set<std::string> &redefined) const;
     void variableExpand(std::string &var);
     bool variableExpandName(std::string &var,
                             std::string::size_type begin,
@@ -179,10 +371,18 @@ private:
         CfgParser objects. */
     std::set<std::string> _source_name_set;
     std::vector<Entry*> _sections; //!< for recursive parsing.
+    /** Commands started ahead of their COMMAND entry. */
+    CfgParserCommands _commands;
 
     /**  Map of Define = ... sections */
     std::map<std::string, CfgParser::Entry*> _section_map;
 
+    /** Input the parse depends on, reset when parsing a file into an
+        empty parser. */
+    Deps _deps;
+
+    /** Storage for all entries, including templates. */
+    Arena _arena;
     Entry *_root_entry; /**< Root Entry. */
     /** If true, parsed data included command or similar. */
     bool _is_dynamic_content;
@@ -190,4 +390,6 @@ private:
     bool _overwrite; /**< Overwrite elements when appending. */
 
     static const std::string _root_source_name; //!< Root Entry Source Name.
+
+    friend class CfgParserCache;
 };
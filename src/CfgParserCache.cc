@@ -0,0 +1,529 @@
+//
+// CfgParserCache.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "config.h"
+
+#include "CfgParserCache.hh"
+#include "Compat.hh"
+#include "Debug.hh"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+
+extern "C" {
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+/** Bump when the file layout changes, old files are ignored. */
+#define CFG_PARSER_CACHE_VERSION 2
+
+static const char CFG_PARSER_CACHE_MAGIC[8] =
+    {'P', 'E', 'K', 'W', 'M', 'C', 'F', 'G'};
+
+/**
+ * File header, followed by the tables in the order of the counts and
+ * the string data. All tables refer to strings using the index in the
+ * string table and to entries using the index in the entry table.
+ */
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t overwrite;
+    /** Parsed file. */
+    uint32_t path;
+    uint32_t num_strings;
+    uint32_t num_files;
+    uint32_t num_env;
+    /** Variables set before parsing. */
+    uint32_t num_vars;
+    /** Variables set after parsing. */
+    uint32_t num_vars_out;
+    uint32_t num_entries;
+    uint32_t strings_size;
+};
+
+struct CacheString {
+    uint32_t offset;
+    uint32_t len;
+};
+
+struct CacheFile {
+    uint32_t path;
+    uint32_t exists;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    int64_t size;
+};
+
+struct CacheEnv {
+    uint32_t name;
+    uint32_t set;
+    uint32_t value;
+    uint32_t reserved;
+};
+
+struct CacheVar {
+    uint32_t name;
+    uint32_t value;
+};
+
+/**
+ * Entry, entries are stored depth first so section, first and next
+ * always refer to a later entry. 0 is used for no entry as the first
+ * entry is the root entry.
+ */
+struct CacheEntry {
+    uint32_t source;
+    uint32_t name;
+    uint32_t value;
+    int32_t line;
+    uint32_t section;
+    uint32_t first;
+    uint32_t next;
+    uint32_t reserved;
+};
+
+/**
+ * Builds the tables of a compiled tree.
+ */
+class CacheWriter {
+public:
+    uint32_t addString(const std::string &str) {
+        auto it = _string_map.find(str);
+        if (it != _string_map.end()) {
+            return it->second;
+        }
+
+        CacheString cstr = {static_cast<uint32_t>(string_data.size()),
+                            static_cast<uint32_t>(str.size())};
+        string_data += str;
+        strings.push_back(cstr);
+        _string_map[str] = strings.size() - 1;
+        return strings.size() - 1;
+    }
+
+    uint32_t addEntry(CfgParser::Entry *entry) {
+        uint32_t idx = entries.size();
+        CacheEntry centry = {addString(entry->getSourceName()),
+                             addString(entry->getName()),
+                             addString(entry->getValue()),
+                             entry->getLine(), 0, 0, 0, 0};
+        entries.push_back(centry);
+
+        if (entry->getSection()) {
+            // entries may be reallocated by addEntry
+            uint32_t section = addEntry(entry->getSection());
+            entries[idx].section = section;
+        }
+
+        uint32_t prev = 0;
+        for (auto it : *entry) {
+            uint32_t child = addEntry(it);
+            if (prev) {
+                entries[prev].next = child;
+            } else {
+                entries[idx].first = child;
+            }
+            prev = child;
+        }
+        return idx;
+    }
+
+    void addVars(const std::map<std::string, std::string> &var_map,
+                 std::vector<CacheVar> &vars) {
+        for (auto &it : var_map) {
+            CacheVar var = {addString(it.first), addString(it.second)};
+            vars.push_back(var);
+        }
+    }
+
+    std::vector<CacheString> strings;
+    std::vector<CacheFile> files;
+    std::vector<CacheEnv> env;
+    std::vector<CacheVar> vars;
+    std::vector<CacheVar> vars_out;
+    std::vector<CacheEntry> entries;
+    std::string string_data;
+
+private:
+    std::unordered_map<std::string, uint32_t> _string_map;
+};
+
+/**
+ * Read only view of a mapped compiled tree, all offsets and
+ * references are validated before use.
+ */
+class CacheReader {
+public:
+    CacheReader(const char *data, size_t size)
+        : header(nullptr)
+    {
+        if (size < sizeof(CacheHeader)) {
+            return;
+        }
+
+        auto hdr = reinterpret_cast<const CacheHeader*>(data);
+        if (memcmp(hdr->magic, CFG_PARSER_CACHE_MAGIC, sizeof(hdr->magic))
+            || hdr->version != CFG_PARSER_CACHE_VERSION) {
+            return;
+        }
+
+        uint64_t offset = sizeof(CacheHeader);
+        strings = table<CacheString>(data, offset, hdr->num_strings);
+        files = table<CacheFile>(data, offset, hdr->num_files);
+        env = table<CacheEnv>(data, offset, hdr->num_env);
+        vars = table<CacheVar>(data, offset, hdr->num_vars);
+        vars_out = table<CacheVar>(data, offset, hdr->num_vars_out);
+        entries = table<CacheEntry>(data, offset, hdr->num_entries);
+        string_data = data + offset;
+        if (offset + hdr->strings_size != size) {
+            return;
+        }
+        header = hdr;
+        if (! validate()) {
+            header = nullptr;
+        }
+    }
+
+    bool isValid(void) const { return header != nullptr; }
+
+    std::string getString(uint32_t idx) const {
+        return std::string(string_data + strings[idx].offset,
+                           strings[idx].len);
+    }
+
+    const CacheHeader *header;
+    const CacheString *strings;
+    const CacheFile *files;
+    const CacheEnv *env;
+    const CacheVar *vars;
+    const CacheVar *vars_out;
+    const CacheEntry *entries;
+    const char *string_data;
+
+private:
+    template<typename T>
+    static const T *table(const char *data, uint64_t &offset, uint32_t num) {
+        auto ptr = reinterpret_cast<const T*>(data + offset);
+        offset += uint64_t(num) * sizeof(T);
+        return ptr;
+    }
+
+    bool isString(uint32_t idx) const {
+        return idx < header->num_strings;
+    }
+
+    bool isEntryAfter(uint32_t idx, uint32_t ref) const {
+        return ref == 0 || (ref > idx && ref < header->num_entries);
+    }
+
+    bool validate(void) const {
+        for (uint32_t i = 0; i < header->num_strings; i++) {
+            if (uint64_t(strings[i].offset) + strings[i].len
+                > header->strings_size) {
+                return false;
+            }
+        }
+        if (! isString(header->path) || header->num_entries == 0) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header->num_files; i++) {
+            if (! isString(files[i].path)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header->num_env; i++) {
+            if (! isString(env[i].name) || ! isString(env[i].value)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header->num_vars; i++) {
+            if (! isString(vars[i].name) || ! isString(vars[i].value)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header->num_vars_out; i++) {
+            if (! isString(vars_out[i].name)
+                || ! isString(vars_out[i].value)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header->num_entries; i++) {
+            auto &entry = entries[i];
+            if (! isString(entry.source) || ! isString(entry.name)
+                || ! isString(entry.value)
+                || ! isEntryAfter(i, entry.section)
+                || ! isEntryAfter(i, entry.first)
+                || ! isEntryAfter(i, entry.next)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+std::string CfgParserCache::_dir;
+
+/**
+ * Return true if a compiled tree, valid or not, exists for file.
+ */
+bool
+CfgParserCache::exists(const std::string &file, bool overwrite)
+{
+    if (! isEnabled()) {
+        return false;
+    }
+
+    struct stat stat_buf;
+    return stat(getEntryPath(file, overwrite).c_str(), &stat_buf) == 0;
+}
+
+/**
+ * Build entry from the compiled tree, section and entries are built
+ * before the entry itself is added.
+ */
+static CfgParser::Entry*
+buildEntry(CfgParser::Arena &arena, const CacheReader &reader,
+           const std::vector<std::string> &strings, uint32_t idx)
+{
+    auto &centry = reader.entries[idx];
+    CfgParser::Entry *section = nullptr;
+    if (centry.section) {
+        section = buildEntry(arena, reader, strings, centry.section);
+    }
+
+    auto entry = arena.newEntry(strings[centry.source], centry.line,
+                                strings[centry.name], strings[centry.value],
+                                section);
+    for (uint32_t child = centry.first; child;
+         child = reader.entries[child].next) {
+        entry->addEntry(buildEntry(arena, reader, strings, child));
+    }
+    return entry;
+}
+
+/**
+ * Load compiled tree for file into the empty parser cfg, if it exists
+ * and all input it depends on is unchanged.
+ *
+ * @return true if the tree was loaded.
+ */
+bool
+CfgParserCache::load(CfgParser &cfg, const std::string &file, bool overwrite)
+{
+    if (! isEnabled()) {
+        return false;
+    }
+
+    int fd = open(getEntryPath(file, overwrite).c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat stat_buf;
+    void *data = MAP_FAILED;
+    if (! fstat(fd, &stat_buf) && stat_buf.st_size > 0) {
+        data = mmap(nullptr, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // validate the tree and the input it depends on before touching cfg
+    CacheReader reader(static_cast<const char*>(data), stat_buf.st_size);
+    bool valid = reader.isValid()
+        && reader.header->overwrite == overwrite
+        && reader.getString(reader.header->path) == file
+        && reader.header->num_vars == cfg._var_map.size();
+
+    CfgParser::Deps deps;
+    for (uint32_t i = 0; valid && i < reader.header->num_vars; i++) {
+        auto it = cfg._var_map.find(reader.getString(reader.vars[i].name));
+        valid = it != cfg._var_map.end()
+            && it->second == reader.getString(reader.vars[i].value);
+    }
+    for (uint32_t i = 0; valid && i < reader.header->num_files; i++) {
+        auto &cfile = reader.files[i];
+        deps.files.push_back(CfgParser::Deps::File(
+                                 reader.getString(cfile.path)));
+        auto &dep = deps.files.back();
+        valid = dep.read() == bool(cfile.exists)
+            && (! dep.exists
+                || (dep.mtime == cfile.mtime
+                    && dep.mtime_nsec == cfile.mtime_nsec
+                    && dep.size == cfile.size));
+    }
+    for (uint32_t i = 0; valid && i < reader.header->num_env; i++) {
+        auto &cenv = reader.env[i];
+        auto name = reader.getString(cenv.name);
+        auto value = getenv(name.c_str());
+        valid = (value != nullptr) == bool(cenv.set)
+            && (! value || reader.getString(cenv.value) == value);
+        deps.env.push_back(CfgParser::Deps::Env(name, value));
+    }
+
+    if (valid) {
+        std::vector<std::string> strings;
+        strings.reserve(reader.header->num_strings);
+        for (uint32_t i = 0; i < reader.header->num_strings; i++) {
+            strings.push_back(reader.getString(i));
+        }
+
+        auto root = cfg.getEntryRoot();
+        for (uint32_t child = reader.entries[0].first; child;
+             child = reader.entries[child].next) {
+            root->addEntry(buildEntry(cfg._arena, reader, strings, child));
+        }
+
+        for (uint32_t i = 0; i < reader.header->num_vars_out; i++) {
+            auto &cvar = reader.vars_out[i];
+            auto &name = strings[cvar.name];
+            cfg._var_map[name] = strings[cvar.value];
+            if (name.size() > 2 && name[1] == '_') {
+                deps.env_defined.insert(name.substr(2));
+                setenv(name.c_str() + 2, strings[cvar.value].c_str(), 1);
+            }
+        }
+
+        for (auto &dep : deps.files) {
+            if (dep.exists) {
+                cfg._cfg_files.files.push_back(dep.path);
+                if (cfg._cfg_files.mtime < dep.mtime) {
+                    cfg._cfg_files.mtime = dep.mtime;
+                }
+            }
+        }
+
+        deps.vars = cfg._deps.vars;
+        cfg._deps = deps;
+    }
+
+    munmap(data, stat_buf.st_size);
+    DBG("compiled tree for " << file << (valid ? " loaded" : " stale"));
+    return valid;
+}
+
+/**
+ * Save the tree parsed from file into the, previously empty, parser
+ * cfg. The tree is written to a temporary file and renamed into place
+ * so a partially written tree is never loaded.
+ *
+ * @return true if the tree was saved.
+ */
+bool
+CfgParserCache::save(CfgParser &cfg, const std::string &file, bool overwrite)
+{
+    if (! isEnabled() || cfg.isDynamicContent()) {
+        return false;
+    }
+
+    CacheWriter writer;
+    auto &deps = cfg.getDeps();
+    for (auto &dep : deps.files) {
+        CacheFile cfile = {writer.addString(dep.path), dep.exists,
+                           dep.mtime, dep.mtime_nsec, dep.size};
+        writer.files.push_back(cfile);
+    }
+    for (auto &dep : deps.env) {
+        CacheEnv cenv = {writer.addString(dep.name), dep.set,
+                         writer.addString(dep.value), 0};
+        writer.env.push_back(cenv);
+    }
+    writer.addVars(deps.vars, writer.vars);
+    writer.addVars(cfg._var_map, writer.vars_out);
+    writer.addEntry(cfg.getEntryRoot());
+
+    CacheHeader header;
+    memcpy(header.magic, CFG_PARSER_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CFG_PARSER_CACHE_VERSION;
+    header.overwrite = overwrite;
+    header.path = writer.addString(file);
+    header.num_strings = writer.strings.size();
+    header.num_files = writer.files.size();
+    header.num_env = writer.env.size();
+    header.num_vars = writer.vars.size();
+    header.num_vars_out = writer.vars_out.size();
+    header.num_entries = writer.entries.size();
+    header.strings_size = writer.string_data.size();
+
+    std::ostringstream os;
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(writer.strings.data()),
+             writer.strings.size() * sizeof(CacheString));
+    os.write(reinterpret_cast<const char*>(writer.files.data()),
+             writer.files.size() * sizeof(CacheFile));
+    os.write(reinterpret_cast<const char*>(writer.env.data()),
+             writer.env.size() * sizeof(CacheEnv));
+    os.write(reinterpret_cast<const char*>(writer.vars.data()),
+             writer.vars.size() * sizeof(CacheVar));
+    os.write(reinterpret_cast<const char*>(writer.vars_out.data()),
+             writer.vars_out.size() * sizeof(CacheVar));
+    os.write(reinterpret_cast<const char*>(writer.entries.data()),
+             writer.entries.size() * sizeof(CacheEntry));
+    os << writer.string_data;
+    auto data = os.str();
+
+    auto path = getEntryPath(file, overwrite);
+    std::string tmp_path = path + ".XXXXXX";
+    int fd = mkstemp(&tmp_path[0]);
+    if (fd == -1) {
+        DBG("failed to create compiled tree " << tmp_path << ": "
+            << strerror(errno));
+        return false;
+    }
+
+    const char *p = data.c_str();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        }
+        p += n;
+        left -= n;
+    }
+
+    bool ok = close(fd) == 0 && left == 0;
+    if (! ok || rename(tmp_path.c_str(), path.c_str())) {
+        DBG("failed to write compiled tree " << path);
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Get path of compiled tree, the file name is hashed using 64-bit
+ * FNV-1a.
+ */
+std::string
+CfgParserCache::getEntryPath(const std::string &file, bool overwrite)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto c : file) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+
+    std::ostringstream os;
+    os << _dir << "/" << std::hex << std::setw(16) << std::setfill('0')
+       << hash << std::dec << (overwrite ? "-overwrite" : "-append");
+    return os.str();
+}
@@ -0,0 +1,43 @@
+//
+// CfgParserCache.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "CfgParser.hh"
+
+#include <string>
+
+/**
+ * Compiled parse trees stored on disk. A compiled tree holds the fully
+ * expanded entries of a file together with the variables defined and
+ * the input the result depends on: the modification time and size of
+ * all files read, files tried but missing, expanded environment
+ * variables and variables set before parsing.
+ *
+ * Trees are compiled with pekwm_cfg and refreshed by CfgParser when
+ * stale. Trees including COMMAND output are never stored. The cache is
+ * disabled until a directory is set.
+ */
+class CfgParserCache {
+public:
+    static bool isEnabled(void) { return ! _dir.empty(); }
+    static const std::string &getDir(void) { return _dir; }
+    static void setDir(const std::string &dir) { _dir = dir; }
+
+    static bool exists(const std::string &file, bool overwrite);
+    static bool load(CfgParser &cfg, const std::string &file, bool overwrite);
+    static bool save(CfgParser &cfg, const std::string &file, bool overwrite);
+
+private:
+    static std::string getEntryPath(const std::string &file, bool overwrite);
+
+    /** Cache directory, empty if disabled. */
+    static std::string _dir;
+};
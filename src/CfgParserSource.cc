@@ -7,90 +7,211 @@
 
 #include "Compat.hh"
 #include "CfgParserSource.hh"
+#include "Debug.hh"
 #include "Util.hh"
 
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include <cstdio>
 #include <cstdlib>
 
 extern "C" {
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <unistd.h>
 }
 
-unsigned int CfgParserSourceCommand::_sigaction_counter = 0;
+int CfgParserCommands::_timeout_ms = CFG_PARSER_COMMAND_TIMEOUT_MS;
+
+/** Number of running commands. */
+static unsigned int _sigaction_counter = 0;
+/** SIGCHLD action restored when no commands are running. */
+static struct sigaction _sigaction;
+
+/**
+ * Read characters up to, not including, delim appending them to buf
+ * if not null.
+ *
+ * @return delim, left unread, or EOF if the end of source was reached.
+ */
+int
+CfgParserSource::getUntil(char delim, std::string *buf)
+{
+    while (_pos != _end || fill()) {
+        auto end = static_cast<const char*>(memchr(_pos, delim, _end - _pos));
+        consume(end ? end : _end, buf);
+        if (end) {
+            return static_cast<unsigned char>(delim);
+        }
+    }
+    return EOF;
+}
+
+/**
+ * Read characters up to, not including, the first character in delims
+ * appending them to buf if not null.
+ *
+ * @return delimiter, left unread, or EOF if the end of source was
+ *         reached.
+ */
+int
+CfgParserSource::getUntil(const Delims &delims, std::string *buf)
+{
+    while (_pos != _end || fill()) {
+        auto end = _pos;
+        while (end != _end && ! delims[*end]) {
+            ++end;
+        }
+        consume(end, buf);
+        if (end != _end) {
+            return static_cast<unsigned char>(*end);
+        }
+    }
+    return EOF;
+}
+
+/**
+ * Move read position to end, counting lines and appending the skipped
+ * characters to buf if not null.
+ */
+void
+CfgParserSource::consume(const char *end, std::string *buf)
+{
+    _line += std::count(_pos, end, '\n');
+    if (buf) {
+        buf->append(_pos, end);
+    }
+    _pos = end;
+}
+
+/**
+ * Read next block from _fd.
+ */
+bool
+CfgParserSourceFd::fill(void)
+{
+    if (_fd == -1) {
+        return false;
+    }
+
+    ssize_t len;
+    do {
+        len = read(_fd, _block, sizeof(_block));
+    } while (len == -1 && errno == EINTR);
+
+    if (len <= 0) {
+        return false;
+    }
+    setBuffer(_block, _block + len);
+    return true;
+}
 
 /**
- * Open file based configuration source.
+ * Open file based configuration source, reading the whole file.
  */
 bool
 CfgParserSourceFile::open(void)
 {
-    if (_file) {
+    if (_is_open) {
         throw std::string("TRYING TO OPEN ALREADY OPEN SOURCE");
     }
 
-    _file = fopen(_name.c_str(), "r");
-    if (! _file) {
+    int fd = ::open(_name.c_str(), O_RDONLY);
+    if (fd == -1) {
         throw std::string("failed to open file " + _name);
     }
 
+    size_t size = 0;
+    ssize_t len;
+    do {
+        _data.resize(size + CFG_PARSER_SOURCE_BLOCK_SIZE);
+        len = read(fd, &_data[size], CFG_PARSER_SOURCE_BLOCK_SIZE);
+        if (len > 0) {
+            size += len;
+        }
+    } while (len > 0 || (len == -1 && errno == EINTR));
+    ::close(fd);
+
+    _data.resize(size);
+    setBuffer(_data.data(), _data.data() + _data.size());
+    _is_open = true;
+
     return true;
 }
 
 void
 CfgParserSourceFile::close(void)
 {
-    if (! _file) {
+    if (! _is_open) {
         throw std::string("trying to close already closed source");
     }
 
-    fclose(_file);
-    _file = 0;
+    _data.clear();
+    setBuffer(nullptr, nullptr);
+    _is_open = false;
 }
 
 bool
 CfgParserSourceString::open(void)
 {
-    _pos = _data.begin();
+    setBuffer(_data.data(), _data.data() + _data.size());
     return true;
 }
 
 void
 CfgParserSourceString::close(void)
 {
-    _pos = _data.end();
+    setBuffer(_data.data() + _data.size(), _data.data() + _data.size());
 }
 
-int
-CfgParserSourceString::getc(void)
+/**
+ * Run command and treat output as configuration source, using the
+ * output of an already started command if available.
+ */
+bool
+CfgParserSourceCommand::open(void)
 {
-    if (_pos == _data.end()) {
-        return EOF;
+    if (_is_started) {
+        setBuffer(_output.data(), _output.data() + _output.size());
+        return true;
     }
-    return CfgParserSource::getc(*_pos++);
+
+    _pid = spawn(_name, _fd);
+    return _pid != -1;
 }
 
+/**
+ * Close source, wait for child process to finish.
+ */
 void
-CfgParserSourceString::ungetc(int c)
+CfgParserSourceCommand::close(void)
 {
-    if (_pos != _data.begin()) {
-        CfgParserSource::ungetc(*_pos--);
+    if (_pid == -1) {
+        return;
     }
+
+    // Close source.
+    ::close(_fd);
+    _fd = -1;
+
+    wait(_pid);
+    _pid = -1;
 }
 
 /**
- * Run command and treat output as configuration source.
+ * Start command with output to a pipe, fd is set to the read end of
+ * the pipe.
+ *
+ * @return Process id of command, -1 on failure.
  */
-bool
-CfgParserSourceCommand::open(void)
+pid_t
+CfgParserSourceCommand::spawn(const std::string &command, int &fd)
 {
-    int fd[2];
-    int status;
-
-    status = pipe(fd);
-    if (status == -1) {
-        return false;
+    int fds[2];
+    if (pipe(fds) == -1) {
+        return -1;
     }
 
     // Remove signal handler while parsing as otherwise reading from the
@@ -105,17 +226,20 @@ CfgParserSourceCommand::open(void)
         sigaction(SIGCHLD, &action, &_sigaction);
     }
 
-    _pid = fork();
-    if (_pid == -1) { // Error
-        return false;
+    pid_t pid = fork();
+    if (pid == -1) { // Error
+        ::close(fds[0]);
+        ::close(fds[1]);
+        wait(pid);
+        return -1;
 
-    } else if (_pid == 0) { // Child
-        dup2(fd[1], STDOUT_FILENO);
+    } else if (pid == 0) { // Child
+        dup2(fds[1], STDOUT_FILENO);
 
-        ::close(fd[0]);
-        ::close(fd[1]);
+        ::close(fds[0]);
+        ::close(fds[1]);
 
-        execlp("/bin/sh", "sh", "-c", _name.c_str(), (char *) 0);
+        execlp("/bin/sh", "sh", "-c", command.c_str(), (char *) 0);
 
         // PRINT ERROR
 
@@ -125,40 +249,175 @@ CfgParserSourceCommand::open(void)
 
     } else { // Parent
 
-        ::close (fd[1]);
+        ::close (fds[1]);
 
-        _file = ::fdopen(fd[0], "r");
+        fd = fds[0];
     }
-    return true;
+    return pid;
 }
 
 /**
- * Close source, wait for child process to finish.
+ * Wait for command started with spawn to finish, restores the SIGCHLD
+ * action when no commands are running.
  */
 void
-CfgParserSourceCommand::close(void)
+CfgParserSourceCommand::wait(pid_t pid)
 {
-    if (_sigaction_counter < 1) {
-        return;
+    if (pid != -1) {
+        int pid_status;
+        while (waitpid(pid, &pid_status, 0) == -1 && errno == EINTR)
+            ;
     }
-    _sigaction_counter--;
 
-    // Close source.
-    fclose(_file);
+    // If no other command is running, restore sigaction.
+    if (--_sigaction_counter == 0) {
+        sigaction(SIGCHLD, &_sigaction, 0);
+    }
+}
 
-    // Wait for process.
-    int status;
-    int pid_status;
+/**
+ * Start command, output is collected when taken.
+ */
+bool
+CfgParserCommands::start(const std::string &key, const std::string &command)
+{
+    Command cmd;
+    cmd.key = key;
+    cmd.command = command;
+    cmd.pid = CfgParserSourceCommand::spawn(command, cmd.fd);
+    if (cmd.pid == -1) {
+        return false;
+    }
+    _commands.push_back(cmd);
+    return true;
+}
 
-    status = waitpid(_pid, &pid_status, 0);
+/**
+ * Wait for the first started command with key to finish and take its
+ * output. Commands still running after waiting _timeout_ms are
+ * killed, giving the output read so far.
+ *
+ * @param command Set to the command as started.
+ * @return true if command was started, else false.
+ */
+bool
+CfgParserCommands::take(const std::string &key, std::string &command,
+                        std::string &output)
+{
+    auto it = _commands.begin();
+    for (; it != _commands.end(); ++it) {
+        if (it->key == key) {
+            break;
+        }
+    }
+    if (it == _commands.end()) {
+        return false;
+    }
 
-    // If no other open CfgParserSourceCommand open, restore sigaction.
-    if (_sigaction_counter == 0) {
-        sigaction(SIGCHLD, &_sigaction, 0);
+    if (! collect(*it)) {
+        USER_WARN("COMMAND did not finish in " << _timeout_ms << "ms: "
+                  << it->command);
     }
+    command.swap(it->command);
+    output.swap(it->output);
+    finish(*it);
+    _commands.erase(it);
+    return true;
+}
 
-    // Wait failed, throw error
-    if (status == -1) {
-        auto msg = "failed to wait for pid " + std::to_string(_pid);
+/**
+ * Kill and wait for all commands not taken.
+ */
+void
+CfgParserCommands::clear(void)
+{
+    for (auto &it : _commands) {
+        finish(it);
+    }
+    _commands.clear();
+}
+
+/**
+ * Read output from all commands until all output from command is read
+ * or _timeout_ms has passed since waiting started. Output already available
+ * is always read, the timeout only applies to a command still running.
+ *
+ * @return true if all output was read, false on timeout.
+ */
+bool
+CfgParserCommands::collect(Command &command)
+{
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::milliseconds(_timeout_ms);
+
+    std::vector<struct pollfd> pfds;
+    std::vector<Command*> cmds;
+    while (command.fd != -1) {
+        auto now = std::chrono::steady_clock::now();
+        auto timeout = now < deadline
+            ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now).count() + 1
+            : 0;
+
+        pfds.clear();
+        cmds.clear();
+        for (auto &it : _commands) {
+            if (it.fd != -1) {
+                struct pollfd pfd = {it.fd, POLLIN, 0};
+                pfds.push_back(pfd);
+                cmds.push_back(&it);
+            }
+        }
+
+        int ret = poll(pfds.data(), pfds.size(), timeout);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        } else if (ret == 0 && timeout == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (pfds[i].revents) {
+                read(*cmds[i]);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Read available output from command, closes the pipe at end of
+ * output.
+ */
+void
+CfgParserCommands::read(Command &command)
+{
+    char buf[CFG_PARSER_SOURCE_BLOCK_SIZE];
+    ssize_t len;
+    do {
+        len = ::read(command.fd, buf, sizeof(buf));
+    } while (len == -1 && errno == EINTR);
+
+    if (len > 0) {
+        command.output.append(buf, len);
+    } else {
+        ::close(command.fd);
+        command.fd = -1;
+    }
+}
+
+/**
+ * Kill command if still running and wait for it.
+ */
+void
+CfgParserCommands::finish(Command &command)
+{
+    if (command.fd != -1) {
+        ::close(command.fd);
+        command.fd = -1;
+        kill(command.pid, SIGKILL);
     }
+    CfgParserSourceCommand::wait(command.pid);
 }
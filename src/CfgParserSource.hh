@@ -7,8 +7,16 @@
 
 #pragma once
 
+/** Size of blocks read by file and command sources. */
+#define CFG_PARSER_SOURCE_BLOCK_SIZE 65536
+/** Milliseconds to wait for the output of a started command. */
+#define CFG_PARSER_COMMAND_TIMEOUT_MS 30000
+
+#include <chrono>
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <cstring>
 
 extern "C" {
 #include <sys/types.h>
@@ -19,6 +27,10 @@ extern "C" {
 /**
  * Base class for configuration sources defining the interface and
  * common methods.
+ *
+ * Sources provide data in blocks through fill, characters are read
+ * from the current block without any virtual call and getUntil scans
+ * spans of the block in bulk.
  */
 class CfgParserSource
 {
@@ -33,6 +45,26 @@ public:
         SOURCE_VIRTUAL /**< Source base type. */
     };
 
+    /**
+     * Set of delimiter characters for getUntil.
+     */
+    class Delims {
+    public:
+        Delims(const char *chars) {
+            memset(_is_delim, 0, sizeof(_is_delim));
+            for (; *chars; chars++) {
+                _is_delim[static_cast<unsigned char>(*chars)] = true;
+            }
+        }
+
+        bool operator[](char c) const {
+            return _is_delim[static_cast<unsigned char>(c)];
+        }
+
+    private:
+        bool _is_delim[256];
+    };
+
     /**
      * CfgParserSource constructor, just set default values.
      */
@@ -40,7 +72,10 @@ public:
         : _name(source),
           _type(SOURCE_VIRTUAL),
           _line(0),
-          _is_dynamic(false)
+          _is_dynamic(false),
+          _begin(nullptr),
+          _pos(nullptr),
+          _end(nullptr)
     {
     }
     virtual ~CfgParserSource (void) { }
@@ -48,13 +83,35 @@ public:
     virtual bool open(void) = 0;
     virtual void close(void) = 0;
 
-    virtual int getc(void) = 0;
-    virtual void ungetc(int c) {
+    /**
+     * Get next character, increments line count if \n.
+     */
+    int getc(void) {
+        if (_pos == _end && ! fill()) {
+            return EOF;
+        }
+        int c = static_cast<unsigned char>(*_pos++);
         if (c == '\n') {
-            --_line;
+            ++_line;
+        }
+        return c;
+    }
+
+    /**
+     * Give back the character last returned by getc, decrements line
+     * count if \n.
+     */
+    void ungetc(int c) {
+        if (c != EOF && _pos != _begin) {
+            if (*--_pos == '\n') {
+                --_line;
+            }
         }
     }
 
+    int getUntil(char delim, std::string *buf);
+    int getUntil(const Delims &delims, std::string *buf);
+
     /**< Return name of source. */
     const std::string &getName(void) const { return _name; }
     /**< Return type of source. */
@@ -65,56 +122,70 @@ public:
     bool isDynamic(void) const { return _is_dynamic; }
 
 protected:
-    int getc(int c) {
-        if (c == '\n') {
-            ++_line;
-        }
-        return c;
+    /**
+     * Read next block of data into the buffer, returns false at end of
+     * source.
+     */
+    virtual bool fill(void) { return false; }
+
+    void setBuffer(const char *begin, const char *end) {
+        _begin = _pos = begin;
+        _end = end;
     }
 
+private:
+    void consume(const char *end, std::string *buf);
+
 protected:
     std::string _name; /**< Name of source. */
     CfgParserSource::Type _type; /**< Type of source. */
     uint _line; /**< Line number. */
     bool _is_dynamic; /**< Set to true if source has dynamic content. */
+
+private:
+    /** Start of current block. */
+    const char *_begin;
+    /** Next character to read in current block. */
+    const char *_pos;
+    /** End of current block. */
+    const char *_end;
 };
 
-class CfgParserSourceFp : public CfgParserSource
+/**
+ * File descriptor based configuration source, reads data in blocks of
+ * CFG_PARSER_SOURCE_BLOCK_SIZE bytes.
+ */
+class CfgParserSourceFd : public CfgParserSource
 {
 public:
-    CfgParserSourceFp(const std::string& source)
+    CfgParserSourceFd(const std::string& source)
         : CfgParserSource(source),
-          _file(nullptr)
+          _fd(-1)
     {
     }
 
-    /**
-     * Gets a character from _file, increments line count if \n.
-     */
-    virtual int getc(void) override {
-        return CfgParserSource::getc(std::fgetc(_file));
-    }
-
-    /**
-     * Returns a character to _op_file, decrements line count if \n.
-     */
-    virtual void ungetc(int c) override {
-        return CfgParserSource::ungetc(std::ungetc(c, _file));
-    }
+protected:
+    virtual bool fill(void) override;
 
 protected:
-    std::FILE *_file; /**< FILE object source is reading from. */
+    int _fd; /**< File descriptor source is reading from. */
+
+private:
+    /** Current block. */
+    char _block[CFG_PARSER_SOURCE_BLOCK_SIZE];
 };
 
 /**
  * File based configuration source, reads data from a plain file on
- * disk.
+ * disk. The whole file is read on open making the data available to
+ * scan before parsing.
  */
-class CfgParserSourceFile : public CfgParserSourceFp
+class CfgParserSourceFile : public CfgParserSource
 {
 public:
     CfgParserSourceFile(const std::string &source)
-        : CfgParserSourceFp(source)
+        : CfgParserSource(source),
+          _is_open(false)
     {
         _type = SOURCE_FILE;
     }
@@ -122,6 +193,13 @@ public:
 
     virtual bool open(void);
     virtual void close(void);
+
+    /** Return file content, valid when open. */
+    const std::string &getData(void) const { return _data; }
+
+private:
+    bool _is_open;
+    std::string _data;
 };
 
 /**
@@ -134,30 +212,77 @@ public:
         : CfgParserSource(source),
           _data(data)
     {
-        _pos = _data.begin();
+        setBuffer(_data.data(), _data.data() + _data.size());
     }
     virtual ~CfgParserSourceString(void) { }
 
     virtual bool open(void) override;
     virtual void close(void) override;
 
-    virtual int getc(void) override;
-    virtual void ungetc(int c) override;
-
 private:
     std::string _data;
-    std::string::iterator _pos;
+};
+
+/**
+ * Commands started before their COMMAND entry is parsed. Output of all
+ * running commands is collected concurrently while waiting for the
+ * output of a single command, making the time spent waiting on a set
+ * of commands the time of the slowest instead of the sum.
+ *
+ * Commands are identified by key, the unexpanded COMMAND value, and
+ * taken in the order they were started.
+ */
+class CfgParserCommands
+{
+public:
+    CfgParserCommands(void) { }
+    ~CfgParserCommands(void) { clear(); }
+
+    /** Return true if no commands are started. */
+    bool empty(void) const { return _commands.empty(); }
+
+    bool start(const std::string &key, const std::string &command);
+    bool take(const std::string &key, std::string &command,
+              std::string &output);
+    void clear(void);
+
+    static void setTimeout(int timeout_ms) { _timeout_ms = timeout_ms; }
+
+private:
+    CfgParserCommands(const CfgParserCommands&);
+    CfgParserCommands &operator=(const CfgParserCommands&);
+
+    class Command {
+    public:
+        std::string key;
+        std::string command;
+        pid_t pid;
+        /** Read end of output pipe, -1 when all output is read. */
+        int fd;
+        std::string output;
+    };
+
+    bool collect(Command &command);
+    void read(Command &command);
+    void finish(Command &command);
+
+    std::vector<Command> _commands;
+
+    /** Milliseconds to wait for a command when taken. */
+    static int _timeout_ms;
 };
 
 /**
  * Command based configuration source, executes a commands and parses
  * the output.
  */
-class CfgParserSourceCommand : public CfgParserSourceFp
+class CfgParserSourceCommand : public CfgParserSourceFd
 {
 public:
     CfgParserSourceCommand(const std::string &source)
-        : CfgParserSourceFp(source)
+        : CfgParserSourceFd(source),
+          _pid(-1),
+          _is_started(false)
     {
         _type = SOURCE_COMMAND;
         _is_dynamic = true;
@@ -167,8 +292,19 @@ public:
     virtual bool open(void);
     virtual void close(void);
 
+    /** Use output of already started command instead of running it. */
+    void setOutput(std::string &output) {
+        _output.swap(output);
+        _is_started = true;
+    }
+
+    static pid_t spawn(const std::string &command, int &fd);
+    static void wait(pid_t pid);
+
 private:
     pid_t _pid; /**< Process id of command generating output. */
-    struct sigaction _sigaction; /**< sigaction for restore. */
-    static unsigned int _sigaction_counter; /**< Counts open. */
+    /** Set to true if output is from an already started command. */
+    bool _is_started;
+    /** Output of started command. */
+    std::string _output;
 };
@@ -46,6 +46,17 @@ const long Client::_clientEventMask = \
     PropertyChangeMask|StructureNotifyMask|FocusChangeMask|KeyPressMask;
 std::vector<Client*> Client::_clients;
 std::vector<uint> Client::_clientids;
+std::unordered_map<uint, Client*> Client::_client_id_map;
+ManageStats Client::_manage_stats;
+
+/** Properties read when a client is constructed. */
+static const AtomName prefetch_atoms[] = {
+    WM_CLASS, WM_WINDOW_ROLE, WM_NAME, WM_HINTS, WM_PROTOCOLS, WM_STATE,
+    WM_CLIENT_MACHINE, NET_WM_NAME, NET_WM_DESKTOP, NET_WM_PID,
+    NET_WM_STRUT, NET_WM_ICON, WINDOW_TYPE, STATE, MOTIF_WM_HINTS,
+    PEKWM_FRAME_ID, PEKWM_FRAME_ORDER, PEKWM_FRAME_ACTIVE,
+    PEKWM_FRAME_DECOR, PEKWM_FRAME_SKIP, PEKWM_TITLE
+};
 
 Client::Client(Window new_client, ClientInitConfig &initConfig, bool is_new)
     : PWinObj(true),
@@ -66,6 +77,9 @@ Client::Client(Window new_client, ClientInitConfig &initConfig, bool is_new)
     _window = new_client;
     _type = WO_CLIENT;
 
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     // Construct the client
     X11::grabServer();
     if (! validate() || ! getAndUpdateWindowAttributes()) {
@@ -73,6 +87,15 @@ Client::Client(Window new_client, ClientInitConfig &initConfig, bool is_new)
         return;
     }
 
+    // read all properties used below in one round-trip, the server is
+    // grabbed so they can not change until it is released. When
+    // scanning windows at startup this has already been done.
+    if (! X11::isPrefetched(_window)) {
+        std::vector<Atom> atoms;
+        getPrefetchAtoms(atoms);
+        X11::prefetchProperties(_window, atoms);
+    }
+
     // Get unique Client id
     _id = findClientID();
     _title.setId(_id);
@@ -137,6 +160,7 @@ Client::Client(Window new_client, ClientInitConfig &initConfig, bool is_new)
     // Tell the world about our state
     updateEwmhStates();
 
+    X11::clearPrefetched(_window);
     X11::ungrabServer(true);
 
     setClientInitConfig(initConfig, is_new, ap);
@@ -149,8 +173,17 @@ Client::Client(Window new_client, ClientInitConfig &initConfig, bool is_new)
     woListAdd(this);
     _wo_map[_window] = this;
     _clients.push_back(this);
+    _client_id_map[_id] = this;
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ulong elapsed_us = Util::timeDiffUs(end, start);
+    _manage_stats.managed++;
+    _manage_stats.total_us += elapsed_us;
+    _manage_stats.max_us = std::max(_manage_stats.max_us, elapsed_us);
 
-    TRACE(this << " client constructed for window " << FMT_HEX(_window));
+    TRACE(this << " client constructed for window " << FMT_HEX(_window)
+          << " in " << elapsed_us << "us");
 }
 
 //! @brief Client destructor
@@ -164,6 +197,10 @@ Client::~Client(void)
     _wo_map.erase(_window);
     woListRemove(this);
     Util::vectorRemove(_clients, this);
+    auto it = _client_id_map.find(_id);
+    if (it != _client_id_map.end() && it->second == this) {
+        _client_id_map.erase(it);
+    }
     returnClientID(_id);
 
     X11::grabServer();
@@ -212,6 +249,20 @@ Client::~Client(void)
     TRACE(this << " client for window " << FMT_HEX(_window) << " destructed");
 }
 
+/**
+ * Get properties read when constructing a client, used to read them
+ * all in a single round-trip with X11::prefetchProperties.
+ */
+void
+Client::getPrefetchAtoms(std::vector<Atom> &atoms)
+{
+    atoms.push_back(XA_WM_NORMAL_HINTS);
+    atoms.push_back(XA_WM_TRANSIENT_FOR);
+    for (auto atom : prefetch_atoms) {
+        atoms.push_back(X11::getAtom(atom));
+    }
+}
+
 /**
  * Read basic window attributes including geometry and update the
  * window attributes being listened to. Returns false if the client
@@ -221,7 +272,7 @@ bool
 Client::getAndUpdateWindowAttributes(void)
 {
     XWindowAttributes attr;
-    if (! XGetWindowAttributes(X11::getDpy(), _window, &attr)) {
+    if (! X11::getWindowAttributes(_window, attr)) {
         return false;
     }
     _gm.x = attr.x;
@@ -666,13 +717,16 @@ Client::findClient(Window win)
         return 0;
     }
 
-    for (auto it : _clients) {
-        if (win == it->getWindow()
-            || (it->getParent() && (*(it->getParent()) == win))) {
-            return it;
-        }
+    // decoration windows are registered on the Frame, use the
+    // active client of the frame.
+    PWinObj *wo = findPWinObj(win);
+    if (wo == nullptr) {
+        return 0;
+    } else if (wo->getType() == WO_CLIENT) {
+        return static_cast<Client*>(wo);
+    } else if (wo->getType() == WO_FRAME) {
+        return static_cast<Frame*>(wo)->getActiveClient();
     }
-
     return 0;
 }
 
@@ -686,12 +740,10 @@ Client::findClientFromWindow(Window win)
         return 0;
     }
 
-    for (auto it : _clients) {
-        if (win == it->getWindow()) {
-            return it;
-        }
+    PWinObj *wo = findPWinObj(win);
+    if (wo && wo->getType() == WO_CLIENT) {
+        return static_cast<Client*>(wo);
     }
-
     return 0;
 }
 
@@ -716,13 +768,8 @@ Client::findClientFromHint(const ClassHint *class_hint)
 Client*
 Client::findClientFromID(uint id)
 {
-    for (auto it : _clients) {
-        if (it->getClientID() == id) {
-            return it;
-        }
-    }
-
-    return 0;
+    auto it = _client_id_map.find(id);
+    return it == _client_id_map.end() ? nullptr : it->second;
 }
 
 /**
@@ -768,9 +815,9 @@ Client::validate(void)
     X11::sync(False);
 
     XEvent ev;
-    if (XCheckTypedWindowEvent(X11::getDpy(), _window, DestroyNotify, &ev)
-        || XCheckTypedWindowEvent(X11::getDpy(), _window, UnmapNotify, &ev)) {
-        XPutBackEvent(X11::getDpy(), &ev);
+    if (X11::checkTypedWindowEvent(_window, DestroyNotify, &ev)
+        || X11::checkTypedWindowEvent(_window, UnmapNotify, &ev)) {
+        X11::putBackEvent(&ev);
         return false;
     }
 
@@ -852,12 +899,10 @@ void
 Client::readClassRoleHints(void)
 {
     // class hint
-    XClassHint class_hint;
-    if (XGetClassHint(X11::getDpy(), _window, &class_hint)) {
-        _class_hint->h_name = Charset::to_wide_str(class_hint.res_name);
-        _class_hint->h_class = Charset::to_wide_str(class_hint.res_class);
-        X11::free(class_hint.res_name);
-        X11::free(class_hint.res_class);
+    std::string res_name, res_class;
+    if (X11::getClassHint(_window, res_name, res_class)) {
+        _class_hint->h_name = Charset::to_wide_str(res_name);
+        _class_hint->h_class = Charset::to_wide_str(res_class);
     }
 
     // wm window role
@@ -1306,10 +1351,10 @@ Client::getWmState(void)
     uchar *udata;
 
     int status =
-        XGetWindowProperty(X11::getDpy(), _window, X11::getAtom(WM_STATE),
-                           0L, 2L, False, X11::getAtom(WM_STATE),
-                           &real_type, &real_format, &items_read, &items_left,
-                           &udata);
+        X11::getWindowProperty(_window, X11::getAtom(WM_STATE), 2L,
+                               X11::getAtom(WM_STATE),
+                               &real_type, &real_format, &items_read,
+                               &items_left, &udata);
     if ((status  == Success) && items_read) {
         data = reinterpret_cast<long*>(udata);
         state = *data;
@@ -1351,8 +1396,7 @@ void Client::sendTakeFocusMessage(void)
             XEvent ev;
             X11::changeProperty(X11::getRoot(),
                                 XA_PRIMARY, XA_STRING, 8, PropModeAppend, 0, 0);
-            XWindowEvent(X11::getDpy(), X11::getRoot(),
-                         PropertyChangeMask, &ev);
+            X11::windowEvent(X11::getRoot(), PropertyChangeMask, &ev);
             X11::setLastEventTime(ev.xproperty.time);
         }
         X11::sendEvent(_window, _window,
@@ -1663,7 +1707,7 @@ ulong
 Client::getWMHints(void)
 {
     ulong initial_state = NormalState;
-    XWMHints* hints = XGetWMHints(X11::getDpy(), _window);
+    XWMHints* hints = X11::getWMHints(_window);
     if (hints) {
         // get the input focus mode
         if (hints->flags&InputHint) { // FIXME: More logic needed
@@ -1685,7 +1729,7 @@ void
 Client::getWMNormalHints(void)
 {
     long dummy;
-    XGetWMNormalHints(X11::getDpy(), _window, _size, &dummy);
+    X11::getWMNormalHints(_window, _size, &dummy);
 
     // let's do some sanity checking
     if (_size->flags&PBaseSize) {
@@ -1729,7 +1773,7 @@ Client::getWMProtocols(void)
     int count;
     Atom *protocols;
 
-    if (XGetWMProtocols(X11::getDpy(), _window, &protocols, &count) != 0) {
+    if (X11::getWMProtocols(_window, &protocols, &count)) {
         for (int i = 0; i < count; ++i) {
             if (protocols[i] == X11::getAtom(WM_TAKE_FOCUS)) {
                 _send_focus_message = true;
@@ -1751,7 +1795,7 @@ Client::getTransientForHint(void)
     _transient_for_window = None;
 
     Client *transient_for = nullptr;
-    XGetTransientForHint(X11::getDpy(), _window, &_transient_for_window);
+    X11::getTransientForHint(_window, _transient_for_window);
     if (_transient_for_window != None) {
         if (_transient_for_window == _window) {
             ERR(this << " client set transient hint for itself");
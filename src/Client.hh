@@ -26,6 +26,7 @@ class AutoProperty;
 class Frame;
 
 #include <string>
+#include <unordered_map>
 
 extern "C" {
 #include <X11/Xutil.h>
@@ -47,6 +48,32 @@ public:
     bool parent_is_new;
 };
 
+/**
+ * Time spent constructing (managing) clients.
+ */
+class ManageStats {
+public:
+    ManageStats(void)
+        : managed(0),
+          total_us(0),
+          max_us(0)
+    {
+    }
+
+    ulong managed;
+    ulong total_us;
+    ulong max_us;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const ManageStats &stats) {
+        os << "managed " << stats.managed
+           << " total " << stats.total_us << "us"
+           << " avg " << (stats.managed ? stats.total_us / stats.managed : 0)
+           << "us max " << stats.max_us << "us";
+        return os;
+    }
+};
+
 class Client : public PWinObj,
                public Observer
 {
@@ -106,6 +133,9 @@ public: // Public Member Functions
     static void mapOrUnmapTransients(Window win, bool hide);
 
     // START - Iterators
+    static void getPrefetchAtoms(std::vector<Atom> &atoms);
+    static const ManageStats &getManageStats(void) { return _manage_stats; }
+
     static uint client_size(void) { return _clients.size(); }
     static std::vector<Client*>::const_iterator client_begin(void) {
         return _clients.begin();
@@ -409,4 +439,6 @@ private: // Private Member Variables
 
     static std::vector<Client*> _clients; //!< Vector of all Clients.
     static std::vector<uint> _clientids; //!< Vector of free Client IDs.
+    static std::unordered_map<uint, Client*> _client_id_map;
+    static ManageStats _manage_stats;
 };
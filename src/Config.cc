@@ -144,7 +144,9 @@ Config::Config(void) :
         _screen_workspaces(4),
         _screen_workspaces_per_row(0), _screen_workspace_name_default(L"Workspace"),
         _screen_edge_indent(false),
-        _screen_doubleclicktime(250), _screen_fullscreen_above(true),
+        _screen_doubleclicktime(250), _screen_texture_cache_size(8192),
+        _screen_image_disk_cache(false),
+        _screen_fullscreen_above(true),
         _screen_fullscreen_detect(true),
         _screen_showframelist(true),
         _screen_show_status_window(true), _screen_show_status_window_on_root(false),
@@ -170,7 +172,9 @@ Config::Config(void) :
         _harbour_da_min_s(0), _harbour_da_max_s(0),
         _harbour_ontop(true), _harbour_maximize_over(false),
         _harbour_placement(TOP), _harbour_orientation(TOP_TO_BOTTOM), _harbour_head_nr(0),
-        _harbour_opacity(EWMH_OPAQUE_WINDOW)
+        _harbour_opacity(EWMH_OPAQUE_WINDOW),
+        _hash(0),
+        _hash_mouse(0)
 {
     for (uint i = 0; i <= SCREEN_EDGE_NO; ++i) {
         _screen_edge_sizes.push_back(0);
@@ -247,6 +251,7 @@ Config::setDesktopNamesUTF8(char *names, ulong length)
 bool
 Config::load(const std::string &config_file)
 {
+    _changed_sections.clear();
     if (! _cfg_files.requireReload(config_file)) {
         return false;
     }
@@ -275,6 +280,14 @@ Config::load(const std::string &config_file)
         setenv("PEKWM_CONFIG_FILE", _config_file.c_str(), 1);
     }
 
+    // Only the modification time changed, nothing to re-apply.
+    auto hash = cfg.getEntryRoot()->getHash();
+    if (hash == _hash) {
+        return false;
+    }
+    _hash = hash;
+    updateSectionHashes(cfg.getEntryRoot());
+
     std::string o_file_mouse; // temporary filepath for mouseconfig
 
     CfgParser::Entry *section;
@@ -315,6 +328,37 @@ Config::load(const std::string &config_file)
     return true;
 }
 
+/**
+ * Hash top level sections of root, collecting the names of the
+ * sections added, removed or changed since the previous load.
+ */
+void
+Config::updateSectionHashes(CfgParser::Entry *root)
+{
+    std::map<std::string, uint64_t> section_hashes;
+    for (auto it : *root) {
+        if (it->getSection()) {
+            auto name = it->getName();
+            Util::to_upper(name);
+            auto &hash = section_hashes[name];
+            hash = hash * 1099511628211ULL ^ it->getSection()->getHash();
+        }
+    }
+
+    for (auto &it : section_hashes) {
+        auto old = _section_hashes.find(it.first);
+        if (old == _section_hashes.end() || old->second != it.second) {
+            _changed_sections.insert(it.first);
+        }
+    }
+    for (auto &it : _section_hashes) {
+        if (! section_hashes.count(it.first)) {
+            _changed_sections.insert(it.first);
+        }
+    }
+    _section_hashes.swap(section_hashes);
+}
+
 //! @brief Loads file section of configuration
 //! @param section Pointer to FILES section.
 void
@@ -406,6 +450,11 @@ Config::loadScreen(CfgParser::Entry *section)
     keys.push_back(new CfgParserKeyNumeric<int>("DOUBLECLICKTIME",
                                                 _screen_doubleclicktime,
                                                 250, 0));
+    keys.push_back(new CfgParserKeyNumeric<int>("TEXTURECACHESIZE",
+                                                _screen_texture_cache_size,
+                                                8192, 0));
+    keys.push_back(new CfgParserKeyBool("IMAGEDISKCACHE",
+                                        _screen_image_disk_cache, false));
     keys.push_back(new CfgParserKeyString("TRIMTITLE", trim_title));
     keys.push_back(new CfgParserKeyBool("FULLSCREENABOVE",
                                         _screen_fullscreen_above, true));
@@ -1119,6 +1168,12 @@ Config::loadMouseConfig(const std::string &mouse_file)
         _cfg_files_mouse = mouse_cfg.getCfgFiles();
     }
 
+    auto hash = mouse_cfg.getEntryRoot()->getHash();
+    if (hash == _hash_mouse) {
+        return false;
+    }
+    _hash_mouse = hash;
+
     // Make sure old actions get unloaded.
     for (auto it : _mouse_action_map) {
         it.second->clear();
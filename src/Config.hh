@@ -16,6 +16,7 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <utility>
 
 /**
@@ -77,6 +78,12 @@ public:
     bool load(const std::string &config_file);
     bool loadMouseConfig(const std::string &mouse_file);
 
+    /** Return true if the top level section name, in upper case,
+        changed in the last load. */
+    bool isChanged(const std::string &name) const {
+        return _changed_sections.count(name) != 0;
+    }
+
     inline const std::string &getConfigFile(void) const { return _config_file; }
 
     // Files
@@ -119,6 +126,8 @@ public:
     }
     bool getScreenEdgeIndent(void) const { return _screen_edge_indent; }
     int getDoubleClickTime(void) const { return _screen_doubleclicktime; }
+    int getTextureCacheSize(void) const { return _screen_texture_cache_size; }
+    bool isImageDiskCache(void) const { return _screen_image_disk_cache; }
 
     bool isFullscreenAbove(void) const { return _screen_fullscreen_above; }
     bool isFullscreenDetect(void) const { return _screen_fullscreen_detect; }
@@ -249,6 +258,8 @@ private:
     bool tryHardLoadConfig(CfgParser &cfg, std::string &file);
     void copyConfigFiles(void);
 
+    void updateSectionHashes(CfgParser::Entry *root);
+
     void loadFiles(CfgParser::Entry *section);
     void loadMoveResize(CfgParser::Entry *section);
     void loadScreen(CfgParser::Entry *section);
@@ -289,6 +300,10 @@ private:
     std::vector<int> _screen_edge_sizes;
     bool _screen_edge_indent;
     int _screen_doubleclicktime;
+    /** Size, in KiB, of the rendered texture cache. */
+    int _screen_texture_cache_size;
+    /** Store decoded images in $XDG_CACHE_HOME/pekwm/images. */
+    bool _screen_image_disk_cache;
     /** Flag to make fullscreen go above all windows. */
     bool _screen_fullscreen_above;
     /** Flag to make configure request fullscreen detection. */
@@ -346,6 +361,17 @@ private:
 
     std::map<MouseActionListName, std::vector<ActionEvent>* > _mouse_action_map;
     std::vector<BoundButton> _client_mouse_action_buttons;
+
+    /** Hash of the last loaded configuration, unchanged content is not
+        re-applied. */
+    uint64_t _hash;
+    /** Hash of the last loaded mouse configuration. */
+    uint64_t _hash_mouse;
+    /** Hash of each top level section in the last loaded
+        configuration. */
+    std::map<std::string, uint64_t> _section_hashes;
+    /** Top level sections changed in the last load. */
+    std::set<std::string> _changed_sections;
 };
 
 namespace pekwm
@@ -43,6 +43,7 @@ Debug::getLevel(const std::string& str)
  * maxmsgs - log the current maximum number of stored messages
  * maxmsgs <nr> - sets the maximum of stored messages (in RAM) to nr
  * level [err|warn|info|debug|trace] - sets log level.
+ * stats - log statistics from all registered providers.
  *
  */
 void
@@ -65,6 +66,8 @@ Debug::doAction(const std::string &cmd)
         } else if (args[0] == "maxmsgs") {
             _log << "Currently are " << _max_msgs << " log entries stored."
                  << std::endl;
+        } else if (args[0] == "stats") {
+            logStats();
         }
     } else if (nr == 2) {
         if (args[0] == "enable") {
@@ -107,6 +110,20 @@ Debug::doAction(const std::string &cmd)
     }
 }
 
+/**
+ * Log one line per registered statistics provider.
+ */
+void
+Debug::logStats(void)
+{
+    for (auto it : _stats) {
+        std::ostringstream oss;
+        oss << "STATS: " << it.first << ": ";
+        it.second(oss);
+        addLog(oss.str());
+    }
+}
+
 Debug::Level Debug::level = LEVEL_WARN;
 bool Debug::enable_cerr = true;
 bool Debug::enable_logfile = false;
@@ -114,3 +131,5 @@ bool Debug::enable_logfile = false;
 std::ofstream Debug::_log("/dev/null");
 std::vector<std::string> Debug::_msgs;
 std::vector<std::string>::size_type Debug::_max_msgs = 32;
+std::mutex Debug::_log_mutex;
+std::map<std::string, Debug::stats_fn> Debug::_stats;
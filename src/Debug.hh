@@ -12,8 +12,11 @@
 #include "Compat.hh"
 
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <sstream>
 #include <string>
@@ -28,9 +31,19 @@ public:
         LEVEL_TRACE
     };
 
+    typedef std::function<void(std::ostream&)> stats_fn;
+
     static Level getLevel(const std::string& str);
     static void doAction(const std::string& action);
 
+    static void addStats(const std::string& name, stats_fn fn) {
+        _stats[name] = fn;
+    }
+    static void removeStats(const std::string& name) {
+        _stats.erase(name);
+    }
+    static void logStats(void);
+
     static bool enable_cerr;
     static bool enable_logfile;
     static Level level;
@@ -41,6 +54,9 @@ public:
         return _log.good();
     }
     static void addLog(const std::string s) {
+        // images are decoded in threads, see ImageHandler::prefetch
+        std::lock_guard<std::mutex> lock(_log_mutex);
+
         // keep max messages around in memory to aid in crash debugging
         if (_msgs.size() >= _max_msgs) {
             _msgs.erase(_msgs.begin());
@@ -70,6 +86,10 @@ private:
     static std::ofstream _log;
     static std::vector<std::string> _msgs;
     static std::vector<std::string>::size_type _max_msgs;
+    /** Serializes log output from image decoding threads. */
+    static std::mutex _log_mutex;
+    /** Statistics providers, output with the stats command. */
+    static std::map<std::string, stats_fn> _stats;
 };
 
 class DebugUserObj : public std::stringstream {
@@ -44,7 +44,7 @@ DockApp::DockApp(Window win) :
     // First, we need to figure out which window that actually belongs to the
     // dockapp. This we do by checking if it has the IconWindowHint set in it's
     // WM Hint.
-    XWMHints *wm_hints = XGetWMHints(X11::getDpy(), _dockapp_window);
+    XWMHints *wm_hints = X11::getWMHints(_dockapp_window);
     if (wm_hints) {
         if ((wm_hints->flags&IconWindowHint) &&
                 (wm_hints->icon_window != None)) {
@@ -59,7 +59,7 @@ DockApp::DockApp(Window win) :
 
     // Now, when we now what window id we should use, set the size up.
     XWindowAttributes attr;
-    if (XGetWindowAttributes(X11::getDpy(), _dockapp_window, &attr)) {
+    if (X11::getWindowAttributes(_dockapp_window, attr)) {
         _c_gm.width = attr.width;
         _c_gm.height = attr.height;
 
@@ -0,0 +1,394 @@
+//
+// EventBatch.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "EventBatch.hh"
+
+#include <algorithm>
+
+std::ostream&
+operator<<(std::ostream &os, const EventBatch::Stats &stats)
+{
+    os << "batches " << stats.batches
+       << " events " << stats.events
+       << " coalesced " << stats.coalesced
+       << " (motion " << stats.motion
+       << " expose " << stats.expose
+       << " configure " << stats.configure
+       << " property " << stats.property << ")";
+    return os;
+}
+
+EventBatch::EventBatch(void)
+    : _pos(0),
+      _size(0)
+{
+}
+
+EventBatch::~EventBatch(void)
+{
+}
+
+/**
+ * Add event to the end of the batch, coalescing it with previous
+ * events if possible.
+ */
+void
+EventBatch::push(XEvent ev)
+{
+    _stats.events++;
+
+    Window win = getEventWindow(ev);
+    if (coalesce(ev, win)) {
+        _stats.coalesced++;
+    }
+
+    size_t idx = _events.size();
+    _events.push_back(ev);
+    _size++;
+
+    _last[win] = idx;
+    if (ev.type == PropertyNotify) {
+        _properties[PropertyKey(win, ev.xproperty.atom)] = idx;
+    } else {
+        _barrier[win] = idx + 1;
+    }
+}
+
+/**
+ * Get next event from the batch.
+ *
+ * @return true if an event was returned, false if batch is empty.
+ */
+bool
+EventBatch::pop(XEvent &ev)
+{
+    while (_pos < _events.size()) {
+        const XEvent &next = _events[_pos++];
+        if (next.type != 0) {
+            ev = next;
+            _size--;
+            if (_pos == _events.size()) {
+                reset();
+            }
+            return true;
+        }
+    }
+    reset();
+    return false;
+}
+
+/**
+ * Put event back at the head of the batch, making it the next event
+ * returned by pop.
+ */
+void
+EventBatch::putBack(const XEvent &ev)
+{
+    _size++;
+    if (_pos > 0) {
+        _events[--_pos] = ev;
+    } else {
+        // indexes are shifted, stop coalescing with current events
+        _events.insert(_events.begin(), ev);
+        _last.clear();
+        _barrier.clear();
+        _properties.clear();
+    }
+}
+
+void
+EventBatch::clear(void)
+{
+    reset();
+}
+
+bool
+EventBatch::checkTypedEvent(int type, XEvent &ev)
+{
+    for (size_t i = _pos; i < _events.size(); i++) {
+        if (_events[i].type == type) {
+            ev = _events[i];
+            drop(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+EventBatch::checkTypedWindowEvent(Window win, int type, XEvent &ev)
+{
+    for (size_t i = _pos; i < _events.size(); i++) {
+        if (_events[i].type == type && _events[i].xany.window == win) {
+            ev = _events[i];
+            drop(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+EventBatch::checkMaskEvent(long mask, XEvent &ev)
+{
+    for (size_t i = _pos; i < _events.size(); i++) {
+        if (matchEventMask(_events[i], mask)) {
+            ev = _events[i];
+            drop(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+EventBatch::checkWindowEvent(Window win, long mask, XEvent &ev)
+{
+    for (size_t i = _pos; i < _events.size(); i++) {
+        if (_events[i].xany.window == win && matchEventMask(_events[i], mask)) {
+            ev = _events[i];
+            drop(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Remove all events of type from the batch.
+ *
+ * @return Number of removed events.
+ */
+uint
+EventBatch::removeTypedEvents(int type)
+{
+    uint num = 0;
+    for (size_t i = _pos; i < _events.size(); i++) {
+        if (_events[i].type == type) {
+            drop(i);
+            num++;
+        }
+    }
+    return num;
+}
+
+/**
+ * Get the window an event applies to, for events generated with
+ * SubstructureRedirectMask/SubstructureNotifyMask this is the child
+ * and not the window the event was reported on.
+ */
+Window
+EventBatch::getEventWindow(const XEvent &ev)
+{
+    switch (ev.type) {
+    case MapRequest:
+        return ev.xmaprequest.window;
+    case ConfigureRequest:
+        return ev.xconfigurerequest.window;
+    case CirculateRequest:
+        return ev.xcirculaterequest.window;
+    case MapNotify:
+        return ev.xmap.window;
+    case UnmapNotify:
+        return ev.xunmap.window;
+    case DestroyNotify:
+        return ev.xdestroywindow.window;
+    case ConfigureNotify:
+        return ev.xconfigure.window;
+    case ReparentNotify:
+        return ev.xreparent.window;
+    case GravityNotify:
+        return ev.xgravity.window;
+    case CirculateNotify:
+        return ev.xcirculate.window;
+    default:
+        return ev.xany.window;
+    }
+}
+
+/**
+ * Check if event is selected by mask, same semantics as XMaskEvent
+ * except that all motion masks match all MotionNotify events.
+ */
+bool
+EventBatch::matchEventMask(const XEvent &ev, long mask)
+{
+    switch (ev.type) {
+    case KeyPress:
+        return mask & KeyPressMask;
+    case KeyRelease:
+        return mask & KeyReleaseMask;
+    case ButtonPress:
+        return mask & ButtonPressMask;
+    case ButtonRelease:
+        return mask & ButtonReleaseMask;
+    case MotionNotify:
+        return mask & (PointerMotionMask | PointerMotionHintMask
+                       | ButtonMotionMask | Button1MotionMask
+                       | Button2MotionMask | Button3MotionMask
+                       | Button4MotionMask | Button5MotionMask);
+    case EnterNotify:
+        return mask & EnterWindowMask;
+    case LeaveNotify:
+        return mask & LeaveWindowMask;
+    case FocusIn:
+    case FocusOut:
+        return mask & FocusChangeMask;
+    case KeymapNotify:
+        return mask & KeymapStateMask;
+    case Expose:
+    case GraphicsExpose:
+    case NoExpose:
+        return mask & ExposureMask;
+    case VisibilityNotify:
+        return mask & VisibilityChangeMask;
+    case CreateNotify:
+        return mask & SubstructureNotifyMask;
+    case DestroyNotify:
+    case UnmapNotify:
+    case MapNotify:
+    case ReparentNotify:
+    case ConfigureNotify:
+    case GravityNotify:
+    case CirculateNotify:
+        return mask & (StructureNotifyMask | SubstructureNotifyMask);
+    case MapRequest:
+    case ConfigureRequest:
+    case CirculateRequest:
+        return mask & SubstructureRedirectMask;
+    case ResizeRequest:
+        return mask & ResizeRedirectMask;
+    case PropertyNotify:
+        return mask & PropertyChangeMask;
+    case ColormapNotify:
+        return mask & ColormapChangeMask;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Coalesce ev with previous events for the same window, previous
+ * events are dropped and their content merged into ev.
+ *
+ * @return true if a previous event was dropped.
+ */
+bool
+EventBatch::coalesce(XEvent &ev, Window win)
+{
+    if (ev.type == PropertyNotify) {
+        auto it = _properties.find(PropertyKey(win, ev.xproperty.atom));
+        if (it == _properties.end()) {
+            return false;
+        }
+        auto bit = _barrier.find(win);
+        if (bit != _barrier.end() && it->second < bit->second) {
+            return false;
+        }
+        if (_events[it->second].type != PropertyNotify) {
+            return false;
+        }
+        drop(it->second);
+        _stats.property++;
+        return true;
+    }
+
+    auto it = _last.find(win);
+    if (it == _last.end()) {
+        return false;
+    }
+    XEvent &prev = _events[it->second];
+    if (prev.type != ev.type) {
+        return false;
+    }
+
+    switch (ev.type) {
+    case MotionNotify:
+        if (prev.xmotion.window != ev.xmotion.window
+            || prev.xmotion.state != ev.xmotion.state) {
+            return false;
+        }
+        _stats.motion++;
+        break;
+    case Expose: {
+        // merge area of the previous event into the new one.
+        XExposeEvent &cur = ev.xexpose;
+        int x1 = std::min(prev.xexpose.x, cur.x);
+        int y1 = std::min(prev.xexpose.y, cur.y);
+        int x2 = std::max(prev.xexpose.x + prev.xexpose.width,
+                          cur.x + cur.width);
+        int y2 = std::max(prev.xexpose.y + prev.xexpose.height,
+                          cur.y + cur.height);
+        cur.x = x1;
+        cur.y = y1;
+        cur.width = x2 - x1;
+        cur.height = y2 - y1;
+        _stats.expose++;
+        break;
+    }
+    case ConfigureRequest: {
+        // values set in the previous request, but not in the new one
+        // are kept.
+        const XConfigureRequestEvent &p = prev.xconfigurerequest;
+        XConfigureRequestEvent &cur = ev.xconfigurerequest;
+        if (p.parent != cur.parent) {
+            return false;
+        }
+        ulong keep = p.value_mask & ~cur.value_mask;
+        if (keep & CWX) {
+            cur.x = p.x;
+        }
+        if (keep & CWY) {
+            cur.y = p.y;
+        }
+        if (keep & CWWidth) {
+            cur.width = p.width;
+        }
+        if (keep & CWHeight) {
+            cur.height = p.height;
+        }
+        if (keep & CWBorderWidth) {
+            cur.border_width = p.border_width;
+        }
+        if (keep & CWSibling) {
+            cur.above = p.above;
+        }
+        if (keep & CWStackMode) {
+            cur.detail = p.detail;
+        }
+        cur.value_mask |= p.value_mask;
+        _stats.configure++;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    drop(it->second);
+    return true;
+}
+
+void
+EventBatch::drop(size_t idx)
+{
+    if (idx >= _pos && _events[idx].type != 0) {
+        _size--;
+    }
+    _events[idx].type = 0;
+}
+
+void
+EventBatch::reset(void)
+{
+    _events.clear();
+    _pos = 0;
+    _size = 0;
+    _last.clear();
+    _barrier.clear();
+    _properties.clear();
+}
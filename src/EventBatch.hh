@@ -0,0 +1,110 @@
+//
+// EventBatch.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "Types.hh"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <X11/Xlib.h>
+}
+
+/**
+ * Queue of events read from the X server in one go, redundant events
+ * are coalesced as they are added:
+ *
+ *  - consecutive MotionNotify on the same window, only the last is kept.
+ *  - consecutive Expose on the same window, area is merged.
+ *  - consecutive ConfigureRequest on the same window, values are merged.
+ *  - PropertyNotify for the same window and atom, only the last is kept
+ *    unless other events for the window happened in between.
+ *
+ * Events that are coalesced away are left as tombstones (type 0) to
+ * keep indexes stable while the batch is filled.
+ */
+class EventBatch {
+public:
+    class Stats {
+    public:
+        Stats(void)
+            : batches(0),
+              events(0),
+              coalesced(0),
+              motion(0),
+              expose(0),
+              configure(0),
+              property(0)
+        {
+        }
+
+        ulong batches;
+        ulong events;
+        ulong coalesced;
+        ulong motion;
+        ulong expose;
+        ulong configure;
+        ulong property;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
+    EventBatch(void);
+    ~EventBatch(void);
+
+    bool empty(void) const { return _pos == _events.size(); }
+    /** Number of events left in the batch, excluding coalesced events. */
+    size_t size(void) const { return _size; }
+    const Stats &getStats(void) const { return _stats; }
+
+    void beginBatch(void) { _stats.batches++; }
+    void push(XEvent ev);
+    bool pop(XEvent &ev);
+    void putBack(const XEvent &ev);
+    void clear(void);
+
+    bool checkTypedEvent(int type, XEvent &ev);
+    bool checkTypedWindowEvent(Window win, int type, XEvent &ev);
+    bool checkMaskEvent(long mask, XEvent &ev);
+    bool checkWindowEvent(Window win, long mask, XEvent &ev);
+    uint removeTypedEvents(int type);
+
+    static Window getEventWindow(const XEvent &ev);
+    static bool matchEventMask(const XEvent &ev, long mask);
+
+private:
+    bool coalesce(XEvent &ev, Window win);
+    void drop(size_t idx);
+    void reset(void);
+
+    typedef std::pair<Window, Atom> PropertyKey;
+
+    /** Batched events, including tombstones. */
+    std::vector<XEvent> _events;
+    /** Position of the next event to return. */
+    size_t _pos;
+    /** Number of events, excluding tombstones, from _pos. */
+    size_t _size;
+
+    /** Index of the last event added for a window. */
+    std::map<Window, size_t> _last;
+    /**
+     * Index after the last non PropertyNotify event added for a
+     * window, PropertyNotify events before it must not be dropped.
+     */
+    std::map<Window, size_t> _barrier;
+    /** Index of the last PropertyNotify for a window and atom. */
+    std::map<PropertyKey, size_t> _properties;
+
+    Stats _stats;
+};
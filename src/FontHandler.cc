@@ -39,8 +39,8 @@ FontHandler::~FontHandler(void)
         delete it.getData();
     }
 
-    for (auto it : _colours) {
-        delete it.getData();
+    for (auto &it : _colours) {
+        freeColor(it.second.getData());
     }
 }
 
@@ -154,11 +154,12 @@ PFont::Color*
 FontHandler::getColor(const std::string &color)
 {
     // check cache
-    for (auto it : _colours) {
-        if (it == color) {
-            it.incRef();
-            return it.getData();
-        }
+    std::string name(color);
+    Util::to_lower(name);
+    auto it = _colours.find(name);
+    if (it != _colours.end()) {
+        it->second.incRef();
+        return it->second.getData();
     }
 
     // create new
@@ -175,11 +176,11 @@ FontHandler::getColor(const std::string &color)
     }
 
     // create new entry
-    HandlerEntry<PFont::Color*> entry(color);
+    HandlerEntry<PFont::Color*> entry(name);
     entry.incRef();
     entry.setData(font_color);
 
-    _colours.push_back(entry);
+    _colours.emplace(name, entry);
 
     return font_color;
 }
@@ -188,12 +189,11 @@ FontHandler::getColor(const std::string &color)
 void
 FontHandler::returnColor(PFont::Color *color)
 {
-    auto it(_colours.begin());
-    for (; it != _colours.end(); ++it) {
-        if (it->getData() == color) {
-            it->decRef();
-            if (! it->getRef()) {
-                delete it->getData();
+    for (auto it = _colours.begin(); it != _colours.end(); ++it) {
+        if (it->second.getData() == color) {
+            it->second.decRef();
+            if (! it->second.getRef()) {
+                freeColor(it->second.getData());
                 _colours.erase(it);
             }
             break;
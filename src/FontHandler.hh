@@ -15,6 +15,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 
 //! @brief FontHandler, a caching and font type transparent font handler.
 class FontHandler {
@@ -34,7 +35,8 @@ private:
 
 private:
     std::vector<HandlerEntry<PFont*> > _fonts;
-    std::vector<HandlerEntry<PFont::Color*> > _colours;
+    /** Font colors, keyed on the lower cased color specification. */
+    std::unordered_map<std::string, HandlerEntry<PFont::Color*>> _colours;
 };
 
 namespace pekwm
@@ -38,6 +38,7 @@ extern "C" {
 #include "X11Util.hh"
 
 std::vector<Frame*> Frame::_frames;
+std::unordered_map<uint, Frame*> Frame::_frame_id_map;
 std::vector<uint> Frame::_frameid_list;
 
 ActionEvent Frame::_ae_move = ActionEvent(Action(ACTION_MOVE));
@@ -165,6 +166,7 @@ Frame::Frame(Client *client, AutoProperty *ap)
     // I add these to the list before I insert the client into the frame to
     // be able to skip an extra updateClientList
     _frames.push_back(this);
+    addFrameId();
     Workspaces::addToMRUBack(this);
 
     activateChild(client);
@@ -201,6 +203,7 @@ Frame::~Frame(void)
     _wo_map.erase(_window);
     woListRemove(this);
     Util::vectorRemove(_frames, this);
+    removeFrameId();
     Workspaces::removeFromMRU(this);
     if (_tag_frame == this) {
         _tag_frame = 0;
@@ -702,7 +705,9 @@ Frame::getDecorName(void)
 void
 Frame::setId(uint id)
 {
+    removeFrameId();
     _id = id;
+    addFrameId();
     for (auto it : _children) {
         X11::setCardinal(it->getWindow(), PEKWM_FRAME_ID, id);
     }
@@ -813,10 +818,11 @@ Frame::findFrameFromWindow(Window win)
         return 0;
     }
 
-    for (auto it : _frames) {
-        if (win == it->getWindow()) { // operator == does more than that
-            return it;
-        }
+    // decoration windows are registered on the frame as well,
+    // only match the frame window.
+    PWinObj *wo = findPWinObj(win);
+    if (wo && wo->getType() == WO_FRAME && wo->getWindow() == win) {
+        return static_cast<Frame*>(wo);
     }
     return 0;
 }
@@ -827,12 +833,8 @@ Frame::findFrameFromWindow(Window win)
 Frame*
 Frame::findFrameFromID(uint id)
 {
-    for (auto it : _frames) {
-        if (it->getId() == id) {
-            return it;
-        }
-    }
-    return 0;
+    auto it = _frame_id_map.find(id);
+    return it == _frame_id_map.end() ? nullptr : it->second;
 }
 
 void
@@ -957,6 +959,37 @@ Frame::returnFrameID(uint id)
     _frameid_list.insert(it, id);
 }
 
+/**
+ * Add frame to the id index, ids read from hints at startup might not
+ * be unique in which case the first frame is used.
+ */
+void
+Frame::addFrameId(void)
+{
+    _frame_id_map.insert(std::make_pair(_id, this));
+}
+
+/**
+ * Remove frame from the id index, promoting any other frame with the
+ * same id.
+ */
+void
+Frame::removeFrameId(void)
+{
+    auto it = _frame_id_map.find(_id);
+    if (it == _frame_id_map.end() || it->second != this) {
+        return;
+    }
+    _frame_id_map.erase(it);
+
+    for (auto frame : _frames) {
+        if (frame != this && frame->_id == _id) {
+            _frame_id_map[_id] = frame;
+            break;
+        }
+    }
+}
+
 //! @brief Resets Frame IDs.
 void
 Frame::resetFrameIDs(void)
@@ -1067,7 +1100,7 @@ Frame::doGroupingDrag(XMotionEvent *ev, Client *client, bool behind)
 
     XEvent e;
     while (true) { // this breaks when we get an button release
-        XMaskEvent(X11::getDpy(), PointerMotionMask|ButtonReleaseMask, &e);
+        X11::maskEvent(PointerMotionMask|ButtonReleaseMask, &e);
 
         switch (e.type)  {
         case MotionNotify:
@@ -1266,7 +1299,7 @@ Frame::doResize(bool left, bool x, bool top, bool y)
         if (outline) {
             drawOutline(_gm);
         }
-        XMaskEvent(X11::getDpy(), resize_mask, &ev);
+        X11::maskEvent(resize_mask, &ev);
         if (outline) {
             drawOutline(_gm); // clear
         }
@@ -21,6 +21,7 @@ class ClassHint;
 class AutoProperty;
 
 #include <string>
+#include <unordered_map>
 
 class Frame : public PDecor
 {
@@ -203,6 +204,9 @@ private:
     static void returnFrameID(uint id);
 
 private:
+    void addFrameId(void);
+    void removeFrameId(void);
+
     uint _id; // unique id of the frame
 
     Client *_client; // to skip all the casts from PWinObj
@@ -215,6 +219,7 @@ private:
 
     static std::vector<Frame*> _frames; //!< Vector of all Frames.
     static std::vector<uint> _frameid_list; //!< Vector of free Frame IDs.
+    static std::unordered_map<uint, Frame*> _frame_id_map; //!< id to Frame
 
     static ActionEvent _ae_move;
     static ActionEvent _ae_move_resize;
@@ -10,6 +10,7 @@
 
 #include "ActionHandler.hh"
 #include "AutoProperties.hh"
+#include "CfgParserCache.hh"
 #include "Config.hh"
 #include "FontHandler.hh"
 #include "Harbour.hh"
@@ -41,6 +42,9 @@ namespace pekwm
               Display* dpy, const std::string& config_file,
               bool replace, bool synchronous)
     {
+        // compiled configuration trees, written by pekwm_cfg --compile
+        CfgParserCache::setDir(Util::getCacheDir() + "/config");
+
         _config = new Config();
         _config->load(config_file);
         _config->loadMouseConfig(_config->getMouseConfigFile());
@@ -65,6 +69,10 @@ namespace pekwm
 
         _font_handler = new FontHandler();
         _image_handler = new ImageHandler();
+        if (_config->isImageDiskCache()) {
+            _image_handler->getDiskCache().setDir(
+                ImageDiskCache::getDefaultDir());
+        }
         _texture_handler = new TextureHandler();
         _theme = new Theme(_font_handler, _image_handler, _texture_handler,
                            _config->getThemeFile(), _config->getThemeVariant());
@@ -0,0 +1,376 @@
+//
+// ImageDiskCache.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "config.h"
+
+#include "Debug.hh"
+#include "ImageDiskCache.hh"
+#include "Util.hh"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+/** Bump when the entry layout changes, old entries are ignored. */
+#define IMAGE_DISK_CACHE_VERSION 2
+/** Largest image, in pixels, stored in the cache. */
+#define IMAGE_DISK_CACHE_MAX_PIXELS (8192 * 8192)
+/** Default max size, in bytes, of all entries. */
+#define IMAGE_DISK_CACHE_MAX_SIZE (256 * 1024 * 1024)
+
+static const char IMAGE_DISK_CACHE_MAGIC[8] =
+    {'P', 'E', 'K', 'W', 'M', 'I', 'M', 'G'};
+
+/**
+ * Entry header, followed by the source path and width * height ARGB
+ * pixels in native byte order.
+ */
+struct EntryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t use_alpha;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    int64_t size;
+    uint32_t path_len;
+    uint32_t reserved;
+};
+
+/**
+ * Cache entry considered when pruning, ordered by modification time.
+ */
+struct PruneEntry {
+    std::string path;
+    time_t mtime;
+    off_t size;
+
+    bool operator<(const PruneEntry &rhs) const { return mtime < rhs.mtime; }
+};
+
+/**
+ * Read exactly size bytes from fd.
+ */
+static bool
+readAll(int fd, void *buf, size_t size)
+{
+    char *p = static_cast<char*>(buf);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * Write exactly size bytes to fd.
+ */
+static bool
+writeAll(int fd, const void *buf, size_t size)
+{
+    const char *p = static_cast<const char*>(buf);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+std::ostream&
+operator<<(std::ostream &os, const ImageDiskCache::Stats &stats)
+{
+    os << "hits " << stats.hits
+       << " misses " << stats.misses
+       << " writes " << stats.writes
+       << " prunes " << stats.prunes;
+    return os;
+}
+
+bool
+ImageDiskCache::Source::read(const std::string &file)
+{
+    struct stat stat_buf;
+    if (stat(file.c_str(), &stat_buf)) {
+        return false;
+    }
+    path = file;
+    mtime = stat_buf.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = stat_buf.st_mtim.tv_nsec;
+#else // ! HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = 0;
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+    size = stat_buf.st_size;
+    return true;
+}
+
+ImageDiskCache::ImageDiskCache(void)
+    : _max_size(IMAGE_DISK_CACHE_MAX_SIZE)
+{
+}
+
+ImageDiskCache::~ImageDiskCache(void)
+{
+}
+
+/**
+ * Get default cache directory, images below the pekwm cache
+ * directory.
+ */
+std::string
+ImageDiskCache::getDefaultDir(void)
+{
+    return Util::getCacheDir() + "/images";
+}
+
+/**
+ * Set cache directory, creating it if it does not exist. An empty dir
+ * disables the cache.
+ *
+ * @return true if the cache is enabled.
+ */
+bool
+ImageDiskCache::setDir(const std::string &dir)
+{
+    _dir.clear();
+    if (dir.empty()) {
+        return false;
+    }
+
+    if (! Util::makeDirs(dir)) {
+        USER_WARN("failed to create image cache directory " << dir << ": "
+                  << strerror(errno));
+        return false;
+    }
+    _dir = dir;
+    return true;
+}
+
+ImageDiskCache::Stats
+ImageDiskCache::getStats(void)
+{
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    return _stats;
+}
+
+/**
+ * Load cached image data for source. If width and height are 0 the
+ * decoded image is loaded, else the image scaled to width x height.
+ *
+ * @return ARGB data, allocated with new [], or nullptr if not cached.
+ */
+uchar*
+ImageDiskCache::load(const Source &source, uint &width, uint &height,
+                     bool &use_alpha)
+{
+    if (! isEnabled()) {
+        return nullptr;
+    }
+
+    uchar *data = nullptr;
+    auto file = getEntryPath(source.path, width, height);
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd != -1) {
+        EntryHeader header;
+        std::string path;
+        struct stat stat_buf;
+        if (readAll(fd, &header, sizeof(header))
+            && ! memcmp(header.magic, IMAGE_DISK_CACHE_MAGIC,
+                        sizeof(header.magic))
+            && header.version == IMAGE_DISK_CACHE_VERSION
+            && header.mtime == source.mtime
+            && header.mtime_nsec == source.mtime_nsec
+            && header.size == source.size
+            && header.path_len == source.path.size()
+            && (width == 0 || header.width == width)
+            && (height == 0 || header.height == height)
+            && header.width > 0 && header.height > 0
+            && (uint64_t(header.width) * header.height
+                <= IMAGE_DISK_CACHE_MAX_PIXELS)
+            && ! fstat(fd, &stat_buf)
+            && (uint64_t(stat_buf.st_size)
+                == (sizeof(header) + header.path_len
+                    + uint64_t(header.width) * header.height * 4))) {
+            path.resize(header.path_len);
+            if (readAll(fd, &path[0], path.size()) && path == source.path) {
+                size_t bytes = size_t(header.width) * header.height * 4;
+                data = new uchar[bytes];
+                if (readAll(fd, data, bytes)) {
+                    width = header.width;
+                    height = header.height;
+                    use_alpha = header.use_alpha;
+                    // entries are pruned by modification time
+                    futimens(fd, nullptr);
+                } else {
+                    delete [] data;
+                    data = nullptr;
+                }
+            }
+        }
+        close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    if (data) {
+        _stats.hits++;
+    } else {
+        _stats.misses++;
+    }
+    return data;
+}
+
+/**
+ * Store image data for source, scaled is set for data not being the
+ * decoded image but the image scaled to width x height.
+ *
+ * The entry is written to a temporary file and renamed into place, so
+ * pekwm and pekwm_bg never read a partially written entry.
+ */
+void
+ImageDiskCache::save(const Source &source, bool scaled,
+                     const uchar *data, uint width, uint height,
+                     bool use_alpha)
+{
+    if (! isEnabled() || width == 0 || height == 0
+        || uint64_t(width) * height > IMAGE_DISK_CACHE_MAX_PIXELS) {
+        return;
+    }
+
+    auto file = getEntryPath(source.path,
+                             scaled ? width : 0, scaled ? height : 0);
+    std::string tmp_file = file + ".XXXXXX";
+    int fd = mkstemp(&tmp_file[0]);
+    if (fd == -1) {
+        return;
+    }
+
+    EntryHeader header;
+    memcpy(header.magic, IMAGE_DISK_CACHE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_DISK_CACHE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.use_alpha = use_alpha;
+    header.mtime = source.mtime;
+    header.mtime_nsec = source.mtime_nsec;
+    header.size = source.size;
+    header.path_len = source.path.size();
+    header.reserved = 0;
+
+    bool ok = writeAll(fd, &header, sizeof(header))
+        && writeAll(fd, source.path.c_str(), source.path.size())
+        && writeAll(fd, data, size_t(width) * height * 4);
+    ok = close(fd) == 0 && ok;
+    if (! ok || rename(tmp_file.c_str(), file.c_str())) {
+        DBG("failed to write image cache entry " << file);
+        unlink(tmp_file.c_str());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_stats_mutex);
+        _stats.writes++;
+    }
+    prune();
+}
+
+/**
+ * Remove least recently used entries until the size of all entries is
+ * below the max size.
+ */
+void
+ImageDiskCache::prune(void)
+{
+    DIR *dir = opendir(_dir.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+
+    std::vector<PruneEntry> entries;
+    uint64_t size = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        // skip . and .., and temporary files being written
+        if (strchr(entry->d_name, '.')) {
+            continue;
+        }
+
+        PruneEntry prune_entry;
+        prune_entry.path = _dir + "/" + entry->d_name;
+        struct stat stat_buf;
+        if (! stat(prune_entry.path.c_str(), &stat_buf)
+            && S_ISREG(stat_buf.st_mode)) {
+            prune_entry.mtime = stat_buf.st_mtime;
+            prune_entry.size = stat_buf.st_size;
+            entries.push_back(prune_entry);
+            size += stat_buf.st_size;
+        }
+    }
+    closedir(dir);
+
+    if (size <= _max_size) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end());
+    ulong prunes = 0;
+    for (auto it = entries.begin(); size > _max_size && it != entries.end();
+         ++it) {
+        if (! unlink(it->path.c_str())) {
+            size -= it->size;
+            prunes++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _stats.prunes += prunes;
+}
+
+/**
+ * Get path of entry, the source path is hashed using 64-bit FNV-1a.
+ */
+std::string
+ImageDiskCache::getEntryPath(const std::string &path,
+                             uint width, uint height) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto c : path) {
+        hash ^= static_cast<uchar>(c);
+        hash *= 1099511628211ULL;
+    }
+
+    std::ostringstream os;
+    os << _dir << "/" << std::hex << std::setw(16) << std::setfill('0')
+       << hash << std::dec << "-" << width << "x" << height;
+    return os.str();
+}
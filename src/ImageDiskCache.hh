@@ -0,0 +1,105 @@
+//
+// ImageDiskCache.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "Types.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+/**
+ * Cache of decoded, and scaled, images stored on disk as raw ARGB
+ * data. Entries are keyed on the source path and size, and are only
+ * used if the modification time, including nanoseconds where
+ * available, and size of the source file match the file the entry was
+ * created from.
+ *
+ * The cache is shared between pekwm and pekwm_bg and is disabled
+ * until a directory is set. load and save can be called from multiple
+ * threads.
+ *
+ * The size of the cache is limited, when exceeded the least recently
+ * used entries are removed. Entries are touched when loaded making
+ * the modification time the time of last use.
+ */
+class ImageDiskCache {
+public:
+    class Stats {
+    public:
+        Stats(void)
+            : hits(0),
+              misses(0),
+              writes(0),
+              prunes(0)
+        {
+        }
+
+        ulong hits;
+        ulong misses;
+        ulong writes;
+        /** Number of entries removed to keep the cache below its limit. */
+        ulong prunes;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
+    /** Identity of the image file an entry is created from. */
+    class Source {
+    public:
+        Source(void) : mtime(0), mtime_nsec(0), size(0) { }
+
+        bool read(const std::string &file);
+
+        std::string path;
+        time_t mtime;
+        /** Nanoseconds of mtime, 0 if not supported. */
+        long mtime_nsec;
+        off_t size;
+    };
+
+    ImageDiskCache(void);
+    ~ImageDiskCache(void);
+
+    static std::string getDefaultDir(void);
+
+    bool isEnabled(void) const { return ! _dir.empty(); }
+    const std::string &getDir(void) const { return _dir; }
+    bool setDir(const std::string &dir);
+    /** Set max size, in bytes, of all entries. */
+    void setMaxSize(uint64_t max_size) { _max_size = max_size; }
+
+    Stats getStats(void);
+
+    uchar *load(const Source &source, uint &width, uint &height,
+                bool &use_alpha);
+    void save(const Source &source, bool scaled,
+              const uchar *data, uint width, uint height, bool use_alpha);
+
+private:
+    std::string getEntryPath(const std::string &path,
+                             uint width, uint height) const;
+    void prune(void);
+
+    /** Cache directory, empty if disabled. */
+    std::string _dir;
+    /** Max size, in bytes, of all entries. */
+    uint64_t _max_size;
+
+    /** Protects _stats. */
+    std::mutex _stats_mutex;
+    Stats _stats;
+};
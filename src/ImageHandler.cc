@@ -13,24 +13,71 @@
 #include "PImage.hh"
 #include "Util.hh"
 
+#include <algorithm>
+#include <iterator>
+#include <system_error>
+
 extern "C" {
 #include <assert.h>
+#include <sys/stat.h>
 }
 
+/** Default max size of unused images, 16MB. */
+#define IMAGE_CACHE_DEFAULT_SIZE (16 * 1024 * 1024)
+/** Max number of threads decoding images in prefetch. */
+#define IMAGE_PREFETCH_MAX_THREADS 4
+
 static Util::StringMap<ImageType> image_type_map =
     {{"", IMAGE_TYPE_NO},
      {"TILED", IMAGE_TYPE_TILED},
      {"SCALED", IMAGE_TYPE_SCALED},
      {"FIXED", IMAGE_TYPE_FIXED}};
 
+std::ostream&
+operator<<(std::ostream &os, const ImageHandler::Stats &stats)
+{
+    os << "decodes " << stats.decodes
+       << " mapped " << stats.mapped
+       << " revived " << stats.revived
+       << " evictions " << stats.evictions
+       << " unused " << stats.unused
+       << " unused bytes " << stats.unused_bytes
+       << " prefetched " << stats.prefetched;
+    return os;
+}
+
+bool
+ImageHandler::FileId::read(const std::string &file)
+{
+    struct stat stat_buf;
+    if (stat(file.c_str(), &stat_buf)) {
+        return false;
+    }
+    mtime = stat_buf.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = stat_buf.st_mtim.tv_nsec;
+#else // ! HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = 0;
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+    size = stat_buf.st_size;
+    return true;
+}
+
 ImageHandler::ImageHandler(void)
+    : _cache_size(IMAGE_CACHE_DEFAULT_SIZE),
+      _prefetch_next(0)
 {
     _images[""] = Util::RefEntry<PImage*>(nullptr);
     clearColorMaps();
+    PImage::setDiskCache(&_disk_cache);
 }
 
 ImageHandler::~ImageHandler(void)
 {
+    prefetchDone();
+    clearUnused(nullptr);
+    PImage::setDiskCache(nullptr);
+
     if (_images.size() != 1) {
         ERR("ImageHandler not empty on destruct, " << _images.size() - 1
               << " entries left");
@@ -53,12 +100,13 @@ PImage*
 ImageHandler::getImage(const std::string &file)
 {
     uint ref;
-    return getImage(file, ref, _images);
+    return getImage(file, ref, _images, nullptr);
 }
 
 PImage*
 ImageHandler::getImage(const std::string &file, uint &ref,
-                       Util::StringMap<Util::RefEntry<PImage*>> &images)
+                       image_map &images,
+                       const std::map<int, int> *color_map)
 {
     if (! file.size()) {
         ref = 0;
@@ -79,11 +127,11 @@ ImageHandler::getImage(const std::string &file, uint &ref,
     // already.
     PImage *image = nullptr;
     if (real_file[0] == '/') {
-        image = getImageFromPath(real_file, ref, images);
+        image = getImageFromPath(real_file, ref, images, color_map);
     } else {
         auto it(_search_path.rbegin());
         for (; it != _search_path.rend(); ++it) {
-            image = getImageFromPath(*it + real_file, ref, images);
+            image = getImageFromPath(*it + real_file, ref, images, color_map);
             if (image) {
                 break;
             }
@@ -106,22 +154,22 @@ ImageHandler::getImage(const std::string &file, uint &ref,
  */
 PImage*
 ImageHandler::getImageFromPath(const std::string &file, uint &ref,
-                               Util::StringMap<Util::RefEntry<PImage*>> &images)
+                               image_map &images,
+                               const std::map<int, int> *color_map)
 {
-    // Check cache for entry.
+    // Check cache for entry, images without references are only
+    // re-used if the file has not changed since it was loaded.
     Util::RefEntry<PImage*> &entry = images.get(file);
     if (entry.get() != nullptr) {
-        ref = entry.incRef();
-        return entry.get();
+        if (entry.getRef() > 0 || reviveImage(entry.get(), file)) {
+            ref = entry.incRef();
+            return entry.get();
+        }
+        deleteImage(entry.get(), images, file);
     }
 
     // Try to load the image, setup cache only if it succeeds.
-    PImage *image;
-    try {
-        image = new PImage(file);
-    } catch (LoadException&) {
-        image = nullptr;
-    }
+    auto image = loadImage(file, color_map);
 
     // Create new PImage and handler entry for it.
     if (image) {
@@ -134,6 +182,49 @@ ImageHandler::getImageFromPath(const std::string &file, uint &ref,
     return image;
 }
 
+/**
+ * Load image from file, color mapped images are created from the
+ * image loaded without color map to avoid decoding the file again.
+ */
+PImage*
+ImageHandler::loadImage(const std::string &file,
+                        const std::map<int, int> *color_map)
+{
+    PImage *image;
+    if (color_map) {
+        uint ref;
+        auto base = getImageFromPath(file, ref, _images, nullptr);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        image = new PImage(base);
+        mapColors(image, *color_map);
+        _file_ids[image] = _file_ids[base];
+        returnImage(base, _images);
+        _stats.mapped++;
+    } else {
+        FileId id;
+        if (takePrefetched(file, image, id)) {
+            if (image) {
+                _file_ids[image] = id;
+                _stats.decodes++;
+                _stats.prefetched++;
+            }
+            return image;
+        }
+
+        try {
+            id.read(file);
+            image = new PImage(file);
+            _file_ids[image] = id;
+            _stats.decodes++;
+        } catch (LoadException&) {
+            image = nullptr;
+        }
+    }
+    return image;
+}
+
 /**
  * Return image to handler, removes entry if it is the last refernce.
  */
@@ -153,6 +244,154 @@ ImageHandler::takeOwnership(PImage *image)
     _images.emplace(std::make_pair(key, Util::RefEntry<PImage*>(image)));
 }
 
+/**
+ * Start decoding files in background threads, making the images
+ * available to getImage without decoding them when requested. Files
+ * are resolved using the current search path.
+ *
+ * Only one set of files can be prefetched at a time, prefetchDone must
+ * be called before calling prefetch again.
+ */
+void
+ImageHandler::prefetch(const std::vector<std::string> &files)
+{
+    prefetchDone();
+
+    for (auto &file : files) {
+        auto real_file = file.substr(0, file.rfind('#'));
+        if (real_file.empty()) {
+            continue;
+        }
+
+        // XPM images are loaded using libXpm which is not thread safe.
+        auto ext = Util::getFileExt(real_file);
+        if (! strcasecmp(ext.c_str(), "xpm")) {
+            continue;
+        }
+
+        std::string path;
+        if (real_file[0] == '/') {
+            path = real_file;
+        } else {
+            auto it(_search_path.rbegin());
+            for (; it != _search_path.rend(); ++it) {
+                if (Util::isFile(*it + real_file)) {
+                    path = *it + real_file;
+                    break;
+                }
+            }
+        }
+
+        if (path.empty() || _prefetch_index.count(path)
+            || _images.get(path).get()) {
+            continue;
+        }
+        _prefetch_index[path] = _prefetch.size();
+        _prefetch.push_back(Prefetch(path));
+    }
+
+    size_t num_threads = std::thread::hardware_concurrency();
+    num_threads = std::max(size_t(1),
+                           std::min(num_threads,
+                                    size_t(IMAGE_PREFETCH_MAX_THREADS)));
+    num_threads = std::min(num_threads, _prefetch.size());
+    for (size_t i = 0; i < num_threads; i++) {
+        try {
+            _prefetch_threads.push_back(
+                std::thread(&ImageHandler::prefetchWorker, this));
+        } catch (std::system_error &ex) {
+            WARN("failed to start image prefetch thread: " << ex.what());
+            break;
+        }
+    }
+
+    if (_prefetch_threads.empty()) {
+        // no threads, images are loaded when requested
+        _prefetch.clear();
+        _prefetch_index.clear();
+    }
+}
+
+/**
+ * Wait for the prefetch threads to finish, images decoded but not
+ * requested are deleted.
+ */
+void
+ImageHandler::prefetchDone(void)
+{
+    for (auto &thread : _prefetch_threads) {
+        thread.join();
+    }
+    _prefetch_threads.clear();
+
+    for (auto &it : _prefetch) {
+        if (! it.taken) {
+            delete it.image;
+        }
+    }
+    _prefetch.clear();
+    _prefetch_index.clear();
+    _prefetch_next = 0;
+}
+
+/**
+ * Take image decoded by prefetch threads, waits for the image to be
+ * decoded if it is still in progress.
+ *
+ * @return true if file was prefetched, image is nullptr if it failed
+ *         to load.
+ */
+bool
+ImageHandler::takePrefetched(const std::string &file, PImage *&image,
+                             FileId &id)
+{
+    auto it = _prefetch_index.find(file);
+    if (it == _prefetch_index.end()) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(_prefetch_mutex);
+    Prefetch &prefetch = _prefetch[it->second];
+    if (prefetch.taken) {
+        return false;
+    }
+    _prefetch_cond.wait(lock, [&prefetch] { return prefetch.done; });
+
+    prefetch.taken = true;
+    image = prefetch.image;
+    id = prefetch.id;
+    return true;
+}
+
+/**
+ * Decode prefetch entries until all have been started.
+ */
+void
+ImageHandler::prefetchWorker(void)
+{
+    std::unique_lock<std::mutex> lock(_prefetch_mutex);
+    while (_prefetch_next < _prefetch.size()) {
+        size_t i = _prefetch_next++;
+        std::string file = _prefetch[i].file;
+        lock.unlock();
+
+        FileId id;
+        PImage *image;
+        try {
+            id.read(file);
+            image = new PImage(file);
+        } catch (LoadException&) {
+            image = nullptr;
+        }
+
+        lock.lock();
+        _prefetch[i].id = id;
+        _prefetch[i].image = image;
+        _prefetch[i].done = true;
+        _prefetch_cond.notify_all();
+    }
+}
+
 PImage*
 ImageHandler::getMappedImage(const std::string &file,
                              const std::string &colormap)
@@ -163,13 +402,57 @@ ImageHandler::getMappedImage(const std::string &file,
     }
 
     uint ref;
-    auto image = getImage(file, ref, _images_mapped[colormap]);
-    if (ref == 1) {
-        // new image, requires color mapping.
-        mapColors(image, _color_maps.get(colormap));
+    return getImage(file, ref, _images_mapped[colormap],
+                    &_color_maps.get(colormap));
+}
+
+/**
+ * Clear color maps, the cleared color maps are kept to detect changes
+ * when added again.
+ */
+void
+ImageHandler::clearColorMaps(void)
+{
+    for (auto &it : _color_maps) {
+        _color_maps_cleared[it.first] = it.second;
     }
+    _color_maps.clear();
+    _color_maps.emplace(std::make_pair("", std::map<int,int>()));
+}
 
-    return image;
+/**
+ * Add color map, unused images mapped with a previous version of the
+ * color map, current or cleared, are dropped.
+ */
+void
+ImageHandler::addColorMap(const std::string& name,
+                          std::map<int,int> color_map)
+{
+    auto it = _color_maps.find(name);
+    bool changed = it != _color_maps.end() && it->second != color_map;
+    auto cit = _color_maps_cleared.find(name);
+    if (cit != _color_maps_cleared.end()) {
+        changed = changed || cit->second != color_map;
+        _color_maps_cleared.erase(cit);
+    }
+
+    if (changed) {
+        auto mit = _images_mapped.find(name);
+        if (mit != _images_mapped.end()) {
+            clearUnused(&mit->second);
+        }
+    }
+    _color_maps[name] = color_map;
+}
+
+/**
+ * Set max number of bytes used by images without references.
+ */
+void
+ImageHandler::setCacheSize(size_t size)
+{
+    _cache_size = size;
+    evictImages(0);
 }
 
 /**
@@ -198,16 +481,33 @@ ImageHandler::returnMappedImage(PImage *image, const std::string &colormap)
     returnImage(image, _images_mapped[colormap]);
 }
 
+/**
+ * Return image to images, images loaded from file without references
+ * are kept for re-use as long as they fit in the cache size.
+ */
 void
-ImageHandler::returnImage(PImage *image,
-                          Util::StringMap<Util::RefEntry<PImage*>> &images)
+ImageHandler::returnImage(PImage *image, image_map &images)
 {
+    if (image == nullptr) {
+        return;
+    }
+
     auto it = images.begin();
     for (; it != images.end(); ++it) {
         if (it->second.get() == image) {
             if (it->second.decRef() == 0) {
-                delete it->second.get();
-                images.erase(it);
+                size_t bytes = image->getWidth() * image->getHeight() * 4;
+                if (_file_ids.count(image) && bytes <= _cache_size) {
+                    evictImages(bytes);
+                    _unused.push_front(Unused{image, &images,
+                                              it->first.str(), bytes});
+                    _stats.unused++;
+                    _stats.unused_bytes += bytes;
+                } else {
+                    _file_ids.erase(image);
+                    delete image;
+                    images.erase(it);
+                }
             }
             return;
         }
@@ -216,3 +516,82 @@ ImageHandler::returnImage(PImage *image,
     ERR("returned image " << image << " not found in handler");
     delete image;
 }
+
+/**
+ * Remove image from the unused images if the file it was loaded from
+ * is unchanged.
+ *
+ * @return true if the image can be used.
+ */
+bool
+ImageHandler::reviveImage(PImage *image, const std::string &file)
+{
+    FileId id;
+    if (! id.read(file) || ! (id == _file_ids[image])) {
+        return false;
+    }
+
+    for (auto it = _unused.begin(); it != _unused.end(); ++it) {
+        if (it->image == image) {
+            _stats.unused--;
+            _stats.unused_bytes -= it->bytes;
+            _unused.erase(it);
+            break;
+        }
+    }
+    _stats.revived++;
+    return true;
+}
+
+/**
+ * Delete least recently used unused images until size bytes fits in
+ * the cache.
+ */
+void
+ImageHandler::evictImages(size_t size)
+{
+    while (! _unused.empty() && _stats.unused_bytes + size > _cache_size) {
+        Unused unused = _unused.back();
+        deleteImage(unused.image, *unused.images, unused.file);
+        _stats.evictions++;
+    }
+}
+
+/**
+ * Delete unused images from images, all unused images if images is
+ * nullptr.
+ */
+void
+ImageHandler::clearUnused(image_map *images)
+{
+    auto it = _unused.begin();
+    while (it != _unused.end()) {
+        auto next = std::next(it);
+        if (images == nullptr || it->images == images) {
+            deleteImage(it->image, *it->images, it->file);
+        }
+        it = next;
+    }
+}
+
+/**
+ * Delete image without references.
+ */
+void
+ImageHandler::deleteImage(PImage *image, image_map &images,
+                          const std::string &file)
+{
+    // file might be owned by the unused entry
+    std::string key(file);
+    for (auto it = _unused.begin(); it != _unused.end(); ++it) {
+        if (it->image == image) {
+            _stats.unused--;
+            _stats.unused_bytes -= it->bytes;
+            _unused.erase(it);
+            break;
+        }
+    }
+    _file_ids.erase(image);
+    images.erase(key);
+    delete image;
+}
@@ -10,12 +10,23 @@
 
 #include "config.h"
 
+#include "ImageDiskCache.hh"
 #include "PImage.hh"
 #include "Util.hh"
 
+#include <condition_variable>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+extern "C" {
+#include <sys/types.h>
+}
+
 class PImage;
 
 /**
@@ -23,6 +34,34 @@ class PImage;
  */
 class ImageHandler {
 public:
+    class Stats {
+    public:
+        Stats(void)
+            : decodes(0),
+              mapped(0),
+              revived(0),
+              evictions(0),
+              unused(0),
+              unused_bytes(0),
+              prefetched(0)
+        {
+        }
+
+        /** Images loaded from disk. */
+        ulong decodes;
+        /** Color mapped images created from a loaded image. */
+        ulong mapped;
+        /** Unused images returned again without loading. */
+        ulong revived;
+        ulong evictions;
+        ulong unused;
+        size_t unused_bytes;
+        /** Images decoded by prefetch threads. */
+        ulong prefetched;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
     ImageHandler(void);
     ~ImageHandler(void);
 
@@ -40,28 +79,89 @@ public:
 
     void takeOwnership(PImage *image);
 
+    void prefetch(const std::vector<std::string> &files);
+    void prefetchDone(void);
+
     PImage *getMappedImage(const std::string &file,
                            const std::string& colormap);
     void returnMappedImage(PImage *image, const std::string& colormap);
 
-    void clearColorMaps(void) {
-        _color_maps.clear();
-        _color_maps.emplace(std::make_pair("", std::map<int,int>()));
-    }
-    void addColorMap(const std::string& name, std::map<int,int> color_map) {
-        _color_maps[name] = color_map;
-    }
+    void clearColorMaps(void);
+    void addColorMap(const std::string& name, std::map<int,int> color_map);
+
+    /** Set max number of bytes used by unused images. */
+    void setCacheSize(size_t size);
+    const Stats &getStats(void) const { return _stats; }
+    ImageDiskCache &getDiskCache(void) { return _disk_cache; }
 
 private:
+    typedef Util::StringMap<Util::RefEntry<PImage*>> image_map;
+
+    /** Identity of an image file, used to detect changed files. */
+    class FileId {
+    public:
+        FileId(void) : mtime(0), mtime_nsec(0), size(0) { }
+
+        bool read(const std::string &file);
+        bool operator==(const FileId &rhs) const {
+            return mtime == rhs.mtime && mtime_nsec == rhs.mtime_nsec
+                && size == rhs.size;
+        }
+
+        time_t mtime;
+        /** Nanoseconds of mtime, 0 if not supported. */
+        long mtime_nsec;
+        off_t size;
+    };
+
+    /** Image without references, kept for re-use. */
+    class Unused {
+    public:
+        PImage *image;
+        image_map *images;
+        std::string file;
+        size_t bytes;
+    };
+
+    /** Image file decoded by a prefetch thread. */
+    class Prefetch {
+    public:
+        Prefetch(const std::string &_file)
+            : file(_file),
+              image(nullptr),
+              done(false),
+              taken(false)
+        {
+        }
+
+        std::string file;
+        FileId id;
+        PImage *image;
+        bool done;
+        bool taken;
+    };
+
     PImage *getImage(const std::string &file, uint &ref,
-                     Util::StringMap<Util::RefEntry<PImage*>> &images);
+                     image_map &images,
+                     const std::map<int, int> *color_map);
     PImage *getImageFromPath(const std::string &file, uint &ref,
-                             Util::StringMap<Util::RefEntry<PImage*>> &images);
+                             image_map &images,
+                             const std::map<int, int> *color_map);
+    PImage *loadImage(const std::string &file,
+                      const std::map<int, int> *color_map);
+
+    bool takePrefetched(const std::string &file, PImage *&image, FileId &id);
+    void prefetchWorker(void);
 
     void mapColors(PImage *image, const std::map<int,int> &color_map);
 
-    static void returnImage(PImage *image,
-                            Util::StringMap<Util::RefEntry<PImage*>> &images);
+    void returnImage(PImage *image, image_map &images);
+    bool reviveImage(PImage *image, const std::string &file);
+    void evictImages(size_t size);
+    void clearUnused(image_map *images);
+    void deleteImage(PImage *image, image_map &images,
+                     const std::string &file);
+
 private:
 
     /** List of directories to search. */
@@ -72,6 +172,33 @@ private:
     Util::StringMap<Util::StringMap<Util::RefEntry<PImage*>>> _images_mapped;
 
     Util::StringMap<std::map<int, int>> _color_maps;
+    /** Color maps cleared but not added again, unused mapped images
+        are checked against these when the color map is added. */
+    Util::StringMap<std::map<int, int>> _color_maps_cleared;
+
+    /** File identity of loaded images, read when loaded. */
+    std::map<PImage*, FileId> _file_ids;
+    /** Images without references, most recently used first. */
+    std::list<Unused> _unused;
+    /** Max number of bytes used by unused images. */
+    size_t _cache_size;
+
+    /** Files being decoded by the prefetch threads. */
+    std::vector<Prefetch> _prefetch;
+    /** Index into _prefetch by file. */
+    std::map<std::string, size_t> _prefetch_index;
+    /** Next entry in _prefetch to decode. */
+    size_t _prefetch_next;
+    std::vector<std::thread> _prefetch_threads;
+    /** Protects _prefetch and _prefetch_next. */
+    std::mutex _prefetch_mutex;
+    /** Signalled when a prefetch entry is done. */
+    std::condition_variable _prefetch_cond;
+
+    /** Decoded and scaled images stored on disk, disabled by default. */
+    ImageDiskCache _disk_cache;
+
+    Stats _stats;
 };
 
 namespace pekwm
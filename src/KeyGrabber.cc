@@ -76,7 +76,8 @@ KeyGrabber::Chain::findAction(XKeyEvent *ev, bool &matched)
 
 //! @brief KeyGrabber constructor
 KeyGrabber::KeyGrabber(void)
-    : _menu_chain(0, 0),
+    : _hash(0),
+      _menu_chain(0, 0),
       _global_chain(0, 0), _moveresize_chain(0, 0),
       _input_dialog_chain(0, 0)
 {
@@ -115,6 +116,12 @@ KeyGrabber::load(const std::string &file, bool force)
         _cfg_files = key_cfg.getCfgFiles();
     }
 
+    auto hash = key_cfg.getEntryRoot()->getHash();
+    if (! force && hash == _hash) {
+        return false;
+    }
+    _hash = hash;
+
     CfgParser::Entry *section;
 
     section = key_cfg.getEntryRoot()->findSection("GLOBAL");
@@ -317,7 +324,7 @@ KeyGrabber::findAction(XKeyEvent *ev, KeyGrabber::Chain *chain, bool &matched)
             bool exit = false;
 
             while (! exit) {
-                XMaskEvent(X11::getDpy(), KeyPressMask, &c_ev);
+                X11::maskEvent(KeyPressMask, &c_ev);
                 X11::stripStateModifiers(&c_ev.xkey.state);
 
                 auto keysym = X11::getKeysymFromKeycode(c_ev.xkey.keycode);
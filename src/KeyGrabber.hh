@@ -84,6 +84,8 @@ private:
                             bool &matched);
 
     TimeFiles _cfg_files;
+    /** Hash of the last loaded configuration. */
+    uint64_t _hash;
 
     KeyGrabber::Chain _menu_chain;
     KeyGrabber::Chain _global_chain;
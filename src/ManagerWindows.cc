@@ -82,7 +82,7 @@ HintWO::getTime(void)
     X11::changeProperty(_window,
                         X11::getAtom(WM_CLASS), X11::getAtom(STRING),
                         8, PropModeAppend, 0, 0);
-    XWindowEvent(X11::getDpy(), _window, PropertyChangeMask, &event);
+    X11::windowEvent(_window, PropertyChangeMask, &event);
 
     return event.xproperty.time;
 }
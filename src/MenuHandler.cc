@@ -22,6 +22,7 @@
 #include "FrameListMenu.hh"
 
 TimeFiles MenuHandler::_cfg_files;
+uint64_t MenuHandler::_hash = 0;
 std::map<std::string, PMenu*> MenuHandler::_menu_map;
 
 /**
@@ -75,6 +76,7 @@ MenuHandler::createMenusLoadConfiguration(ActionHandler *act)
         || menu_cfg.parse(std::string(SYSCONFDIR "/menu"))) {
         _cfg_files = menu_cfg.getCfgFiles();
         auto root_entry = menu_cfg.getEntryRoot();
+        _hash = root_entry->getHash();
 
         // Load standard menus
         for (auto it : _menu_map) {
@@ -89,19 +91,27 @@ MenuHandler::createMenusLoadConfiguration(ActionHandler *act)
 /**
  * (re)loads the menus in the menu configuration if the file has been
  * updated since last load.
+ *
+ * @return true if menus were reloaded.
  */
-void
+bool
 MenuHandler::reloadMenus(ActionHandler *act)
 {
     std::string menu_file(pekwm::config()->getMenuFile());
     if (! _cfg_files.requireReload(menu_file)) {
-        return;
+        return false;
     }
 
     CfgParser cfg;
     bool cfg_ok = loadMenuConfig(menu_file, cfg);
     CfgParser::Entry *root = cfg.getEntryRoot();
 
+    auto hash = cfg_ok ? root->getHash() : 0;
+    if (hash && hash == _hash) {
+        return false;
+    }
+    _hash = hash;
+
     // Update, delete standalone root menus, load decors on others
     auto it(_menu_map.begin());
     while (it != _menu_map.end()) {
@@ -118,6 +128,7 @@ MenuHandler::reloadMenus(ActionHandler *act)
 
     // Update standalone root menus (name != ROOTMENU)
     reloadStandaloneMenus(act, root);
+    return true;
 }
 
 /**
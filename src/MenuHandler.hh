@@ -45,7 +45,7 @@ public:
             it.second->unmapAll();
         }
     }
-    static void reloadMenus(ActionHandler *act);
+    static bool reloadMenus(ActionHandler *act);
     static void deleteMenus(void);
 
 private:
@@ -56,6 +56,8 @@ private:
                                       CfgParser::Entry *section);
 
     static TimeFiles _cfg_files;
+    /** Hash of the last loaded configuration. */
+    static uint64_t _hash;
     /** Map from menu name to menu */
     static std::map<std::string, PMenu*> _menu_map;
 };
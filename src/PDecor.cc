@@ -160,6 +160,12 @@ const std::string PDecor::DEFAULT_DECOR_NAME_TITLEBARLESS = "TITLEBARLESS";
 const std::string PDecor::DEFAULT_DECOR_NAME_ATTENTION = "ATTENTION";
 
 std::vector<PDecor*> PDecor::_pdecors;
+TitleStats PDecor::_title_stats;
+SnapIndex PDecor::_snap_index;
+std::vector<PWinObj*> PDecor::_snap_wos;
+PWinObj *PDecor::_snap_skip_wo = nullptr;
+ulong PDecor::_snap_serial = 0;
+bool PDecor::_snap_valid = false;
 
 //! @brief PDecor constructor
 //! @param dpy Display
@@ -321,6 +327,7 @@ PDecor::~PDecor(void)
 
     // free buttons
     unloadDecor();
+    clearTitleCache();
 
     removeChildWindow(_title_wo.getWindow());
     X11::destroyWindow(_title_wo.getWindow());
@@ -522,6 +529,17 @@ PDecor::lower(void)
     }
 }
 
+/**
+ * Set layer, keeping the layer index of the stacking list up to
+ * date.
+ */
+void
+PDecor::setLayer(Layer layer)
+{
+    PWinObj::setLayer(layer);
+    Workspaces::updateLayer(this);
+}
+
 void
 PDecor::setFocused(bool focused)
 {
@@ -860,6 +878,7 @@ void
 PDecor::loadDecor(void)
 {
     unloadDecor();
+    clearTitleCache();
     setDataFromDecorName(_decor_name);
 
     // Load decor.
@@ -1225,6 +1244,7 @@ void
 PDecor::setSkip(uint skip)
 {
     _skip = skip;
+    woChanged();
 }
 
 /**
@@ -1270,57 +1290,145 @@ PDecor::renderTitle(void)
         calcTabsWidth();
     }
 
-    auto t_sep = _data->getTextureSeparator(getFocusedState(false));
-    auto title_bg = X11::createPixmap(_title_wo.getWidth(),
-                                      _title_wo.getHeight());
-    // Render main background on pixmap
-    auto t_main = _data->getTextureMain(getFocusedState(false));
-    t_main->render(title_bg, 0, 0,
-                   _title_wo.getWidth(), _title_wo.getHeight());
+    _title_stats.renders++;
 
-    PFont *font;
-    bool sel; // Current tab selected flag
+    auto state = getFocusedState(false);
+    auto t_sep = _data->getTextureSeparator(state);
+    uint size = _titles.size();
     uint x = _titles_left; // Position
-    // Amount of horizontal padding
-    uint pad_horiz =  _data->getPad(PAD_LEFT) + _data->getPad(PAD_RIGHT);
 
-    uint size = _titles.size();
+    _title_tabs.resize(size);
     for (uint i = 0; i < size; ++i) {
-        sel = (_title_active == i);
+        TitleTab &tab = _title_tabs[i];
+        tab.x = x;
+        tab.width = _titles[i]->getWidth();
+        tab.state = getFocusedState(_title_active == i);
+        tab.trim_end = _titles[i]->isCustom() || _titles[i]->isUserSet();
+        tab.text = _titles[i]->getVisible();
 
-        // render tab
-        auto tab = _data->getTextureTab(getFocusedState(sel));
-        tab->render(title_bg, x, 0,
-                    _titles[i]->getWidth(), _title_wo.getHeight());
+        // move to next tab (or separator if any)
+        x += tab.width;
+        if (size > 1 && i < size - 1) {
+            x += t_sep->getWidth();
+        }
+    }
 
-        font = getFont(getFocusedState(sel));
-        font->setColor(_data->getFontColor(getFocusedState(sel)));
+    TitleCache &cache = _title_cache[state];
+    bool full = cache.title == None
+        || cache.width != _title_wo.getWidth()
+        || cache.height != _title_wo.getHeight()
+        || cache.data != _data
+        || cache.tabs.size() != size;
+    for (uint i = 0; ! full && i < size; ++i) {
+        full = ! cache.tabs[i].isSameArea(_title_tabs[i]);
+    }
 
-        auto trim = PFont::FONT_TRIM_MIDDLE;
-        if (_titles[i]->isCustom() || _titles[i]->isUserSet()) {
-            trim = PFont::FONT_TRIM_END;
+    if (full) {
+        _title_stats.full++;
+        renderTitleFull(cache, state);
+    } else {
+        bool changed = false;
+        for (uint i = 0; i < size; ++i) {
+            if (cache.tabs[i] != _title_tabs[i]) {
+                _title_stats.tabs++;
+                renderTitleTab(cache, _title_tabs[i]);
+                cache.tabs[i] = _title_tabs[i];
+                changed = true;
+            }
+        }
+        if (! changed) {
+            _title_stats.cached++;
         }
+    }
+
+    // the background pixmap is set even if it is unchanged, the
+    // server may have copied it when it was set.
+    X11::setWindowBackgroundPixmap(_title_wo.getWindow(), cache.title);
+    X11::clearWindow(_title_wo.getWindow());
+}
 
-        font->draw(title_bg,
-                   x + _data->getPad(PAD_LEFT), // X position
-                   _data->getPad(PAD_UP), // Y position
-                   _titles[i]->getVisible(), 0, // Text and max chars
-                   _titles[i]->getWidth() - pad_horiz, // Available width
-                   trim); // Type of trim
+/**
+ * Render main texture, tabs and separators of the title in
+ * _title_tabs to cache.
+ */
+void
+PDecor::renderTitleFull(TitleCache &cache, FocusedState state)
+{
+    uint width = _title_wo.getWidth();
+    uint height = _title_wo.getHeight();
+    if (cache.width != width || cache.height != height) {
+        X11::freePixmap(cache.main);
+        X11::freePixmap(cache.title);
+    }
+    if (cache.title == None) {
+        cache.main = X11::createPixmap(width, height);
+        cache.title = X11::createPixmap(width, height);
+    }
+    cache.width = width;
+    cache.height = height;
+    cache.data = _data;
 
-        // move to next tab (or separator if any)
-        x += _titles[i]->getWidth();
+    // Render main background on pixmap
+    auto t_main = _data->getTextureMain(state);
+    t_main->render(cache.main, 0, 0, width, height);
+    XCopyArea(X11::getDpy(), cache.main, cache.title, X11::getGC(),
+              0, 0, width, height, 0, 0);
+
+    auto t_sep = _data->getTextureSeparator(state);
+    uint size = _title_tabs.size();
+    for (uint i = 0; i < size; ++i) {
+        const TitleTab &tab = _title_tabs[i];
+        renderTitleTab(cache, tab);
 
         // draw separator
         if (size > 1 && i < size - 1) {
-            t_sep->render(title_bg, x, 0, 0, 0);
-            x += t_sep->getWidth();
+            t_sep->render(cache.title, tab.x + tab.width, 0, 0, 0);
         }
     }
+    cache.tabs = _title_tabs;
+}
 
-    X11::setWindowBackgroundPixmap(_title_wo.getWindow(), title_bg);
-    X11::clearWindow(_title_wo.getWindow());
-    X11::freePixmap(title_bg);
+/**
+ * Render tab texture and text of tab on top of the main texture.
+ */
+void
+PDecor::renderTitleTab(TitleCache &cache, const TitleTab &tab)
+{
+    XCopyArea(X11::getDpy(), cache.main, cache.title, X11::getGC(),
+              tab.x, 0, tab.width, cache.height, tab.x, 0);
+
+    auto t_tab = _data->getTextureTab(tab.state);
+    t_tab->render(cache.title, tab.x, 0, tab.width, cache.height);
+
+    PFont *font = getFont(tab.state);
+    font->setColor(_data->getFontColor(tab.state));
+
+    // Amount of horizontal padding
+    uint pad_horiz =  _data->getPad(PAD_LEFT) + _data->getPad(PAD_RIGHT);
+    font->draw(cache.title,
+               tab.x + _data->getPad(PAD_LEFT), // X position
+               _data->getPad(PAD_UP), // Y position
+               tab.text, 0, // Text and max chars
+               tab.width - pad_horiz, // Available width
+               tab.trim_end
+               ? PFont::FONT_TRIM_END
+               : PFont::FONT_TRIM_MIDDLE); // Type of trim
+}
+
+/**
+ * Free rendered titles, must be called when the decor data changes.
+ */
+void
+PDecor::clearTitleCache(void)
+{
+    for (auto &cache : _title_cache) {
+        X11::freePixmap(cache.main);
+        X11::freePixmap(cache.title);
+        cache.width = 0;
+        cache.height = 0;
+        cache.data = nullptr;
+        cache.tabs.clear();
+    }
 }
 
 void
@@ -1409,11 +1517,9 @@ isBetween(int x1, int x2, int t1, int t2)
     return false;
 }
 
-//! @todo PDecor/PWinObj doesn't have _skip property
 void
 PDecor::checkWOSnap(PWinObj *skip_wo, Geometry &gm)
 {
-    PDecor *decor;
     Geometry orig_gm = gm;
 
     int x = gm.x + gm.width;
@@ -1424,47 +1530,41 @@ PDecor::checkWOSnap(PWinObj *skip_wo, Geometry &gm)
 
     bool snapped;
 
-    auto it = _wo_list.rbegin();
-    for (; it != _wo_list.rend(); ++it) {
-        if (((*it) == skip_wo)
-            || ! (*it)->isMapped()
-            || ((*it)->getType() != PWinObj::WO_FRAME)) {
-            continue;
-        }
-
-        // Skip snapping, only valid on PDecor and up.
-        decor = dynamic_cast<PDecor*>(*it);
-        if (decor && decor->isSkip(SKIP_SNAP)) {
-            continue;
-        }
+    // only frames with an edge close enough to snap are checked, in
+    // the same order as the full list would be.
+    updateSnapIndex(skip_wo);
+    static std::vector<size_t> entries;
+    _snap_index.find(gm, attract, resist, entries);
 
+    for (auto entry : entries) {
+        PWinObj *wo = _snap_wos[entry];
         snapped = false;
 
         // check snap
-        if ((x >= ((*it)->getX() - attract))
-            && (x <= ((*it)->getX() + resist))) {
-            if (isBetween(gm.y, y, (*it)->getY(), (*it)->getBY())) {
-                gm.x = (*it)->getX() - orig_gm.width;
+        if ((x >= (wo->getX() - attract))
+            && (x <= (wo->getX() + resist))) {
+            if (isBetween(gm.y, y, wo->getY(), wo->getBY())) {
+                gm.x = wo->getX() - orig_gm.width;
                 snapped = true;
             }
-        } else if ((gm.x >= signed((*it)->getRX() - resist)) &&
-                   (gm.x <= signed((*it)->getRX() + attract))) {
-            if (isBetween(gm.y, y, (*it)->getY(), (*it)->getBY())) {
-                gm.x = (*it)->getRX();
+        } else if ((gm.x >= signed(wo->getRX() - resist)) &&
+                   (gm.x <= signed(wo->getRX() + attract))) {
+            if (isBetween(gm.y, y, wo->getY(), wo->getBY())) {
+                gm.x = wo->getRX();
                 snapped = true;
             }
         }
 
-        if (y >= ((*it)->getY() - attract) && (y <= (*it)->getY() + resist)) {
-            if (isBetween(gm.x, x, (*it)->getX(), (*it)->getRX())) {
-                gm.y = (*it)->getY() - orig_gm.height;
+        if (y >= (wo->getY() - attract) && (y <= wo->getY() + resist)) {
+            if (isBetween(gm.x, x, wo->getX(), wo->getRX())) {
+                gm.y = wo->getY() - orig_gm.height;
                 if (snapped)
                     break;
             }
-        } else if ((gm.y >= signed((*it)->getBY() - resist)) &&
-                   (gm.y <= signed((*it)->getBY() + attract))) {
-            if (isBetween(gm.x, x, (*it)->getX(), (*it)->getRX())) {
-                gm.y = (*it)->getBY();
+        } else if ((gm.y >= signed(wo->getBY() - resist)) &&
+                   (gm.y <= signed(wo->getBY() + attract))) {
+            if (isBetween(gm.x, x, wo->getX(), wo->getRX())) {
+                gm.y = wo->getBY();
                 if (snapped)
                     break;
             }
@@ -1472,6 +1572,49 @@ PDecor::checkWOSnap(PWinObj *skip_wo, Geometry &gm)
     }
 }
 
+/**
+ * Rebuild the index of frames to snap against if any PWinObj has been
+ * mapped, unmapped or changed geometry since it was built. The index
+ * is kept during interactive moves where only the frame being moved,
+ * skip_wo, changes.
+ */
+void
+PDecor::updateSnapIndex(PWinObj *skip_wo)
+{
+    if (_snap_valid
+        && _snap_skip_wo == skip_wo
+        && _snap_serial == PWinObj::getSerial()) {
+        return;
+    }
+
+    _snap_index.clear();
+    _snap_wos.clear();
+
+    Geometry gm;
+    auto it = _wo_list.rbegin();
+    for (; it != _wo_list.rend(); ++it) {
+        if (((*it) == skip_wo)
+            || ! (*it)->isMapped()
+            || ((*it)->getType() != PWinObj::WO_FRAME)) {
+            continue;
+        }
+
+        // Skip snapping, only valid on PDecor and up.
+        PDecor *decor = static_cast<PDecor*>(*it);
+        if (decor->isSkip(SKIP_SNAP)) {
+            continue;
+        }
+
+        (*it)->getGeometry(gm);
+        _snap_index.add(gm);
+        _snap_wos.push_back(*it);
+    }
+
+    _snap_valid = true;
+    _snap_skip_wo = skip_wo;
+    _snap_serial = PWinObj::getSerial();
+}
+
 //! @brief Snaps decor agains head edges. Only updates _gm, no real move.
 //! @todo Add support for checking for harbour and struts
 void
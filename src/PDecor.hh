@@ -12,6 +12,7 @@
 
 #include "Config.hh"
 #include "PWinObj.hh"
+#include "SnapIndex.hh"
 #include "ThemeGm.hh"
 
 class ActionEvent;
@@ -28,6 +29,38 @@ public:
     Visual *visual;
 };
 
+/**
+ * Statistics for title rendering.
+ */
+class TitleStats {
+public:
+    TitleStats(void)
+        : renders(0),
+          full(0),
+          tabs(0),
+          cached(0)
+    {
+    }
+
+    /** Number of renderTitle calls. */
+    ulong renders;
+    /** Renders where the whole title was rendered. */
+    ulong full;
+    /** Number of tabs rendered in renders updating single tabs. */
+    ulong tabs;
+    /** Renders where the cached title was used as is. */
+    ulong cached;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const TitleStats &stats) {
+        os << "renders " << stats.renders
+           << " full " << stats.full
+           << " tabs " << stats.tabs
+           << " cached " << stats.cached;
+        return os;
+    }
+};
+
 //! @brief PWinObj container class with fancy decor.
 class PDecor : public PWinObj,
                public ThemeGm,
@@ -132,6 +165,7 @@ public:
     virtual void moveResize(int x, int y, uint width, uint height) override;
     virtual void raise(void) override;
     virtual void lower(void) override;
+    virtual void setLayer(Layer layer) override;
 
     void moveResize(const Geometry &geometry, int gm_mask);
 
@@ -304,6 +338,8 @@ public:
     void drawOutline(const Geometry &gm);
     static void checkSnap(PWinObj *skip_wo, Geometry &gm);
 
+    static const TitleStats &getTitleStats(void) { return _title_stats; }
+
 protected:
     // START - PDecor interface.
     virtual void renderTitle(void);
@@ -334,6 +370,7 @@ protected:
 
     static void checkWOSnap(PWinObj *skip_wo, Geometry &gm);
     static void checkEdgeSnap(Geometry &gm);
+    static void updateSnapIndex(PWinObj *skip_wo);
 
     void alignChild(PWinObj *child);
 
@@ -347,6 +384,57 @@ protected:
     }
 
 private:
+    /** Tab as rendered in a cached title. */
+    class TitleTab {
+    public:
+        uint x;
+        uint width;
+        FocusedState state;
+        bool trim_end;
+        std::wstring text;
+
+        bool isSameArea(const TitleTab &tab) const {
+            return x == tab.x && width == tab.width;
+        }
+        bool operator==(const TitleTab &tab) const {
+            return isSameArea(tab) && state == tab.state
+                && trim_end == tab.trim_end && text == tab.text;
+        }
+        bool operator!=(const TitleTab &tab) const {
+            return ! (*this == tab);
+        }
+    };
+
+    /**
+     * Title rendered for a focused state, a focus change only
+     * requires the window background to be changed and title changes
+     * only re-render the changed tabs.
+     */
+    class TitleCache {
+    public:
+        TitleCache(void)
+            : main(None),
+              title(None),
+              width(0),
+              height(0),
+              data(nullptr)
+        {
+        }
+
+        /** Main texture. */
+        Pixmap main;
+        /** Main texture with tabs, separators and text. */
+        Pixmap title;
+        uint width;
+        uint height;
+        Theme::PDecorData *data;
+        std::vector<TitleTab> tabs;
+    };
+
+    void renderTitleFull(TitleCache &cache, FocusedState state);
+    void renderTitleTab(TitleCache &cache, const TitleTab &tab);
+    void clearTitleCache(void);
+
     void init(Window child_window);
 
     void createParentWindow(CreateWindowParams &params, Window child_window);
@@ -442,6 +530,22 @@ private:
     uint _title_active;
     std::vector<PDecor::TitleItem*> _titles;
     uint _titles_left, _titles_right; // area where to put titles
+    /** Rendered titles, focused and unfocused. */
+    TitleCache _title_cache[FOCUSED_STATE_FOCUSED_SELECTED];
+    /** Tabs of the title being rendered, re-used between renders. */
+    std::vector<TitleTab> _title_tabs;
+
+    static TitleStats _title_stats;
 
     static std::vector<PDecor*> _pdecors; /**< List of all PDecors */
+
+    /** Edges of frames to snap against, in checkWOSnap order. */
+    static SnapIndex _snap_index;
+    /** Frames in _snap_index, in the same order. */
+    static std::vector<PWinObj*> _snap_wos;
+    /** Frame skipped when building _snap_index. */
+    static PWinObj *_snap_skip_wo;
+    /** PWinObj serial _snap_index was built at. */
+    static ulong _snap_serial;
+    static bool _snap_valid;
 };
@@ -8,6 +8,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 
@@ -102,7 +103,19 @@ PFont::trim(std::wstring &text, PFont::TrimType trim_type, uint max_width)
 void
 PFont::trimEnd(std::wstring &text, uint max_width)
 {
-    for (uint i = text.size(); i > 0; --i) {
+    // widths[i] is the width of the first i characters, search for
+    // the longest prefix fitting and verify the width as fonts might
+    // not be strictly additive.
+    std::vector<uint> widths;
+    getPrefixWidths(text, widths);
+    uint limit = max_width - std::min(max_width, _offset_x);
+    auto it = std::upper_bound(widths.begin() + 1, widths.end(), limit);
+    uint i = std::distance(widths.begin(), it) - 1;
+    if (i == 0) {
+        i = 1;
+    }
+
+    for (; i > 0; --i) {
         if (getWidth(text, i) <= max_width) {
             text = text.substr(0, i);
             break;
@@ -114,10 +127,19 @@ PFont::trimEnd(std::wstring &text, uint max_width)
 void
 PFont::trimMiddle(std::wstring &text, uint max_width)
 {
+    if (text.empty()) {
+        return;
+    }
+
+    std::vector<uint> widths;
+    getPrefixWidths(text, widths);
+    std::vector<uint> sep_widths;
+    getPrefixWidths(_trim_string, sep_widths);
+
     // Get max and separator width
     uint max_side = (max_width / 2);
-    uint sep_width = getWidth(_trim_string.c_str(),
-                            _trim_string.size() / 2 + _trim_string.size() % 2);
+    uint sep_width = _offset_x
+        + sep_widths[_trim_string.size() / 2 + _trim_string.size() % 2];
 
     uint pos = 0;
     std::wstring dest;
@@ -129,23 +151,28 @@ PFont::trimMiddle(std::wstring &text, uint max_width)
     // Add space for the trim string
     max_side -= sep_width;
 
-    // Get numbers of chars before trim string (..)
-    for (uint i = text.size(); i > 0; --i) {
-        if (getWidth(text, i) < max_side) {
-            pos = i;
-            dest.insert(0, text.substr(0, i));
-            break;
-        }
+    // Get numbers of chars before trim string (..), the longest prefix
+    // narrower than max_side.
+    uint limit = max_side - std::min(max_side, _offset_x);
+    auto it = std::lower_bound(widths.begin() + 1, widths.end(), limit);
+    pos = std::distance(widths.begin(), it) - 1;
+    if (pos > 0) {
+        dest.insert(0, text.substr(0, pos));
     }
-    
-    // get numbers of chars after ...
+
+    // get numbers of chars after ..., the longest suffix narrower
+    // than max_side.
     if (pos < text.size()) {
-        for (uint i = pos; i < text.size(); ++i) {
-            std::wstring second_part(text.substr(i, text.size() - i));
-            if (getWidth(second_part, 0) < max_side) {
-                dest.insert(dest.size(), second_part);
-                break;
-            }
+        uint total = widths.back();
+        uint i = pos;
+        if (total >= limit) {
+            it = std::upper_bound(widths.begin() + pos,
+                                  widths.begin() + text.size(),
+                                  total - limit);
+            i = std::distance(widths.begin(), it);
+        }
+        if (i < text.size()) {
+            dest.insert(dest.size(), text.substr(i));
         }
 
         // Got a char after and before, if not do nothing and trimEnd will handle
@@ -161,6 +188,37 @@ PFont::trimMiddle(std::wstring &text, uint max_width)
     }
 }
 
+/**
+ * Get width of chr, without offset, cached per font.
+ */
+uint
+PFont::getCharWidth(wchar_t chr)
+{
+    auto it = _char_widths.find(chr);
+    if (it != _char_widths.end()) {
+        return it->second;
+    }
+
+    uint width = getWidth(std::wstring(1, chr));
+    width = width > _offset_x ? width - _offset_x : 0;
+    _char_widths[chr] = width;
+    return width;
+}
+
+/**
+ * Fill widths with the width, without offset, of the first i
+ * characters of text for i in 0 to text.size().
+ */
+void
+PFont::getPrefixWidths(const std::wstring &text, std::vector<uint> &widths)
+{
+    widths.resize(text.size() + 1);
+    widths[0] = 0;
+    for (uint i = 0; i < text.size(); ++i) {
+        widths[i + 1] = widths[i] + getCharWidth(text[i]);
+    }
+}
+
 void
 PFont::setTrimString(const std::string &text) {
     _trim_string = Charset::to_wide_str(text);
@@ -238,6 +296,7 @@ PFontX11::load(const std::string &font_name)
 void
 PFontX11::unload(void)
 {
+    _char_widths.clear();
     if (_font) {
         XFreeFont(X11::getDpy(), _font);
         _font = 0;
@@ -394,6 +453,7 @@ PFontXmb::load(const std::string &font_name)
 void
 PFontXmb::unload(void)
 {
+    _char_widths.clear();
     if (_fontset) {
         XFreeFontSet(X11::getDpy(), _fontset);
         _fontset = 0;
@@ -522,6 +582,7 @@ PFontXft::load(const std::string &font_name)
 void
 PFontXft::unload(void)
 {
+    _char_widths.clear();
     if (_font) {
         XftFontClose(X11::getDpy(), _font);
         _font = 0;
@@ -12,6 +12,8 @@
 
 #include <string>
 #include <limits>
+#include <unordered_map>
+#include <vector>
 
 #include "pekwm.hh"
 
@@ -96,10 +98,16 @@ private:
     virtual void drawText(Drawable dest, int x, int y, const std::wstring &text,
                         uint chars, bool fg) { }
 
+    uint getCharWidth(wchar_t chr);
+    void getPrefixWidths(const std::wstring &text, std::vector<uint> &widths);
+
 protected:
     uint _height, _ascent, _descent;
     uint _offset_x, _offset_y, _justify;
 
+    /** Width of characters, without offset, cleared on unload. */
+    std::unordered_map<wchar_t, uint> _char_widths;
+
     static std::wstring _trim_string;
 };
 
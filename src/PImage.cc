@@ -16,17 +16,44 @@
 #include "Util.hh"
 #include "X11.hh"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 extern "C" {
 #include <X11/Xutil.h>
 }
 
+ImageDiskCache *PImage::_disk_cache = nullptr;
+
+/**
+ * Return true if width x height is the size of the screen or of a
+ * head, the sizes backgrounds are scaled to.
+ */
+static bool
+isScreenSize(uint width, uint height)
+{
+    if (width == X11::getWidth() && height == X11::getHeight()) {
+        return true;
+    }
+    for (int i = 0; i < X11::getNumHeads(); i++) {
+        auto head = X11::getHeadGeometry(i);
+        if (head.width == width && head.height == height) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void
 destroyXImage(XImage *ximage)
 {
-    delete [] ximage->data;
-    ximage->data = nullptr;
+    if (! X11::isShmImage(ximage)) {
+        delete [] ximage->data;
+        ximage->data = nullptr;
+    }
     X11::destroyImage(ximage);
 }
 
@@ -93,6 +120,196 @@ getRgbFromPixel(XImage *ximage, ulong pixel, uchar &r, uchar &g, uchar &b)
     }
 }
 
+/**
+ * XImage pixel layouts with a specialized alpha blending loop.
+ */
+enum BlendFormat {
+    BLEND_FORMAT_XRGB32,
+    BLEND_FORMAT_RGB24,
+    BLEND_FORMAT_RGB565,
+    BLEND_FORMAT_RGB555,
+    BLEND_FORMAT_GENERIC
+};
+
+static bool
+isNativeByteOrder(XImage *ximage)
+{
+    static const uint16_t one = 1;
+    bool little_endian = *reinterpret_cast<const uchar*>(&one) == 1;
+    return ximage->byte_order == (little_endian ? LSBFirst : MSBFirst);
+}
+
+static BlendFormat
+getBlendFormat(XImage *ximage)
+{
+    if (ximage->format != ZPixmap) {
+        return BLEND_FORMAT_GENERIC;
+    }
+
+    if (ximage->red_mask == 0xff0000 && ximage->green_mask == 0xff00
+        && ximage->blue_mask == 0xff) {
+        if (ximage->bits_per_pixel == 32 && isNativeByteOrder(ximage)) {
+            return BLEND_FORMAT_XRGB32;
+        } else if (ximage->bits_per_pixel == 24
+                   && ximage->byte_order == LSBFirst) {
+            return BLEND_FORMAT_RGB24;
+        }
+    } else if (ximage->bits_per_pixel == 16 && isNativeByteOrder(ximage)
+               && ximage->blue_mask == 0x1f) {
+        if (ximage->red_mask == 0xf800 && ximage->green_mask == 0x07e0) {
+            return BLEND_FORMAT_RGB565;
+        } else if (ximage->red_mask == 0x7c00
+                   && ximage->green_mask == 0x3e0) {
+            return BLEND_FORMAT_RGB555;
+        }
+    }
+    return BLEND_FORMAT_GENERIC;
+}
+
+/**
+ * Blend s over d with alpha a, rounding correctly when dividing by
+ * 255.
+ */
+static inline uchar
+blendChannel(uint d, uint s, uint a)
+{
+    uint t = s * a + d * (255 - a) + 128;
+    return static_cast<uchar>((t + (t >> 8)) >> 8);
+}
+
+/**
+ * Blend src over dst, both 0x00RRGGBB, with red and blue processed at
+ * once in the lower and upper half of the value.
+ */
+static inline uint32_t
+blendXRGB(uint32_t dst, uint32_t src, uint32_t a)
+{
+    uint32_t inv = 255 - a;
+    uint32_t rb = (src & 0xff00ff) * a + (dst & 0xff00ff) * inv + 0x800080;
+    uint32_t g = (src & 0xff00) * a + (dst & 0xff00) * inv + 0x8000;
+    rb = ((rb + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+    g = ((g + ((g >> 8) & 0xff00)) >> 8) & 0xff00;
+    return rb | g;
+}
+
+static void
+blendXRGB32(XImage *src_image, XImage *dest_image,
+            uint width, uint height, const uchar *data)
+{
+    for (uint y = 0; y < height; ++y) {
+        auto src = src_image->data + y * src_image->bytes_per_line;
+        auto dest = dest_image->data + y * dest_image->bytes_per_line;
+        for (uint x = 0; x < width; ++x, data += 4) {
+            uint32_t pixel = (data[1] << 16) | (data[2] << 8) | data[3];
+            if (data[0] != 255) {
+                uint32_t d_pixel;
+                memcpy(&d_pixel, src + x * 4, sizeof(d_pixel));
+                pixel = blendXRGB(d_pixel & 0xffffff, pixel, data[0]);
+            }
+            memcpy(dest + x * 4, &pixel, sizeof(pixel));
+        }
+    }
+}
+
+/** 8 R, 8 G, 8 B packed in 3 bytes, least significant byte first. */
+class BlendRGB24 {
+public:
+    static const uint BYTES = 3;
+
+    static void get(const char *p, uchar &r, uchar &g, uchar &b) {
+        b = p[0];
+        g = p[1];
+        r = p[2];
+    }
+    static void put(char *p, uchar r, uchar g, uchar b) {
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+    }
+};
+
+/** 5 R, 6 G, 5 B (16 bit display) */
+class BlendRGB565 {
+public:
+    static const uint BYTES = 2;
+
+    static void get(const char *p, uchar &r, uchar &g, uchar &b) {
+        uint16_t pixel;
+        memcpy(&pixel, p, sizeof(pixel));
+        r = (pixel >> 8) & 0xf8;
+        g = (pixel >> 3) & 0xfc;
+        b = (pixel << 3) & 0xf8;
+    }
+    static void put(char *p, uchar r, uchar g, uchar b) {
+        uint16_t pixel = ((r << 8) & 0xf800) | ((g << 3) & 0x07e0) | (b >> 3);
+        memcpy(p, &pixel, sizeof(pixel));
+    }
+};
+
+/** 5 R, 5 G, 5 B (15 bit display) */
+class BlendRGB555 {
+public:
+    static const uint BYTES = 2;
+
+    static void get(const char *p, uchar &r, uchar &g, uchar &b) {
+        uint16_t pixel;
+        memcpy(&pixel, p, sizeof(pixel));
+        r = (pixel >> 7) & 0xf8;
+        g = (pixel >> 2) & 0xf8;
+        b = (pixel << 3) & 0xf8;
+    }
+    static void put(char *p, uchar r, uchar g, uchar b) {
+        uint16_t pixel = ((r << 7) & 0x7c00) | ((g << 2) & 0x03e0) | (b >> 3);
+        memcpy(p, &pixel, sizeof(pixel));
+    }
+};
+
+template<typename Format>
+static void
+blendRows(XImage *src_image, XImage *dest_image,
+          uint width, uint height, const uchar *data)
+{
+    for (uint y = 0; y < height; ++y) {
+        auto src = src_image->data + y * src_image->bytes_per_line;
+        auto dest = dest_image->data + y * dest_image->bytes_per_line;
+        for (uint x = 0; x < width; ++x, data += 4) {
+            uchar a = data[0], r = data[1], g = data[2], b = data[3];
+            if (a != 255) {
+                uchar d_r, d_g, d_b;
+                Format::get(src + x * Format::BYTES, d_r, d_g, d_b);
+                r = blendChannel(d_r, r, a);
+                g = blendChannel(d_g, g, a);
+                b = blendChannel(d_b, b, a);
+            }
+            Format::put(dest + x * Format::BYTES, r, g, b);
+        }
+    }
+}
+
+/**
+ * Blend using XGetPixel/XPutPixel for formats without a specialized
+ * loop.
+ */
+static void
+blendGeneric(XImage *src_image, XImage *dest_image,
+             uint width, uint height, const uchar *data)
+{
+    for (uint y = 0; y < height; ++y) {
+        for (uint x = 0; x < width; ++x, data += 4) {
+            uchar a = data[0], r = data[1], g = data[2], b = data[3];
+            if (a != 255) {
+                uchar d_r = 0, d_g = 0, d_b = 0;
+                getRgbFromPixel(src_image, XGetPixel(src_image, x, y),
+                                d_r, d_g, d_b);
+                r = blendChannel(d_r, r, a);
+                g = blendChannel(d_g, g, a);
+                b = blendChannel(d_b, b, a);
+            }
+            XPutPixel(dest_image, x, y, getPixelFromRgb(dest_image, r, g, b));
+        }
+    }
+}
+
 PImage::PImage(void)
     : _type(IMAGE_TYPE_NO),
       _pixmap(None),
@@ -131,8 +348,8 @@ PImage::PImage(PImage *image)
       _height(image->getHeight()),
       _use_alpha(image->_use_alpha)
 {
-    _data = new uchar[_width * _height];
-    memcpy(_data, image->getData(), _width * _height);
+    _data = new uchar[_width * _height * 4];
+    memcpy(_data, image->getData(), _width * _height * 4);
 }
 
 /**
@@ -180,6 +397,16 @@ PImage::load(const std::string &file)
         return false;
     }
 
+    ImageDiskCache::Source source;
+    if (_disk_cache && _disk_cache->isEnabled() && source.read(file)) {
+        _width = _height = 0;
+        _data = _disk_cache->load(source, _width, _height, _use_alpha);
+        if (_data) {
+            _source = source;
+            return true;
+        }
+    }
+
 #ifdef HAVE_IMAGE_JPEG
     if (! strcasecmp(PImageLoaderJpeg::getExt(), ext.c_str())) {
         _data = PImageLoaderJpeg::load(file, _width, _height, _use_alpha);
@@ -198,7 +425,12 @@ PImage::load(const std::string &file)
     {
         // no loader matched
     }
-    
+
+    if (_data && ! source.path.empty()) {
+        _disk_cache->save(source, false, _data, _width, _height, _use_alpha);
+        _source = source;
+    }
+
     return _data != nullptr;
 }
 
@@ -218,6 +450,7 @@ PImage::unload(void)
     if (_mask) {
         X11::freePixmap(_mask);
     }
+    _source = ImageDiskCache::Source();
 
     _pixmap = None;
     _mask = None;
@@ -373,7 +606,8 @@ PImage::scale(uint width, uint height)
         return;
     }
 
-    auto scaled_data = getScaledData(width, height);
+    auto scaled_data = getScaledData(width, height,
+                                     isScreenSize(width, height));
     if (scaled_data) {
         // Free old resources.
         unload();
@@ -413,43 +647,39 @@ PImage::drawAlphaFixed(XImage *src_image, XImage *dest_image,
 {
     // Get mask from visual
     auto visual = X11::getVisual();
-    src_image->red_mask = visual->red_mask;
-    src_image->green_mask = visual->green_mask;
-    src_image->blue_mask = visual->blue_mask;
-    dest_image->red_mask = visual->red_mask;
-    dest_image->green_mask = visual->green_mask;
-    dest_image->blue_mask = visual->blue_mask;
-
-    uchar *src = data;
-    for (uint i_y = 0; i_y < height; ++i_y) {
-        for (uint i_x = 0; i_x < width; ++i_x) {
-            // Get pixel value, copy them directly if alpha is set to 255.
-            uchar a = *src++;
-            uchar r = *src++;
-            uchar g = *src++;
-            uchar b = *src++;
-
-            // Alpha not 100% solid, blend
-            if (a != 255) {
-                // Get RGB values from pixel.
-                uchar d_r = 0, d_g = 0, d_b = 0;
-                getRgbFromPixel(src_image, XGetPixel(src_image, i_x, i_y),
-                                d_r, d_g, d_b);
+    if (visual) {
+        src_image->red_mask = visual->red_mask;
+        src_image->green_mask = visual->green_mask;
+        src_image->blue_mask = visual->blue_mask;
+        dest_image->red_mask = visual->red_mask;
+        dest_image->green_mask = visual->green_mask;
+        dest_image->blue_mask = visual->blue_mask;
+    }
 
-                float a_percent = static_cast<float>(a) / 255;
-                float a_percent_inv = 1 - a_percent;
-                r = static_cast<uchar>((a_percent_inv * d_r) + (a_percent * r));
-                g = static_cast<uchar>((a_percent_inv * d_g) + (a_percent * g));
-                b = static_cast<uchar>((a_percent_inv * d_b) + (a_percent * b));
-            }
+    auto format = getBlendFormat(src_image);
+    if (format != getBlendFormat(dest_image)) {
+        format = BLEND_FORMAT_GENERIC;
+    }
 
-            XPutPixel(dest_image, i_x, i_y,
-                      getPixelFromRgb(dest_image, r, g, b));
-        }
+    switch (format) {
+    case BLEND_FORMAT_XRGB32:
+        blendXRGB32(src_image, dest_image, width, height, data);
+        break;
+    case BLEND_FORMAT_RGB24:
+        blendRows<BlendRGB24>(src_image, dest_image, width, height, data);
+        break;
+    case BLEND_FORMAT_RGB565:
+        blendRows<BlendRGB565>(src_image, dest_image, width, height, data);
+        break;
+    case BLEND_FORMAT_RGB555:
+        blendRows<BlendRGB555>(src_image, dest_image, width, height, data);
+        break;
+    default:
+        blendGeneric(src_image, dest_image, width, height, data);
+        break;
     }
 }
 
-
 /**
  * Draw image at position, not scaling.
  */
@@ -481,7 +711,8 @@ void
 PImage::drawScaled(Render &rend, int x, int y, uint width, uint height)
 {
     // Create scaled representation of image.
-    auto scaled_data = getScaledData(width, height);
+    auto scaled_data = getScaledData(width, height,
+                                     isScreenSize(width, height));
     if (scaled_data) {
         auto ximage = createXImage(scaled_data, width, height);
         delete [] scaled_data;
@@ -534,7 +765,8 @@ PImage::drawTiled(Render &rend, int x, int y, uint width, uint height)
 void
 PImage::drawAlphaScaled(Render &rend, int x, int y, uint width, uint height)
 {
-    auto scaled_data = getScaledData(width, height);
+    auto scaled_data = getScaledData(width, height,
+                                     isScreenSize(width, height));
     if (scaled_data) {
         drawAlphaFixed(rend, x, y, width, height, scaled_data);
         delete [] scaled_data;
@@ -637,15 +869,19 @@ PImage::createMask(uchar* data, uint width, uint height)
 XImage*
 PImage::createXImage(uchar* data, uint width, uint height)
 {
-    // Create XImage
-    auto ximage = X11::createImage(nullptr, width, height);
+    // Create XImage, large images are transferred using shared memory
+    // if available.
+    auto ximage = X11::createShmImage(width, height);
     if (! ximage) {
-        ERR("failed to create XImage " << width << "x" << height);
-        return nullptr;
-    }
+        ximage = X11::createImage(nullptr, width, height);
+        if (! ximage) {
+            ERR("failed to create XImage " << width << "x" << height);
+            return nullptr;
+        }
 
-    // Allocate ximage data storage.
-    ximage->data = new char[ximage->bytes_per_line * height];
+        // Allocate ximage data storage.
+        ximage->data = new char[ximage->bytes_per_line * height];
+    }
 
     uchar *src = data;
 
@@ -664,59 +900,228 @@ PImage::createXImage(uchar* data, uint width, uint height)
     return ximage;
 }
 
-static inline uchar
-scalePixel(uchar* data, int pos, int width, float x_diff, float y_diff)
+/** Fixed point position with 16 bits fraction. */
+#define SCALE_SHIFT 16
+
+static inline uint32_t
+loadPixel(const uchar *data)
 {
-    float p0 = data[pos];
-    float p1 = data[pos + 4];
-    float p2 = data[pos + width * 4];
-    float p3 = data[pos + 4 + width * 4];
-    float res = p0 * (1 - x_diff) * (1 - y_diff)
-        + p1 * (x_diff) * (1 - y_diff)
-        + p2 * (y_diff) * (1 - x_diff)
-        + p3 * (x_diff * y_diff);
-    return static_cast<uchar>(res);
+    uint32_t pixel;
+    memcpy(&pixel, data, sizeof(pixel));
+    return pixel;
 }
 
+static inline void
+storePixel(uchar *data, uint32_t pixel)
+{
+    memcpy(data, &pixel, sizeof(pixel));
+}
+
+/**
+ * Interpolate between p0 and p1 with weight (0-256) of p1, all four
+ * channels are processed at once two at a time in the lower and upper
+ * half of the 32-bit value.
+ */
+static inline uint32_t
+lerpPixel(uint32_t p0, uint32_t p1, uint32_t weight)
+{
+    uint32_t inv = 256 - weight;
+    uint32_t lo = (((p0 & 0x00ff00ff) * inv + (p1 & 0x00ff00ff) * weight)
+                   >> 8) & 0x00ff00ff;
+    uint32_t hi = (((p0 >> 8) & 0x00ff00ff) * inv
+                   + ((p1 >> 8) & 0x00ff00ff) * weight) & 0xff00ff00;
+    return lo | hi;
+}
+
+/**
+ * Source offsets and weights for each destination coordinate, the
+ * same positions as the previous floating point scaler used.
+ */
+static void
+scaleCoefficients(uint src_size, uint dst_size,
+                  std::vector<uint> &offsets, std::vector<uint> &weights)
+{
+    offsets.resize(dst_size);
+    weights.resize(dst_size);
+
+    uint64_t step = (static_cast<uint64_t>(src_size - 1) << SCALE_SHIFT)
+        / dst_size;
+    for (uint i = 0; i < dst_size; i++) {
+        uint64_t pos = step * i;
+        offsets[i] = static_cast<uint>(pos >> SCALE_SHIFT);
+        weights[i] = static_cast<uint>(pos >> (SCALE_SHIFT - 8)) & 0xff;
+    }
+}
+
+static void
+scaleRow(const uchar *src, uint src_width, uint32_t *row, uint dst_width,
+         const std::vector<uint> &x_offsets,
+         const std::vector<uint> &x_weights)
+{
+    for (uint dx = 0; dx < dst_width; dx++) {
+        uint sx = x_offsets[dx];
+        uint32_t p0 = loadPixel(src + sx * 4);
+        if (x_weights[dx] && sx + 1 < src_width) {
+            row[dx] = lerpPixel(p0, loadPixel(src + sx * 4 + 4),
+                                x_weights[dx]);
+        } else {
+            row[dx] = p0;
+        }
+    }
+}
+
+/**
+ * Bilinear scaling, source rows are scaled horizontally once and
+ * re-used for all destination rows between them.
+ */
+static void
+scaleBilinear(const uchar *src, uint src_width, uint src_height,
+              uchar *dst, uint dst_width, uint dst_height)
+{
+    std::vector<uint> x_offsets, x_weights, y_offsets, y_weights;
+    scaleCoefficients(src_width, dst_width, x_offsets, x_weights);
+    scaleCoefficients(src_height, dst_height, y_offsets, y_weights);
+
+    std::vector<uint32_t> rows(dst_width * 2);
+    uint32_t *row0 = rows.data();
+    uint32_t *row1 = row0 + dst_width;
+    uint row0_y = static_cast<uint>(-1);
+    uint row1_y = static_cast<uint>(-1);
+
+    size_t src_stride = src_width * 4;
+    for (uint dy = 0; dy < dst_height; dy++) {
+        uint sy0 = y_offsets[dy];
+        uint sy1 = std::min(sy0 + 1, src_height - 1);
+        if (sy0 == row1_y) {
+            std::swap(row0, row1);
+            std::swap(row0_y, row1_y);
+        }
+        if (sy0 != row0_y) {
+            scaleRow(src + sy0 * src_stride, src_width, row0, dst_width,
+                     x_offsets, x_weights);
+            row0_y = sy0;
+        }
+
+        uchar *dst_row = dst + static_cast<size_t>(dy) * dst_width * 4;
+        uint weight = y_weights[dy];
+        if (weight == 0 || sy1 == sy0) {
+            memcpy(dst_row, row0, dst_width * 4);
+            continue;
+        }
+
+        if (sy1 != row1_y) {
+            scaleRow(src + sy1 * src_stride, src_width, row1, dst_width,
+                     x_offsets, x_weights);
+            row1_y = sy1;
+        }
+        for (uint dx = 0; dx < dst_width; dx++) {
+            storePixel(dst_row + dx * 4,
+                       lerpPixel(row0[dx], row1[dx], weight));
+        }
+    }
+}
+
+/**
+ * Area averaging, each destination pixel is the average of the source
+ * pixels it covers. Only valid when downscaling.
+ */
+static void
+scaleArea(const uchar *src, uint src_width, uint src_height,
+          uchar *dst, uint dst_width, uint dst_height)
+{
+    std::vector<uint> x_start(dst_width + 1);
+    for (uint dx = 0; dx <= dst_width; dx++) {
+        x_start[dx] = static_cast<uint64_t>(dx) * src_width / dst_width;
+    }
+
+    size_t src_stride = src_width * 4;
+    std::vector<uint32_t> sums(src_stride);
+    for (uint dy = 0; dy < dst_height; dy++) {
+        uint sy0 = static_cast<uint64_t>(dy) * src_height / dst_height;
+        uint sy1 = static_cast<uint64_t>(dy + 1) * src_height / dst_height;
+
+        // sum source rows covered by the destination row
+        std::fill(sums.begin(), sums.end(), 0);
+        for (uint sy = sy0; sy < sy1; sy++) {
+            const uchar *src_row = src + sy * src_stride;
+            for (size_t i = 0; i < src_stride; i++) {
+                sums[i] += src_row[i];
+            }
+        }
+
+        uchar *dst_row = dst + static_cast<size_t>(dy) * dst_width * 4;
+        for (uint dx = 0; dx < dst_width; dx++) {
+            uint64_t acc[4] = {0, 0, 0, 0};
+            for (uint sx = x_start[dx]; sx < x_start[dx + 1]; sx++) {
+                for (uint c = 0; c < 4; c++) {
+                    acc[c] += sums[sx * 4 + c];
+                }
+            }
+            uint64_t count = static_cast<uint64_t>(x_start[dx + 1]
+                                                   - x_start[dx])
+                * (sy1 - sy0);
+            for (uint c = 0; c < 4; c++) {
+                dst_row[dx * 4 + c] =
+                    static_cast<uchar>((acc[c] + count / 2) / count);
+            }
+        }
+    }
+}
+
+/**
+ * Scale ARGB data at src_width x src_height into dst, which must hold
+ * dst_width x dst_height pixels.
+ *
+ * Downscaling to half the size or less uses area averaging as
+ * bilinear interpolation skips source pixels, other sizes use
+ * bilinear interpolation.
+ */
+void
+PImage::scaleData(const uchar *src, uint src_width, uint src_height,
+                  uchar *dst, uint dst_width, uint dst_height)
+{
+    if (dst_width <= src_width && dst_height <= src_height
+        && (dst_width * 2 <= src_width || dst_height * 2 <= src_height)) {
+        scaleArea(src, src_width, src_height, dst, dst_width, dst_height);
+    } else {
+        scaleBilinear(src, src_width, src_height, dst, dst_width, dst_height);
+    }
+}
 
 /**
  * Scales image data and returns pointer to new data.
  *
  * @param width Width of image data to return.
  * @param height Height of image data to return.
+ * @param use_disk_cache Load and store the scaled data in the disk cache.
  * @return Pointer to image data on success, else nullptr.
  */
 uchar*
-PImage::getScaledData(uint dwidth, uint dheight)
+PImage::getScaledData(uint dwidth, uint dheight, bool use_disk_cache)
 {
-    if (dwidth < 1 || dheight < 1) {
+    if (dwidth < 1 || dheight < 1 || _data == nullptr
+        || _width < 1 || _height < 1) {
         return nullptr;
     }
 
-    auto scaled_data = new uchar[dwidth * dheight * 4] ;
-    float x_ratio = static_cast<float>(_width - 1) / dwidth ;
-    float y_ratio = static_cast<float>(_height - 1) / dheight;
-
-    uint dst = 0 ;
-    for (uint dy = 0; dy < dheight; dy++) {
-        for (uint dx = 0; dx < dwidth; dx++) {
-            uint sx = static_cast<uint>(x_ratio * dx);
-            uint sy = static_cast<uint>(y_ratio * dy);
-
-            int spos = (sy * _width + sx) * 4;
-            float x_diff = (x_ratio * dx) - sx;
-            float y_diff = (y_ratio * dy) - sy;
-
-            scaled_data[dst++] =
-                scalePixel(_data, spos, _width, x_diff, y_diff); // A
-            scaled_data[dst++] =
-                scalePixel(_data + 1, spos, _width, x_diff, y_diff); // R
-            scaled_data[dst++] =
-                scalePixel(_data + 2, spos, _width, x_diff, y_diff); // G
-            scaled_data[dst++] =
-                scalePixel(_data + 3, spos, _width, x_diff, y_diff); // B
+    // only images of files scaled to the screen or head size are
+    // cached on disk, ie. backgrounds, caching every size a scaled
+    // texture is drawn at would fill the cache.
+    use_disk_cache = use_disk_cache && _disk_cache && ! _source.path.empty();
+    if (use_disk_cache) {
+        bool use_alpha;
+        auto scaled_data = _disk_cache->load(_source, dwidth, dheight,
+                                             use_alpha);
+        if (scaled_data) {
+            return scaled_data;
         }
     }
 
+    auto scaled_data = new uchar[dwidth * dheight * 4];
+    scaleData(_data, _width, _height, scaled_data, dwidth, dheight);
+    if (use_disk_cache) {
+        _disk_cache->save(_source, true, scaled_data, dwidth, dheight,
+                          _use_alpha);
+    }
     return scaled_data;
 }
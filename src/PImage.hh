@@ -9,6 +9,7 @@
 #pragma once
 
 #include "config.h"
+#include "ImageDiskCache.hh"
 #include "Render.hh"
 #include "pekwm.hh"
 
@@ -32,6 +33,8 @@ public:
     inline uint getWidth(void) const { return _width; }
     //! @brief Returns height of image.
     inline uint getHeight(void) const { return _height; }
+    //! @brief Returns true if any pixel is not fully opaque.
+    inline bool isUseAlpha(void) const { return _use_alpha; }
 
     bool load(const std::string &file);
     void unload(void);
@@ -49,6 +52,13 @@ public:
                                int x, int y, uint width, uint height,
                                uchar* data);
 
+    static void scaleData(const uchar *src, uint src_width, uint src_height,
+                          uchar *dst, uint dst_width, uint dst_height);
+
+    static void setDiskCache(ImageDiskCache *disk_cache) {
+        _disk_cache = disk_cache;
+    }
+
 protected:
     PImage(void);
 
@@ -63,7 +73,7 @@ protected:
 
 private:
     XImage* createXImage(uchar* data, uint width, uint height);
-    uchar* getScaledData(uint width, uint height);
+    uchar* getScaledData(uint width, uint height, bool use_disk_cache = false);
 
 protected:
     ImageType _type; //!< Type of image.
@@ -78,4 +88,9 @@ protected:
     uchar *_data;
     /** If all pixels have 100% alpha, this is set to false. */
     bool _use_alpha;
+    /** File image data was loaded from, empty path if not loaded. */
+    ImageDiskCache::Source _source;
+
+    /** Decoded and scaled images, shared by all images. */
+    static ImageDiskCache *_disk_cache;
 };
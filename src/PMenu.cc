@@ -610,7 +610,8 @@ PMenu::buildMenuRenderItem(Pixmap pix, ObjectState state, PMenu::Item *item)
 
     if (item->getType() == PMenu::Item::MENU_ITEM_NORMAL) {
         auto tex = md->getTextureItem(state);
-        tex->render(pix, item->getX(), item->getY(), _item_width_max, _item_height);
+        tex->renderCached(pix, item->getX(), item->getY(),
+                          _item_width_max, _item_height);
 
         uint start_x, start_y, icon_width, icon_height;
         // If entry has an icon, draw it
@@ -659,7 +660,8 @@ PMenu::buildMenuRenderItem(Pixmap pix, ObjectState state, PMenu::Item *item)
     } else if ((item->getType() == PMenu::Item::MENU_ITEM_SEPARATOR) &&
                (state < OBJECT_STATE_SELECTED)) {
         auto tex = md->getTextureSeparator(state);
-        tex->render(pix, item->getX(), item->getY(), _item_width_max, _separator_height);
+        tex->renderCached(pix, item->getX(), item->getY(),
+                          _item_width_max, _separator_height);
     }
 }
 
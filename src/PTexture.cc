@@ -8,8 +8,12 @@
 
 #include "PTexture.hh"
 #include "PImage.hh"
+#include "PixmapCache.hh"
 #include "X11.hh"
 
+ulong PTexture::_next_id = 0;
+PixmapCache *PTexture::_pixmap_cache = nullptr;
+
 /**
  * Render texture onto drawable.
  */
@@ -41,8 +45,11 @@ PTexture::render(Render &rend,
         if (_opacity == 255) {
             doRender(rend, x, y, width, height);
         } else {
-            char *data = static_cast<char*>(malloc(width * height * 4));
-            auto ximage = X11::createImage(data, width, height);
+            auto ximage = X11::createShmImage(width, height);
+            if (! ximage) {
+                char *data = static_cast<char*>(malloc(width * height * 4));
+                ximage = X11::createImage(data, width, height);
+            }
             if (ximage) {
                 auto x_rend = XImageRender(ximage);
                 doRender(x_rend, 0, 0, width, height);
@@ -57,6 +64,24 @@ PTexture::render(Render &rend,
     }
 }
 
+/**
+ * Render texture onto drawable using a cached rendering of the
+ * texture at width x height if available. Solid textures and textures
+ * not rendering the same regardless of the destination are always
+ * rendered.
+ */
+void
+PTexture::renderCached(Drawable draw, int x, int y, uint width, uint height)
+{
+    auto pix = isOpaque() ? getCached(width, height) : None;
+    if (pix == None) {
+        render(draw, x, y, width, height);
+    } else {
+        XCopyArea(X11::getDpy(), pix, draw, X11::getGC(), 0, 0,
+                  width ? width : _width, height ? height : _height, x, y);
+    }
+}
+
 /**
  * Set background on drawable using the current texture, for
  * solid/empty textures this sets the background pixel instead of
@@ -67,17 +92,45 @@ PTexture::setBackground(Drawable draw,
                         int x, int y, uint width, uint height)
 {
     ulong pixel;
+    Pixmap pix;
     if (getPixel(pixel) && _opacity == 255) {
         // set background pixel
         X11::setWindowBackground(draw, pixel);
+    } else if (x == 0 && y == 0 && _opacity == 255
+               && (pix = getCached(width, height)) != None) {
+        // the pixmap is owned by the cache, the server keeps it
+        // around for the window if it gets evicted.
+        X11::setWindowBackgroundPixmap(draw, pix);
     } else if (width > 0 && height > 0) {
-        auto pix = X11::createPixmap(width, height);
+        pix = X11::createPixmap(width, height);
         render(pix, x, y, width, height);
         X11::setWindowBackgroundPixmap(draw, pix);
         X11::freePixmap(pix);
     }
 }
 
+/**
+ * Get pixmap with the texture rendered at width x height from the
+ * pixmap cache, None if the cache is not available or the texture is
+ * a solid color.
+ */
+Pixmap
+PTexture::getCached(uint width, uint height)
+{
+    if (width == 0) {
+        width = _width;
+    }
+    if (height == 0) {
+        height = _height;
+    }
+
+    ulong pixel;
+    if (! _pixmap_cache || ! width || ! height || getPixel(pixel)) {
+        return None;
+    }
+    return _pixmap_cache->get(this, width, height);
+}
+
 bool
 PTexture::renderOnBackground(XImage *ximage,
                              int x, int y, uint width, uint height,
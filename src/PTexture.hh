@@ -14,6 +14,8 @@
 #include "Render.hh"
 #include "X11.hh"
 
+class PixmapCache;
+
 class PTexture {
 public:
     enum Type {
@@ -32,7 +34,8 @@ public:
           _width(0),
           _height(0),
           _type(PTexture::TYPE_NO),
-          _opacity(255)
+          _opacity(255),
+          _id(++_next_id)
     {
     }
     virtual ~PTexture(void)
@@ -51,10 +54,21 @@ public:
     virtual Pixmap getMask(uint width, uint height, bool &do_free) {
         return None;
     }
+    /**
+     * Returns true if rendering the texture does not depend on what
+     * is already drawn.
+     */
+    virtual bool isOpaque(void) const { return _opacity == 255; }
 
+    void renderCached(Drawable draw, int x, int y, uint width, uint height);
     void setBackground(Drawable draw,
                        int x, int y, uint width, uint height);
 
+    /** Unique id of the texture, never re-used. */
+    ulong getId(void) const { return _id; }
+
+    static void setPixmapCache(PixmapCache *cache) { _pixmap_cache = cache; }
+
     bool isOk(void) const { return _ok; }
     uint getWidth(void) const { return _width; }
     uint getHeight(void) const { return _height; }
@@ -67,6 +81,7 @@ public:
     void setOpacity(uchar opacity) { _opacity = opacity; }
 
 private:
+    Pixmap getCached(uint width, uint height);
     bool renderOnBackground(XImage *src_ximage,
                             int x, int y, uint width, uint height,
                             int root_x, int root_y);
@@ -76,4 +91,11 @@ protected:
     uint _width, _height; // for images etc, 0 for infinite like in stretch
     PTexture::Type _type; // Type of texture
     uchar _opacity; // Texture opacity, blended onto background pixmap
+
+private:
+    ulong _id;
+
+    static ulong _next_id;
+    /** Cache of rendered textures, set by the TextureHandler. */
+    static PixmapCache *_pixmap_cache;
 };
@@ -372,6 +372,12 @@ PTextureImage::getMask(uint width, uint height, bool &do_free)
     return _image->getMask(do_free, width, height);
 }
 
+bool
+PTextureImage::isOpaque(void) const
+{
+    return PTexture::isOpaque() && _image && ! _image->isUseAlpha();
+}
+
 /**
  * Set image resource
  */
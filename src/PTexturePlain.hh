@@ -145,6 +145,7 @@ public:
                           int x, int y, uint width, uint height) override;
     virtual bool getPixel(ulong &pixel) const override { return false; }
     virtual Pixmap getMask(uint width, uint height, bool &do_free) override;
+    virtual bool isOpaque(void) const override;
     // END - PTexture interface.
 
     bool setImage(const std::string &image, const std::string &colormap);
@@ -21,7 +21,9 @@ PWinObj* PWinObj::_skip_enter_after = nullptr;
 PWinObj* PWinObj::_focused_wo = nullptr;
 PWinObj* PWinObj::_root_wo = nullptr;
 std::vector<PWinObj*> PWinObj::_wo_list = std::vector<PWinObj*>();
-std::map<Window, PWinObj*> PWinObj::_wo_map = std::map<Window, PWinObj*>();
+std::unordered_set<PWinObj*> PWinObj::_wo_set;
+std::unordered_map<Window, PWinObj*> PWinObj::_wo_map;
+ulong PWinObj::_wo_serial = 0;
 
 //! @brief PWinObj constructor.
 PWinObj::PWinObj(bool keyboard_input)
@@ -85,6 +87,7 @@ PWinObj::mapWindow(void)
     }
     _mapped = true;
     _iconified = false;
+    woChanged();
 
     X11::mapWindow(_window);
 }
@@ -98,6 +101,7 @@ PWinObj::mapWindowRaised(void)
     }
     _mapped = true;
     _iconified = false;
+    woChanged();
 
     XMapRaised(X11::getDpy(), _window);
 }
@@ -111,6 +115,7 @@ PWinObj::unmapWindow(void)
     }
     
     _mapped = false;
+    woChanged();
 
     // Make sure unmapped windows drops focus
     setFocused(false);
@@ -153,6 +158,7 @@ PWinObj::move(int x, int y)
 {
     _gm.x = x;
     _gm.y = y;
+    woChanged();
 
     X11::moveWindow(_window, _gm.x, _gm.y);
 }
@@ -168,6 +174,7 @@ PWinObj::resize(uint width, uint height)
 
     _gm.width = width;
     _gm.height = height;
+    woChanged();
 
     X11::resizeWindow(_window, _gm.width, _gm.height);
 }
@@ -189,6 +196,7 @@ PWinObj::moveResize(int x, int y, uint width, uint height)
     _gm.y = y;
     _gm.width = width;
     _gm.height = height;
+    woChanged();
 
     X11::moveResizeWindow(_window, _gm.x, _gm.y, _gm.width, _gm.height);
 }
@@ -272,12 +280,18 @@ void
 PWinObj::woListAdd(PWinObj *wo)
 {
     _wo_list.push_back(wo);
+    _wo_set.insert(wo);
+    woChanged();
 }
 
 //! @brief Remove PWinObj from _wo_list.
 void
 PWinObj::woListRemove(PWinObj *wo)
 {
+    if (_wo_set.erase(wo) == 0) {
+        return;
+    }
+    woChanged();
     auto it(find(_wo_list.begin(), _wo_list.end(), wo));
     if (it != _wo_list.end()) {
         _wo_list.erase(it);
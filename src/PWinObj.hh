@@ -11,7 +11,8 @@
 #include "config.h"
 
 #include <algorithm>
-#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "pekwm.hh"
 #include "X11.hh"
@@ -72,12 +73,13 @@ public:
     //! @param wo PWinObj to search for.
     //! @return true if found, else false.
     static inline bool windowObjectExists(PWinObj *wo) {
-        auto it = std::find(_wo_list.begin(), _wo_list.end(), wo);
-        if (it != _wo_list.end())
-            return true;
-        return false;
+        return _wo_set.count(wo) != 0;
     }
 
+    //! @brief Returns serial incremented when a PWinObj is added,
+    //! removed, mapped, unmapped or changes geometry.
+    static inline ulong getSerial(void) { return _wo_serial; }
+
     static bool isSkipEnterAfter(Window win) {
         return (win == _win_skip_enter_after
                 || (_skip_enter_after != nullptr && *_skip_enter_after == win));
@@ -243,6 +245,8 @@ public:
 protected:
     static void woListAdd(PWinObj *wo);
     static void woListRemove(PWinObj *wo);
+    //! @brief Increments the serial returned by getSerial.
+    static inline void woChanged(void) { _wo_serial++; }
 
 protected:
     Window _window; //!< Window PWinObj represents.
@@ -285,5 +289,8 @@ protected:
     static PWinObj *_root_wo; //!< Static root PWinObj pointer.
     static PWinObj *_focused_wo; //!< Static focused PWinObj pointer.
     static std::vector<PWinObj*> _wo_list; //!< List of PWinObjs.
-    static std::map<Window, PWinObj*> _wo_map; //!< Mapping of Window to PWinObj
+    static std::unordered_set<PWinObj*> _wo_set; //!< Set of PWinObjs.
+    //! Mapping of Window, including decoration windows, to PWinObj
+    static std::unordered_map<Window, PWinObj*> _wo_map;
+    static ulong _wo_serial; //!< Serial returned by getSerial.
 };
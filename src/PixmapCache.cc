@@ -0,0 +1,152 @@
+//
+// PixmapCache.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "config.h"
+
+#include "PixmapCache.hh"
+#include "PTexture.hh"
+
+/** Default cache size, 8MB. */
+#define PIXMAP_CACHE_DEFAULT_SIZE (8 * 1024 * 1024)
+
+std::ostream&
+operator<<(std::ostream &os, const PixmapCache::Stats &stats)
+{
+    ulong lookups = stats.hits + stats.misses;
+    os << "hits " << stats.hits
+       << " misses " << stats.misses
+       << " hit rate "
+       << (lookups ? (stats.hits * 100 / lookups) : 0) << "%"
+       << " evictions " << stats.evictions
+       << " entries " << stats.entries
+       << " bytes " << stats.bytes;
+    return os;
+}
+
+PixmapCache::PixmapCache(void)
+    : _size(PIXMAP_CACHE_DEFAULT_SIZE)
+{
+}
+
+PixmapCache::~PixmapCache(void)
+{
+    clear();
+}
+
+/**
+ * Set max number of bytes used by cached pixmaps, 0 disables the
+ * cache.
+ */
+void
+PixmapCache::setSize(size_t size)
+{
+    _size = size;
+    evict(0);
+}
+
+/**
+ * Get pixmap with texture rendered at width x height, rendering it if
+ * not cached.
+ *
+ * The pixmap is owned by the cache and is only valid until the next
+ * call to get.
+ *
+ * @return Pixmap or None if the pixmap does not fit in the cache.
+ */
+Pixmap
+PixmapCache::get(PTexture *texture, uint width, uint height)
+{
+    Key key(texture->getId(), width, height);
+    auto it = _entries.find(key);
+    if (it != _entries.end()) {
+        _stats.hits++;
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->pixmap;
+    }
+
+    _stats.misses++;
+    size_t bytes = getBytes(width, height);
+    if (bytes > _size) {
+        return None;
+    }
+    evict(bytes);
+
+    Entry entry;
+    entry.key = key;
+    entry.pixmap = X11::createPixmap(width, height);
+    entry.bytes = bytes;
+    texture->render(entry.pixmap, 0, 0, width, height);
+
+    _lru.push_front(entry);
+    _entries[key] = _lru.begin();
+    _stats.entries++;
+    _stats.bytes += bytes;
+    return entry.pixmap;
+}
+
+/**
+ * Remove all pixmaps rendered from texture, called when the texture
+ * is freed.
+ */
+void
+PixmapCache::remove(PTexture *texture)
+{
+    ulong id = texture->getId();
+    auto it = _lru.begin();
+    while (it != _lru.end()) {
+        if (std::get<0>(it->key) == id) {
+            X11::freePixmap(it->pixmap);
+            _entries.erase(it->key);
+            _stats.entries--;
+            _stats.bytes -= it->bytes;
+            it = _lru.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void
+PixmapCache::clear(void)
+{
+    for (auto &entry : _lru) {
+        X11::freePixmap(entry.pixmap);
+    }
+    _lru.clear();
+    _entries.clear();
+    _stats.entries = 0;
+    _stats.bytes = 0;
+}
+
+/**
+ * Evict least recently used pixmaps until size bytes can be added
+ * without exceeding the cache size.
+ */
+void
+PixmapCache::evict(size_t size)
+{
+    while (! _lru.empty() && _stats.bytes + size > _size) {
+        Entry &entry = _lru.back();
+        X11::freePixmap(entry.pixmap);
+        _entries.erase(entry.key);
+        _stats.evictions++;
+        _stats.entries--;
+        _stats.bytes -= entry.bytes;
+        _lru.pop_back();
+    }
+}
+
+/**
+ * Estimate server side memory used by a pixmap of width x height.
+ */
+size_t
+PixmapCache::getBytes(uint width, uint height)
+{
+    size_t bpp = X11::getDepth() > 16 ? 4 : (X11::getDepth() > 8 ? 2 : 1);
+    return static_cast<size_t>(width) * height * bpp;
+}
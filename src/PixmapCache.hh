@@ -0,0 +1,84 @@
+//
+// PixmapCache.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "X11.hh"
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <tuple>
+
+class PTexture;
+
+/**
+ * LRU cache of textures rendered to pixmaps, keyed on texture and
+ * size, limited by the (estimated) amount of memory used by the
+ * pixmaps on the server.
+ *
+ * Focus and button states use separate textures so the texture
+ * identity covers the state of the rendered object.
+ */
+class PixmapCache {
+public:
+    class Stats {
+    public:
+        Stats(void)
+            : hits(0),
+              misses(0),
+              evictions(0),
+              entries(0),
+              bytes(0)
+        {
+        }
+
+        ulong hits;
+        ulong misses;
+        ulong evictions;
+        ulong entries;
+        size_t bytes;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
+    PixmapCache(void);
+    ~PixmapCache(void);
+
+    size_t getSize(void) const { return _size; }
+    void setSize(size_t size);
+    const Stats &getStats(void) const { return _stats; }
+
+    Pixmap get(PTexture *texture, uint width, uint height);
+    void remove(PTexture *texture);
+    void clear(void);
+
+private:
+    /** Texture id, width and height. */
+    typedef std::tuple<ulong, uint, uint> Key;
+
+    class Entry {
+    public:
+        Key key;
+        Pixmap pixmap;
+        size_t bytes;
+    };
+
+    void evict(size_t size);
+    static size_t getBytes(uint width, uint height);
+
+    /** Entries, most recently used first. */
+    std::list<Entry> _lru;
+    std::map<Key, std::list<Entry>::iterator> _entries;
+    /** Max number of bytes used by cached pixmaps. */
+    size_t _size;
+
+    Stats _stats;
+};
@@ -0,0 +1,334 @@
+//
+// Reactor.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "Debug.hh"
+#include "Reactor.hh"
+#include "Util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#else // ! HAVE_EPOLL
+#include <poll.h>
+#endif // HAVE_EPOLL
+}
+
+#define REACTOR_MAX_EVENTS 32
+
+int Reactor::_signal_pipe[2] = {-1, -1};
+
+static void
+timespecAddMs(struct timespec &ts, uint ms)
+{
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+}
+
+Reactor::Reactor(void)
+    : _timer_id(0)
+{
+    initSignalPipe();
+
+#ifdef HAVE_EPOLL
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epoll_fd == -1) {
+        ERR("epoll_create1 failed: " << strerror(errno));
+    } else if (_signal_pipe[0] != -1) {
+        struct epoll_event ev = {0};
+        ev.events = EPOLLIN;
+        ev.data.fd = _signal_pipe[0];
+        epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _signal_pipe[0], &ev);
+    }
+#endif // HAVE_EPOLL
+}
+
+Reactor::~Reactor(void)
+{
+    for (auto signum : _signals) {
+        signal(signum, SIG_DFL);
+    }
+
+#ifdef HAVE_EPOLL
+    if (_epoll_fd != -1) {
+        close(_epoll_fd);
+    }
+#endif // HAVE_EPOLL
+}
+
+/**
+ * Add file descriptor to watch for input.
+ */
+bool
+Reactor::addFd(int fd)
+{
+    if (std::find(_fds.begin(), _fds.end(), fd) != _fds.end()) {
+        return true;
+    }
+
+#ifdef HAVE_EPOLL
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        ERR("failed to add fd " << fd << " to epoll: " << strerror(errno));
+        return false;
+    }
+#endif // HAVE_EPOLL
+
+    _fds.push_back(fd);
+    return true;
+}
+
+/**
+ * Stop watching file descriptor, must be called before the file
+ * descriptor is closed.
+ */
+void
+Reactor::removeFd(int fd)
+{
+    auto it = std::find(_fds.begin(), _fds.end(), fd);
+    if (it == _fds.end()) {
+        return;
+    }
+    _fds.erase(it);
+
+#ifdef HAVE_EPOLL
+    struct epoll_event ev = {0};
+    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+#endif // HAVE_EPOLL
+}
+
+/**
+ * Add timer expiring in interval_ms milliseconds.
+ *
+ * @return Timer id, reported as value in EVENT_TIMER events.
+ */
+int
+Reactor::addTimer(uint interval_ms, bool repeat)
+{
+    Timer timer;
+    timer.id = ++_timer_id;
+    timer.interval_ms = interval_ms;
+    timer.repeat = repeat;
+    clock_gettime(CLOCK_MONOTONIC, &timer.deadline);
+    timespecAddMs(timer.deadline, interval_ms);
+    _timers.push_back(timer);
+    return timer.id;
+}
+
+void
+Reactor::removeTimer(int id)
+{
+    auto it = _timers.begin();
+    for (; it != _timers.end(); ++it) {
+        if (it->id == id) {
+            _timers.erase(it);
+            break;
+        }
+    }
+}
+
+/**
+ * Install signal handler for signum, reported with EVENT_SIGNAL
+ * events.
+ */
+bool
+Reactor::addSignal(int signum)
+{
+    struct sigaction act;
+    act.sa_handler = sigHandler;
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_NOCLDSTOP | SA_RESTART;
+    if (sigaction(signum, &act, 0) == -1) {
+        ERR("failed to install handler for signal " << signum << ": "
+            << strerror(errno));
+        return false;
+    }
+    _signals.push_back(signum);
+    return true;
+}
+
+/**
+ * Wait for file descriptors, timers or signals.
+ *
+ * @param events Filled in with ready events.
+ * @param timeout_ms Max time to wait in milliseconds, -1 for no limit.
+ * @return true if any event is ready.
+ */
+bool
+Reactor::wait(std::vector<Event> &events, int timeout_ms)
+{
+    events.clear();
+    waitFds(events, getTimerTimeout(timeout_ms));
+    expireTimers(events);
+    return ! events.empty();
+}
+
+bool
+Reactor::waitFds(std::vector<Event> &events, int timeout_ms)
+{
+#ifdef HAVE_EPOLL
+    struct epoll_event evs[REACTOR_MAX_EVENTS];
+    int ret = epoll_wait(_epoll_fd, evs, REACTOR_MAX_EVENTS, timeout_ms);
+    if (ret == -1) {
+        if (errno != EINTR) {
+            ERR("epoll_wait failed: " << strerror(errno));
+        }
+        return false;
+    }
+
+    for (int i = 0; i < ret; i++) {
+        if (evs[i].data.fd == _signal_pipe[0]) {
+            readSignals(events);
+        } else {
+            events.push_back(Event(EVENT_FD, evs[i].data.fd));
+        }
+    }
+#else // ! HAVE_EPOLL
+    std::vector<struct pollfd> pfds(_fds.size() + 1);
+    pfds[0].fd = _signal_pipe[0];
+    pfds[0].events = POLLIN;
+    for (size_t i = 0; i < _fds.size(); i++) {
+        pfds[i + 1].fd = _fds[i];
+        pfds[i + 1].events = POLLIN;
+    }
+
+    int ret = poll(pfds.data(), pfds.size(), timeout_ms);
+    if (ret == -1) {
+        if (errno != EINTR) {
+            ERR("poll failed: " << strerror(errno));
+        }
+        return false;
+    }
+
+    for (size_t i = 0; ret > 0 && i < pfds.size(); i++) {
+        if (pfds[i].revents == 0) {
+            continue;
+        }
+        ret--;
+        if (i == 0) {
+            readSignals(events);
+        } else {
+            events.push_back(Event(EVENT_FD, pfds[i].fd));
+        }
+    }
+#endif // HAVE_EPOLL
+    return true;
+}
+
+void
+Reactor::readSignals(std::vector<Event> &events)
+{
+    char buf[64];
+    ssize_t nread;
+    while ((nread = read(_signal_pipe[0], buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < nread; i++) {
+            Event ev(EVENT_SIGNAL, buf[i]);
+            auto it = std::find_if(events.begin(), events.end(),
+                                   [ev](const Event &e) {
+                                       return e.type == ev.type
+                                           && e.value == ev.value;
+                                   });
+            if (it == events.end()) {
+                events.push_back(ev);
+            }
+        }
+    }
+}
+
+void
+Reactor::expireTimers(std::vector<Event> &events)
+{
+    if (_timers.empty()) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    auto it = _timers.begin();
+    while (it != _timers.end()) {
+        if (Util::timeDiffMs(it->deadline, now) > 0) {
+            ++it;
+            continue;
+        }
+
+        events.push_back(Event(EVENT_TIMER, it->id));
+        if (it->repeat) {
+            it->deadline = now;
+            timespecAddMs(it->deadline, it->interval_ms);
+            ++it;
+        } else {
+            it = _timers.erase(it);
+        }
+    }
+}
+
+/**
+ * Get timeout to use when waiting, limited by the closest timer.
+ */
+int
+Reactor::getTimerTimeout(int timeout_ms)
+{
+    if (_timers.empty()) {
+        return timeout_ms;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (auto &timer : _timers) {
+        long diff = std::max(Util::timeDiffMs(timer.deadline, now), 0L);
+        if (timeout_ms == -1 || diff < timeout_ms) {
+            timeout_ms = diff;
+        }
+    }
+    return timeout_ms;
+}
+
+/**
+ * Create the self-pipe used to deliver signals, shared between all
+ * reactors in the process.
+ */
+void
+Reactor::initSignalPipe(void)
+{
+    if (_signal_pipe[0] != -1) {
+        return;
+    }
+
+    if (pipe(_signal_pipe) == -1) {
+        ERR("failed to create signal pipe: " << strerror(errno));
+        return;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        fcntl(_signal_pipe[i], F_SETFD, FD_CLOEXEC);
+        Util::setNonBlock(_signal_pipe[i]);
+    }
+}
+
+void
+Reactor::sigHandler(int signum)
+{
+    int saved_errno = errno;
+    char c = signum;
+    ssize_t ret = write(_signal_pipe[1], &c, 1);
+    (void) ret;
+    errno = saved_errno;
+}
@@ -0,0 +1,98 @@
+//
+// Reactor.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "Types.hh"
+
+#include <vector>
+
+extern "C" {
+#include <time.h>
+}
+
+/**
+ * Main loop helper waiting for file descriptors, timers and signals.
+ *
+ * File descriptors are watched with epoll where available, falling
+ * back to poll. Signals are delivered through a self-pipe watched
+ * together with the file descriptors so a signal always wakes up the
+ * loop without having to poll flags set by the signal handler.
+ */
+class Reactor {
+public:
+    enum EventType {
+        EVENT_FD,
+        EVENT_TIMER,
+        EVENT_SIGNAL
+    };
+
+    /**
+     * Ready event, value is the file descriptor, timer id or signal
+     * number depending on type.
+     */
+    class Event {
+    public:
+        Event(EventType _type, int _value)
+            : type(_type),
+              value(_value)
+        {
+        }
+
+        EventType type;
+        int value;
+    };
+
+    Reactor(void);
+    ~Reactor(void);
+
+    bool addFd(int fd);
+    void removeFd(int fd);
+    size_t numFds(void) const { return _fds.size(); }
+
+    int addTimer(uint interval_ms, bool repeat);
+    void removeTimer(int id);
+
+    bool addSignal(int signum);
+
+    bool wait(std::vector<Event> &events, int timeout_ms = -1);
+
+private:
+    class Timer {
+    public:
+        int id;
+        uint interval_ms;
+        bool repeat;
+        struct timespec deadline;
+    };
+
+    bool waitFds(std::vector<Event> &events, int timeout_ms);
+    void readSignals(std::vector<Event> &events);
+    void expireTimers(std::vector<Event> &events);
+    int getTimerTimeout(int timeout_ms);
+
+    static void initSignalPipe(void);
+    static void sigHandler(int signum);
+
+    /** Watched file descriptors, excluding the signal pipe. */
+    std::vector<int> _fds;
+#ifdef HAVE_EPOLL
+    int _epoll_fd;
+#endif // HAVE_EPOLL
+
+    std::vector<Timer> _timers;
+    int _timer_id;
+
+    /** Signals handled by this reactor. */
+    std::vector<int> _signals;
+
+    /** Self-pipe written to by the signal handler, shared in process. */
+    static int _signal_pipe[2];
+};
@@ -0,0 +1,104 @@
+//
+// SnapIndex.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "X11.hh"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * Sorted edge lists over a set of rectangles, used to find the
+ * rectangles a moving rectangle can snap to without checking all of
+ * them.
+ *
+ * Rectangles are identified by the order they were added in, entries
+ * are always returned in that order.
+ */
+class SnapIndex {
+public:
+    SnapIndex(void) : _sorted(true) { }
+    ~SnapIndex(void) { }
+
+    size_t size(void) const { return _gms.size(); }
+    const Geometry &at(size_t entry) const { return _gms[entry]; }
+
+    void clear(void) {
+        _gms.clear();
+        for (int i = 0; i < EDGE_NO; i++) {
+            _edges[i].clear();
+        }
+        _sorted = true;
+    }
+
+    void add(const Geometry &gm) {
+        size_t entry = _gms.size();
+        _gms.push_back(gm);
+        _edges[EDGE_LEFT].push_back(Edge(gm.x, entry));
+        _edges[EDGE_RIGHT].push_back(Edge(gm.x + gm.width, entry));
+        _edges[EDGE_TOP].push_back(Edge(gm.y, entry));
+        _edges[EDGE_BOTTOM].push_back(Edge(gm.y + gm.height, entry));
+        _sorted = false;
+    }
+
+    /**
+     * Find entries with an edge within snapping distance of gm, that
+     * is the left edge of an entry close to the right edge of gm and
+     * so on.
+     */
+    void find(const Geometry &gm, int attract, int resist,
+              std::vector<size_t> &entries) {
+        if (! _sorted) {
+            for (int i = 0; i < EDGE_NO; i++) {
+                std::sort(_edges[i].begin(), _edges[i].end());
+            }
+            _sorted = true;
+        }
+
+        int x = gm.x + gm.width;
+        int y = gm.y + gm.height;
+
+        entries.clear();
+        findEdges(EDGE_LEFT, x - resist, x + attract, entries);
+        findEdges(EDGE_RIGHT, gm.x - attract, gm.x + resist, entries);
+        findEdges(EDGE_TOP, y - resist, y + attract, entries);
+        findEdges(EDGE_BOTTOM, gm.y - attract, gm.y + resist, entries);
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()),
+                      entries.end());
+    }
+
+private:
+    enum EdgeType {
+        EDGE_LEFT,
+        EDGE_RIGHT,
+        EDGE_TOP,
+        EDGE_BOTTOM,
+        EDGE_NO
+    };
+
+    /** Edge position and entry. */
+    typedef std::pair<int, size_t> Edge;
+
+    void findEdges(EdgeType type, int lo, int hi,
+                   std::vector<size_t> &entries) const {
+        const std::vector<Edge> &edges = _edges[type];
+        auto it = std::lower_bound(edges.begin(), edges.end(), Edge(lo, 0));
+        for (; it != edges.end() && it->first <= hi; ++it) {
+            entries.push_back(it->second);
+        }
+    }
+
+    std::vector<Geometry> _gms;
+    std::vector<Edge> _edges[EDGE_NO];
+    bool _sorted;
+};
@@ -0,0 +1,308 @@
+//
+// StackingList.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "pekwm.hh"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <unordered_map>
+
+/**
+ * Stacking order of objects, bottom to top, indexed by object and
+ * layer.
+ *
+ * Each object is given a key increasing with the stacking position
+ * making it possible to compare positions and find the lowest object
+ * in a set of layers without walking the list. Lookup of an object is
+ * constant time, finding the insert position for a layer and
+ * inserting/removing objects is (amortized) logarithmic.
+ */
+template<typename T>
+class StackingList {
+public:
+    typedef typename std::list<T>::iterator iterator;
+    typedef typename std::list<T>::const_iterator const_iterator;
+    typedef typename std::list<T>::reverse_iterator reverse_iterator;
+    typedef typename std::list<T>::const_reverse_iterator
+        const_reverse_iterator;
+
+    StackingList(void) { }
+    ~StackingList(void) { }
+
+    iterator begin(void) { return _list.begin(); }
+    iterator end(void) { return _list.end(); }
+    const_iterator begin(void) const { return _list.begin(); }
+    const_iterator end(void) const { return _list.end(); }
+    reverse_iterator rbegin(void) { return _list.rbegin(); }
+    reverse_iterator rend(void) { return _list.rend(); }
+    const_reverse_iterator rbegin(void) const { return _list.rbegin(); }
+    const_reverse_iterator rend(void) const { return _list.rend(); }
+
+    size_t size(void) const { return _list.size(); }
+    bool empty(void) const { return _list.empty(); }
+    bool contains(T obj) const { return _entries.count(obj) != 0; }
+
+    /**
+     * Insert obj in layer directly below below, on top of the stack if
+     * below is not in the list.
+     */
+    void insertBelow(T obj, Layer layer, T below) {
+        remove(obj);
+        auto it = _entries.find(below);
+        if (it == _entries.end()) {
+            insert(obj, layer, _list.end());
+        } else {
+            insert(obj, layer, it->second.pos);
+        }
+    }
+
+    /**
+     * Insert obj in layer directly above above, at the bottom of the
+     * stack if above is not in the list.
+     */
+    void insertAbove(T obj, Layer layer, T above) {
+        remove(obj);
+        auto it = _entries.find(above);
+        if (it == _entries.end()) {
+            insert(obj, layer, _list.begin());
+        } else {
+            iterator pos = it->second.pos;
+            insert(obj, layer, ++pos);
+        }
+    }
+
+    bool remove(T obj) {
+        auto it = _entries.find(obj);
+        if (it == _entries.end()) {
+            return false;
+        }
+        _layers[it->second.layer].erase(it->second.key);
+        _list.erase(it->second.pos);
+        _entries.erase(it);
+        return true;
+    }
+
+    void clear(void) {
+        _list.clear();
+        _entries.clear();
+        for (auto &layer : _layers) {
+            layer.clear();
+        }
+    }
+
+    /**
+     * Update the layer of obj without changing its position.
+     */
+    void setLayer(T obj, Layer layer) {
+        auto it = _entries.find(obj);
+        if (it == _entries.end() || it->second.layer == layer) {
+            return;
+        }
+        _layers[it->second.layer].erase(it->second.key);
+        it->second.layer = layer;
+        _layers[layer][it->second.key] = obj;
+    }
+
+    /**
+     * Get object stacked directly above obj, nullptr if obj is on top
+     * or not in the list.
+     */
+    T getAbove(T obj) const {
+        auto it = _entries.find(obj);
+        if (it == _entries.end()) {
+            return nullptr;
+        }
+        const_iterator pos = it->second.pos;
+        return ++pos == _list.end() ? nullptr : *pos;
+    }
+
+    /**
+     * Get the lowest object in a layer higher than layer, nullptr if
+     * there is none.
+     */
+    T findFirstAbove(Layer layer) const {
+        return findFirstFrom(static_cast<uint>(layer) + 1);
+    }
+
+    /**
+     * Get the lowest object in layer or any layer above it, nullptr if
+     * there is none.
+     */
+    T findFirstFrom(uint layer) const {
+        T obj = nullptr;
+        uint64_t min_key = UINT64_MAX;
+        for (; layer < _layers.size(); layer++) {
+            if (! _layers[layer].empty()
+                && _layers[layer].begin()->first < min_key) {
+                min_key = _layers[layer].begin()->first;
+                obj = _layers[layer].begin()->second;
+            }
+        }
+        return obj;
+    }
+
+    /**
+     * Returns true if obj1 is stacked below obj2, both must be in the
+     * list.
+     */
+    bool isBelow(T obj1, T obj2) const {
+        return _entries.at(obj1).key < _entries.at(obj2).key;
+    }
+
+private:
+    /** Distance between keys when assigning new keys. */
+    static const uint64_t KEY_GAP = 1 << 20;
+
+    class Entry {
+    public:
+        iterator pos;
+        uint64_t key;
+        Layer layer;
+    };
+
+    void insert(T obj, Layer layer, iterator pos) {
+        uint64_t key;
+        if (! getKeyBefore(pos, key)) {
+            relabel(pos);
+            if (! getKeyBefore(pos, key)) {
+                relabelRange(_list.begin(), _list.end(), pos, 0,
+                             UINT64_MAX / (_list.size() + 2));
+                getKeyBefore(pos, key);
+            }
+        }
+
+        Entry entry;
+        entry.pos = _list.insert(pos, obj);
+        entry.key = key;
+        entry.layer = layer;
+        _entries[obj] = entry;
+        _layers[layer][key] = obj;
+    }
+
+    /**
+     * Get key for an object inserted before pos, returns false if
+     * there is no room between the keys of the neighbours.
+     */
+    bool getKeyBefore(iterator pos, uint64_t &key) const {
+        uint64_t low = 0;
+        if (pos != _list.begin()) {
+            iterator prev = pos;
+            low = _entries.at(*--prev).key;
+        }
+        if (pos == _list.end()) {
+            uint64_t room = UINT64_MAX - low;
+            if (room < 2) {
+                return false;
+            }
+            key = low + (room / 2 < KEY_GAP ? room / 2 : KEY_GAP);
+            return true;
+        }
+
+        uint64_t high = _entries.at(*pos).key;
+        if (high - low < 2) {
+            return false;
+        }
+        key = low + (high - low) / 2;
+        return true;
+    }
+
+    /**
+     * Make room for a key before pos by spreading out the keys of the
+     * objects around it.
+     *
+     * The smallest aligned key range around pos that is sparse
+     * enough is used, the allowed density decreasing with the size of
+     * the range, keeping the amortized number of objects relabeled
+     * per insert logarithmic.
+     */
+    void relabel(iterator pos) {
+        iterator first = pos;
+        iterator last = pos;
+        if (pos == _list.end()) {
+            --first;
+            --last;
+        } else if (pos != _list.begin()) {
+            --first;
+        }
+        uint64_t anchor = _entries.at(*first).key;
+        size_t count = std::distance(first, last) + 1;
+
+        double max_count = 1.0;
+        for (uint bits = 1; bits < 64; bits++) {
+            max_count *= 4.0 / 3.0;
+
+            uint64_t lo = anchor & ~((uint64_t(1) << bits) - 1);
+            uint64_t hi = lo + ((uint64_t(1) << bits) - 1);
+            while (first != _list.begin()) {
+                iterator prev = first;
+                if (_entries.at(*--prev).key < lo) {
+                    break;
+                }
+                first = prev;
+                count++;
+            }
+            while (true) {
+                iterator next = last;
+                if (++next == _list.end() || _entries.at(*next).key > hi) {
+                    break;
+                }
+                last = next;
+                count++;
+            }
+
+            // count + 1 to make room for the new object
+            uint64_t step = (uint64_t(1) << bits) / (count + 2);
+            if (step >= 2 && (count + 1) <= max_count) {
+                relabelRange(first, ++last, pos, lo, step);
+                return;
+            }
+        }
+
+        relabelRange(_list.begin(), _list.end(), pos, 0,
+                     UINT64_MAX / (_list.size() + 2));
+    }
+
+    /**
+     * Assign keys lo + step * n to objects in [first, last), leaving
+     * an unused key before pos.
+     */
+    void relabelRange(iterator first, iterator last, iterator pos,
+                      uint64_t lo, uint64_t step) {
+        // old keys are removed first as new keys may collide with old
+        // keys of objects not yet relabeled.
+        for (iterator it = first; it != last; ++it) {
+            Entry &entry = _entries[*it];
+            _layers[entry.layer].erase(entry.key);
+        }
+
+        uint64_t key = lo + step;
+        for (iterator it = first; it != last; ++it) {
+            if (it == pos) {
+                key += step;
+            }
+            Entry &entry = _entries[*it];
+            entry.key = key;
+            _layers[entry.layer][key] = *it;
+            key += step;
+        }
+    }
+
+    /** Objects in stacking order, bottom to top. */
+    std::list<T> _list;
+    /** Position, key and layer of objects. */
+    std::unordered_map<T, Entry> _entries;
+    /** Objects in each layer, ordered by key. */
+    std::array<std::map<uint64_t, T>, LAYER_NONE + 1> _layers;
+};
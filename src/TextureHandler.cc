@@ -44,13 +44,62 @@ parseSize(const std::string &str, uint &width, uint &height)
     return true;
 }
 
+std::ostream&
+operator<<(std::ostream &os, const TextureHandler::Stats &stats)
+{
+    os << "lookups " << stats.lookups
+       << " hits " << stats.hits
+       << " parses " << stats.parses
+       << " textures " << stats.textures;
+    return os;
+}
+
 TextureHandler::TextureHandler(void)
     : _length_min(5)
 {
+    PTexture::setPixmapCache(&_pixmap_cache);
 }
 
 TextureHandler::~TextureHandler(void)
 {
+    PTexture::setPixmapCache(nullptr);
+}
+
+/**
+ * Normalize texture name, names only differing in whitespace between
+ * parameters or in case share the same texture. Image file names are
+ * kept as is.
+ */
+std::string
+TextureHandler::normalizeName(const std::string &texture)
+{
+    auto type_start = texture.find_first_not_of(" \t");
+    if (type_start == std::string::npos) {
+        return "";
+    }
+    auto type_end = texture.find_first_of(" \t", type_start);
+    auto name = texture.substr(type_start, type_end - type_start);
+    Util::to_upper(name);
+    if (type_end == std::string::npos) {
+        return name;
+    }
+
+    auto type = parse_map.get(name);
+    if (type == PTexture::TYPE_IMAGE || type == PTexture::TYPE_IMAGE_MAPPED) {
+        auto start = texture.find_first_not_of(" \t", type_end);
+        auto end = texture.find_last_not_of(" \t");
+        if (start != std::string::npos) {
+            name += " " + texture.substr(start, end - start + 1);
+        }
+    } else {
+        std::vector<std::string> tok;
+        Util::splitString(texture.substr(type_end), tok, " \t");
+        for (auto &it : tok) {
+            Util::to_lower(it);
+            name += " " + it;
+        }
+    }
+    return name;
 }
 
 /**
@@ -59,22 +108,27 @@ TextureHandler::~TextureHandler(void)
 PTexture*
 TextureHandler::getTexture(const std::string &texture)
 {
+    _stats.lookups++;
+
     // check for already existing entry
-    auto it(_textures.begin());
-    for (; it != _textures.end(); ++it) {
-        if (*(*it) == texture) {
-            (*it)->incRef();
-            return (*it)->getTexture();
-        }
+    auto name = normalizeName(texture);
+    auto it = _textures.find(name);
+    if (it != _textures.end()) {
+        _stats.hits++;
+        it->second->incRef();
+        return it->second->getTexture();
     }
 
     // parse texture
+    _stats.parses++;
     auto ptexture = parse(texture);
     if (ptexture) {
         // create new entry
-        auto entry = new TextureHandler::Entry(texture, ptexture);
+        auto entry = new TextureHandler::Entry(name, ptexture);
         entry->incRef();
-        _textures.push_back(entry);
+        _textures[name] = entry;
+        _entries[ptexture] = entry;
+        _stats.textures++;
     }
 
     return ptexture;
@@ -89,18 +143,17 @@ PTexture*
 TextureHandler::referenceTexture(PTexture *texture)
 {
     // Check for already existing entry
-    auto it(_textures.begin());
-    for (; it != _textures.end(); ++it) {
-        if ((*it)->getTexture() == texture) {
-            (*it)->incRef();
-            return texture;
-        }
+    auto it = _entries.find(texture);
+    if (it != _entries.end()) {
+        it->second->incRef();
+        return texture;
     }
 
     // Create new entry
     auto entry = new TextureHandler::Entry("", texture);
     entry->incRef();
-    _textures.push_back(entry);
+    _entries[texture] = entry;
+    _stats.textures++;
 
     return texture;
 }
@@ -111,24 +164,23 @@ TextureHandler::referenceTexture(PTexture *texture)
 void
 TextureHandler::returnTexture(PTexture *texture)
 {
-    bool found = false;
-
-    auto it(_textures.begin());
-    for (; it != _textures.end(); ++it) {
-        if ((*it)->getTexture() == texture) {
-            found = true;
-
-            (*it)->decRef();
-            if ((*it)->getRef() == 0) {
-                delete *it;
-                _textures.erase(it);
-            }
-            break;
-        }
+    auto it = _entries.find(texture);
+    if (it == _entries.end()) {
+        _pixmap_cache.remove(texture);
+        delete texture;
+        return;
     }
 
-    if (! found) {
-        delete texture;
+    auto entry = it->second;
+    entry->decRef();
+    if (entry->getRef() == 0) {
+        _pixmap_cache.remove(texture);
+        _entries.erase(it);
+        if (! entry->getName().empty()) {
+            _textures.erase(entry->getName());
+        }
+        delete entry;
+        _stats.textures--;
     }
 }
 
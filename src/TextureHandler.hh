@@ -10,20 +10,38 @@
 
 #include "config.h"
 
+#include "PixmapCache.hh"
 #include "PTexture.hh"
 
-#include <map>
+#include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-extern "C" {
-#include <string.h>
-}
-
 class PTexture;
 
 class TextureHandler {
 public:
+    class Stats {
+    public:
+        Stats(void)
+            : lookups(0),
+              hits(0),
+              parses(0),
+              textures(0)
+        {
+        }
+
+        ulong lookups;
+        /** Lookups served by an already parsed texture. */
+        ulong hits;
+        ulong parses;
+        /** Number of textures currently in use. */
+        ulong textures;
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats);
+    };
+
     class Entry {
     public:
         Entry(const std::string &name, PTexture *texture)
@@ -37,16 +55,13 @@ public:
             delete _texture;
         }
 
+        const std::string &getName(void) const { return _name; }
         PTexture *getTexture(void) { return _texture; }
 
         inline uint getRef(void) const { return _ref; }
         inline void incRef(void) { ++_ref; }
         inline void decRef(void) { if (_ref > 0) { --_ref; } }
 
-        inline bool operator==(const std::string &name) {
-            return (::strcasecmp(_name.c_str(), name.c_str()) == 0);
-        }
-
     private:
         std::string _name;
         PTexture *_texture;
@@ -58,10 +73,15 @@ public:
     ~TextureHandler(void);
 
     int getLengthMin(void) { return _length_min; }
+    PixmapCache &getPixmapCache(void) { return _pixmap_cache; }
+    const Stats &getStats(void) const { return _stats; }
+
     PTexture *getTexture(const std::string &texture);
     PTexture *referenceTexture(PTexture *texture);
     void returnTexture(PTexture *texture);
 
+    static std::string normalizeName(const std::string &texture);
+
 private:
     PTexture *parse(const std::string &texture);
     PTexture *parseSolid(std::vector<std::string> &tok);
@@ -76,8 +96,15 @@ private:
     /** Minimum texture name length. */
     const int _length_min;
 
-    std::vector<TextureHandler::Entry*> _textures;
-    std::map<std::string, std::map<int,int>*> _color_maps;
+    /** Parsed textures, keyed on the normalized texture name. */
+    std::unordered_map<std::string, TextureHandler::Entry*> _textures;
+    /** All referenced textures, including textures without a name. */
+    std::unordered_map<PTexture*, TextureHandler::Entry*> _entries;
+
+    Stats _stats;
+
+    /** Textures rendered to pixmaps, shared by all textures. */
+    PixmapCache _pixmap_cache;
 };
 
 namespace pekwm
@@ -19,15 +19,100 @@
 #include "TextureHandler.hh"
 #include "Util.hh"
 
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <string>
 
+extern "C" {
+#include <sys/stat.h>
+#include <time.h>
+}
+
 #define DEFAULT_FONT "Sans:size=12#XFT"
 #define DEFAULT_LARGE_FONT "Sans:size=14:weight=bold#XFT"
 #define DEFAULT_HEIGHT 17
 #define DEFAULT_HEIGHT_STR "17"
 
+/**
+ * Collect image files used by Image and ImageMapped textures in
+ * section and its sub-sections.
+ */
+static void
+collect_images(CfgParser::Entry *section, std::vector<std::string> &images)
+{
+    for (auto it : *section) {
+        if (it->getSection()) {
+            collect_images(it->getSection(), images);
+            continue;
+        }
+
+        auto &value = it->getValue();
+        auto end = value.find_first_of(" \t");
+        if (end == std::string::npos) {
+            continue;
+        }
+        auto type = value.substr(0, end);
+        if (! strcasecmp(type.c_str(), "IMAGEMAPPED")) {
+            // skip color map name
+            end = value.find_first_not_of(" \t", end);
+            end = value.find_first_of(" \t", end);
+        } else if (strcasecmp(type.c_str(), "IMAGE")) {
+            continue;
+        }
+
+        auto start = value.find_first_not_of(" \t", end);
+        if (start != std::string::npos) {
+            images.push_back(value.substr(start));
+        }
+    }
+}
+
+/**
+ * Add the path, modification time, including nanoseconds where
+ * available, and size of the image files to hash making the hash
+ * change when an image is edited. Relative paths are resolved from
+ * the theme, or theme backgrounds, directory.
+ */
+static uint64_t
+hash_image_files(uint64_t hash, const std::vector<std::string> &images,
+                 const std::string &theme_dir)
+{
+    for (auto &image : images) {
+        auto path = image.substr(0, image.rfind('#'));
+        if (path.empty()) {
+            continue;
+        }
+
+        struct stat stat_buf;
+        if (path[0] == '/') {
+            if (stat(path.c_str(), &stat_buf)) {
+                continue;
+            }
+        } else if (! stat((theme_dir + "/" + path).c_str(), &stat_buf)) {
+            path = theme_dir + "/" + path;
+        } else if (! stat((theme_dir + "/backgrounds/" + path).c_str(),
+                          &stat_buf)) {
+            path = theme_dir + "/backgrounds/" + path;
+        } else {
+            continue;
+        }
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        int64_t mtime_nsec = stat_buf.st_mtim.tv_nsec;
+#else // ! HAVE_STRUCT_STAT_ST_MTIM
+        int64_t mtime_nsec = 0;
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+        int64_t id[3] = {stat_buf.st_mtime, mtime_nsec, stat_buf.st_size};
+        std::string data(path);
+        data.append(reinterpret_cast<const char*>(id), sizeof(id));
+        for (auto c : data) {
+            hash ^= static_cast<uchar>(c);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
 static void parse_pad(const std::string& str, uint *pad)
 {
     std::vector<std::string> tok;
@@ -1175,6 +1260,7 @@ Theme::Theme(FontHandler *fh, ImageHandler *ih, TextureHandler *th,
       _ih(ih),
       _th(th),
       _version(0),
+      _hash(0),
       _loaded(false),
       _invert_gc(None),
       _dialog_data(fh, th),
@@ -1231,8 +1317,11 @@ Theme::load(const std::string &dir, const std::string &variant)
         return false;
     }
 
-    unload();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
+    std::string old_theme_dir(_theme_dir);
+    std::string old_theme_file(_theme_file);
     _theme_dir = norm_dir;
     _theme_file = theme_file;
     if (! _theme_dir.size()) {
@@ -1267,10 +1356,28 @@ Theme::load(const std::string &dir, const std::string &variant)
     }
     auto root = theme.getEntryRoot();
 
+    // Only the modification time changed, keep the loaded theme and
+    // the decors referring to it. The images are part of the hash as
+    // they are re-read when the theme is re-loaded.
+    std::vector<std::string> images;
+    collect_images(root, images);
+    auto hash = theme_ok
+        ? hash_image_files(root->getHash(), images, _theme_dir) : 0;
+    if (_loaded && hash && hash == _hash
+        && _theme_dir == old_theme_dir && _theme_file == old_theme_file) {
+        return false;
+    }
+    _hash = hash;
+
+    unload();
+
     // Set image basedir.
     _ih->path_clear();
     _ih->path_push_back(_theme_dir + "/");
 
+    // Decode theme images in the background while parsing the theme.
+    _ih->prefetch(images);
+
     loadVersion(root);
     loadBackground(root->findSection("BACKGROUND"));
     loadColorMaps(root->findSection("COLORMAPS"));
@@ -1295,8 +1402,15 @@ Theme::load(const std::string &dir, const std::string &variant)
         WARN("Missing \"HARBOUR\" section!");
     }
 
+    _ih->prefetchDone();
     _loaded = true;
 
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    _stats.loads++;
+    _stats.load_ms = Util::timeDiffMs(end, start);
+    _stats.textures = _th->getStats().textures;
+
     return true;
 }
 
@@ -21,6 +21,7 @@ class FontHandler;
 class ImageHandler;
 class TextureHandler;
 
+#include <iostream>
 #include <string>
 #include <map>
 #include <vector>
@@ -29,6 +30,30 @@ class TextureHandler;
 class Theme
 {
 public:
+    class Stats {
+    public:
+        Stats(void)
+            : loads(0),
+              load_ms(0),
+              textures(0)
+        {
+        }
+
+        ulong loads;
+        /** Time spent in the last load. */
+        long load_ms;
+        /** Textures in use after the last load. */
+        ulong textures;
+
+        friend std::ostream &operator<<(std::ostream &os,
+                                        const Stats &stats) {
+            os << "loads " << stats.loads
+               << " last load " << stats.load_ms << "ms"
+               << " textures " << stats.textures;
+            return os;
+        }
+    };
+
     /**
      * Color map for mapping colors in images.
      */
@@ -420,6 +445,7 @@ public:
 
     const std::string& getThemeDir(void) const { return _theme_dir; }
     const std::string& getBackground(void) const { return _background; }
+    const Stats &getStats(void) const { return _stats; }
 
     const ColorMap& getColorMap(const std::string& name) {
         return _color_maps.get(name);
@@ -479,8 +505,12 @@ private:
     std::string _background;
     Util::StringMap<ColorMap> _color_maps;
     TimeFiles _cfg_files;
+    /** Hash of the last loaded theme, unchanged content is not
+        re-applied. */
+    uint64_t _hash;
 
     bool _loaded;
+    Stats _stats;
 
     // gc
     GC _invert_gc;
@@ -109,6 +109,20 @@ std::string getEnv(const std::string& key)
     return val ? val : "";
 }
 
+/**
+ * Return pekwm cache directory, $XDG_CACHE_HOME/pekwm falling back to
+ * $HOME/.cache/pekwm.
+ */
+std::string
+getCacheDir(void)
+{
+    auto cache_home = getEnv("XDG_CACHE_HOME");
+    if (cache_home.empty()) {
+        cache_home = getEnv("HOME") + "/.cache";
+    }
+    return cache_home + "/pekwm";
+}
+
 /**
  * Fork and execute command with /bin/sh and execlp
  */
@@ -218,6 +232,26 @@ setNonBlock(int fd)
     return true;
 }
 
+/**
+ * Get difference, t1 - t2, in milliseconds.
+ */
+long
+timeDiffMs(const struct timespec &t1, const struct timespec &t2)
+{
+    return (t1.tv_sec - t2.tv_sec) * 1000
+        + (t1.tv_nsec - t2.tv_nsec) / 1000000L;
+}
+
+/**
+ * Get difference, t1 - t2, in microseconds.
+ */
+long
+timeDiffUs(const struct timespec &t1, const struct timespec &t2)
+{
+    return (t1.tv_sec - t2.tv_sec) * 1000000L
+        + (t1.tv_nsec - t2.tv_nsec) / 1000L;
+}
+
 //! @brief Determines if the file exists
 bool
 isFile(const std::string &file)
@@ -278,6 +312,23 @@ getMtime(const std::string &file)
     }
 }
 
+/**
+ * Create dir and all of its parents.
+ */
+bool
+makeDirs(const std::string &dir)
+{
+    size_t pos = 0;
+    do {
+        pos = dir.find('/', pos + 1);
+        auto path = dir.substr(0, pos);
+        if (mkdir(path.c_str(), 0700) && errno != EEXIST) {
+            return false;
+        }
+    } while (pos != std::string::npos);
+    return true;
+}
+
 /**
  * Copies a single text file.
  */
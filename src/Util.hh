@@ -22,6 +22,7 @@
 
 extern "C" {
 #include <string.h>
+#include <time.h>
 }
 
 /**
@@ -109,15 +110,20 @@ namespace Util {
     }
 
     std::string getEnv(const std::string& key);
+    std::string getCacheDir(void);
 
     void forkExec(std::string command);
     pid_t forkExec(const std::vector<std::string>& args);
     std::string getHostname(void);
     bool setNonBlock(int fd);
 
+    long timeDiffMs(const struct timespec &t1, const struct timespec &t2);
+    long timeDiffUs(const struct timespec &t1, const struct timespec &t2);
+
     bool isFile(const std::string &file);
     bool isExecutable(const std::string &file);
     time_t getMtime(const std::string &file);
+    bool makeDirs(const std::string &dir);
 
     bool copyTextFile(const std::string &from, const std::string &to);
 
@@ -18,51 +18,130 @@
 #include "X11Util.hh"
 #include "X11.hh"
 
-static PWinObj*
-isEmptySpace(int x, int y, const PWinObj* wo, std::vector<PWinObj*> &wvec)
+#include <utility>
+
+SmartPlacement::SmartPlacement(const Geometry &head, bool row,
+                               bool ltr, bool ttb,
+                               int offset_x, int offset_y)
+    : _row(row),
+      _head(row ? head : Geometry(head.y, head.x, head.height, head.width)),
+      _ltr(row ? ltr : ttb),
+      _ttb(row ? ttb : ltr),
+      _offset_x(row ? offset_x : offset_y),
+      _offset_y(row ? offset_y : offset_x)
 {
-    if (! wo) {
-        return 0;
-    }
+}
 
-    if (wvec.empty()) {
-        // say that it's placed, now check if we are wrong!
-        auto it(Workspaces::begin());
-        auto end(Workspaces::end());
-        for (; it != end; ++it) {
-            // Skip ourselves, non-mapped and desktop objects. Iconified means
-            // skip placement.
-            if (wo == (*it) || ! (*it)->isMapped() || (*it)->isIconified()
-                || ((*it)->getLayer() == LAYER_DESKTOP)) {
-                continue;
-            }
+void
+SmartPlacement::addObstacle(const Geometry &gm)
+{
+    _obstacles.push_back(transpose(gm));
+}
 
-            // Also skip windows tagged as Maximized as they cause us to
-            // automatically fail.
-            if ((*it)->getType() == PWinObj::WO_FRAME) {
-                Client *client = static_cast<Frame*>((*it))->getActiveClient();
-                if (client &&
-                    (client->isFullscreen()
-                     || (client->isMaximizedVert() && client->isMaximizedHorz()))) {
-                    continue;
+/**
+ * Find position for a window of width x height, offset is added to
+ * the size when checking that the window fits on the head and to the
+ * returned position.
+ *
+ * @return true if a position was found, x and y set.
+ */
+bool
+SmartPlacement::place(uint width, uint height, int &x, int &y) const
+{
+    if (! _row) {
+        std::swap(width, height);
+    }
+
+    int offset_x = _ltr ? _offset_x : -_offset_x;
+    int offset_y = _ttb ? _offset_y : -_offset_y;
+
+    // Wrap these up, to get proper checking of space.
+    uint wo_width = width + _offset_x;
+    uint wo_height = height + _offset_y;
+
+    int start_x = _ltr ? _head.x : _head.x + _head.width - wo_width;
+    int test_y = _ttb ? _head.y : _head.y + _head.height - wo_height;
+
+    while (_ttb
+           ? test_y + wo_height <= _head.y + _head.height
+           : test_y >= _head.y) {
+        int test_x = start_x;
+        while (_ltr
+               ? test_x + wo_width <= _head.x + _head.width
+               : test_x >= _head.x) {
+            const Geometry *gm = findObstacle(test_x, test_y, width, height);
+            if (! gm) {
+                x = test_x + offset_x;
+                y = test_y + offset_y;
+                if (! _row) {
+                    std::swap(x, y);
                 }
+                return true;
             }
+            test_x = _ltr ? gm->x + gm->width : gm->x - wo_width;
+        }
 
-            wvec.push_back(*it);
+        if (! nextRow(test_y, height)) {
+            break;
         }
     }
+    return false;
+}
 
-    for (unsigned i=0; i < wvec.size(); ++i) {
-        // Check if we are "intruding" on some other window's place
-        if ((wvec[i]->getX() < signed(x + wo->getWidth())) &&
-            (signed(wvec[i]->getX() + wvec[i]->getWidth()) > x) &&
-            (wvec[i]->getY() < signed(y + wo->getHeight())) &&
-            (signed(wvec[i]->getY() + wvec[i]->getHeight()) > y)) {
-            return wvec[i];
+/**
+ * Get the first obstacle overlapping a window of width x height at x,
+ * y.
+ */
+const Geometry*
+SmartPlacement::findObstacle(int x, int y, uint width, uint height) const
+{
+    for (auto &gm : _obstacles) {
+        if ((gm.x < signed(x + width))
+            && (signed(gm.x + gm.width) > x)
+            && (gm.y < signed(y + height))
+            && (signed(gm.y + gm.height) > y)) {
+            return &gm;
         }
     }
+    return nullptr;
+}
 
-    return 0; // we passed the test, no frames in the way
+/**
+ * Move y to the next row where the set of obstacles overlapping a
+ * window of height height changes, rows in between give the same
+ * result as the current row.
+ *
+ * @return false if the set does not change in any of the remaining
+ *         rows.
+ */
+bool
+SmartPlacement::nextRow(int &y, uint height) const
+{
+    bool found = false;
+    int next = y;
+    for (auto &gm : _obstacles) {
+        // gm overlaps the window in rows first to last
+        int first = gm.y - signed(height) + 1;
+        int last = gm.y + signed(gm.height) - 1;
+        int changes[2];
+        if (_ttb) {
+            changes[0] = first;
+            changes[1] = last + 1;
+        } else {
+            changes[0] = first - 1;
+            changes[1] = last;
+        }
+        for (auto change : changes) {
+            if (_ttb
+                ? (change > y && (! found || change < next))
+                : (change < y && (! found || change > next))) {
+                next = change;
+                found = true;
+            }
+        }
+    }
+    y = next;
+    return found;
 }
 
 //! @brief Tries to find empty space to place the client in
@@ -80,73 +159,45 @@ private:
             return true;
         }
 
-        PWinObj *wo_e;
-        bool placed = false;
-        std::vector<PWinObj*> wvec;
-
-        int step_x = (pekwm::config()->getPlacementLtR()) ? 1 : -1;
-        int step_y = (pekwm::config()->getPlacementTtB()) ? 1 : -1;
-        int offset_x = (pekwm::config()->getPlacementLtR())
-                       ? pekwm::config()->getPlacementOffsetX()
-                       : -pekwm::config()->getPlacementOffsetX();
-        int offset_y = (pekwm::config()->getPlacementTtB())
-                       ? pekwm::config()->getPlacementOffsetY()
-                       : -pekwm::config()->getPlacementOffsetY();
-        int start_x, start_y, test_x = 0, test_y = 0;
-
-        // Wrap these up, to get proper checking of space.
-        uint wo_width = wo->getWidth() + pekwm::config()->getPlacementOffsetX();
-        uint wo_height = wo->getHeight() + pekwm::config()->getPlacementOffsetY();
-
-        start_x = pekwm::config()->getPlacementLtR() ?
-                  _gm.x : _gm.x + _gm.width - wo_width;
-        start_y = pekwm::config()->getPlacementTtB() ?
-                  _gm.y : _gm.y + _gm.height - wo_height;
-
-        if (pekwm::config()->getPlacementRow()) { // row placement
-            test_y = start_y;
-            while (! placed && (pekwm::config()->getPlacementTtB()
-                               ? test_y + wo_height <= _gm.y + _gm.height
-                               : test_y >= _gm.y)) {
-                test_x = start_x;
-                while (! placed && (pekwm::config()->getPlacementLtR()
-                                    ? test_x + wo_width <= _gm.x + _gm.width
-                                    : test_x >= _gm.x)) {
-                    // see if we can place the window here
-                    if ((wo_e = isEmptySpace(test_x, test_y, wo, wvec))) {
-                        placed = false;
-                        test_x = pekwm::config()->getPlacementLtR() ?
-                                 wo_e->getX() + wo_e->getWidth() : wo_e->getX() - wo_width;
-                    } else {
-                        placed = true;
-                        wo->move(test_x + offset_x, test_y + offset_y);
-                    }
-                }
-                test_y += step_y;
+        auto cfg = pekwm::config();
+        SmartPlacement placement(_gm, cfg->getPlacementRow(),
+                                 cfg->getPlacementLtR(),
+                                 cfg->getPlacementTtB(),
+                                 cfg->getPlacementOffsetX(),
+                                 cfg->getPlacementOffsetY());
+
+        auto it(Workspaces::begin());
+        auto end(Workspaces::end());
+        for (; it != end; ++it) {
+            // Skip ourselves, non-mapped and desktop objects. Iconified means
+            // skip placement.
+            if (wo == (*it) || ! (*it)->isMapped() || (*it)->isIconified()
+                || ((*it)->getLayer() == LAYER_DESKTOP)) {
+                continue;
             }
-        } else { // column placement
-            test_x = start_x;
-            while (! placed && (pekwm::config()->getPlacementLtR()
-                                ? test_x + wo_width <= _gm.x + _gm.width
-                                : test_x >= _gm.x)) {
-                test_y = start_y;
-                while (! placed && (pekwm::config()->getPlacementTtB()
-                                    ? test_y + wo_height <= _gm.y + _gm.height
-                                    : test_y >= _gm.y)) {
-                    // see if we can place the window here
-                    if ((wo_e = isEmptySpace(test_x, test_y, wo, wvec))) {
-                        placed = false;
-                        test_y = pekwm::config()->getPlacementTtB() ?
-                                 wo_e->getY() + wo_e->getHeight() : wo_e->getY() - wo_height;
-                    } else {
-                        placed = true;
-                        wo->move(test_x + offset_x, test_y + offset_y);
-                    }
+
+            // Also skip windows tagged as Maximized as they cause us to
+            // automatically fail.
+            if ((*it)->getType() == PWinObj::WO_FRAME) {
+                Client *client = static_cast<Frame*>((*it))->getActiveClient();
+                if (client &&
+                    (client->isFullscreen()
+                     || (client->isMaximizedVert() && client->isMaximizedHorz()))) {
+                    continue;
                 }
-                test_x += step_x;
             }
+
+            Geometry gm;
+            (*it)->getGeometry(gm);
+            placement.addObstacle(gm);
         }
-        return placed;
+
+        int x, y;
+        if (placement.place(wo->getWidth(), wo->getHeight(), x, y)) {
+            wo->move(x, y);
+            return true;
+        }
+        return false;
     }
 };
 
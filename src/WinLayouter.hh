@@ -15,6 +15,45 @@
 
 class Frame;
 
+/**
+ * Smart placement, finds the first position where a window does not
+ * overlap any of the obstacles scanning the head row by row (or
+ * column by column) in the configured direction.
+ *
+ * Rows are only checked where the set of obstacles overlapping the
+ * row changes, as the result of checking a row only depends on that
+ * set. Within a row, positions overlapping an obstacle are skipped by
+ * jumping past it.
+ */
+class SmartPlacement {
+public:
+    SmartPlacement(const Geometry &head, bool row, bool ltr, bool ttb,
+                   int offset_x, int offset_y);
+    ~SmartPlacement(void) { }
+
+    void addObstacle(const Geometry &gm);
+    bool place(uint width, uint height, int &x, int &y) const;
+
+private:
+    const Geometry *findObstacle(int x, int y,
+                                 uint width, uint height) const;
+    bool nextRow(int &y, uint height) const;
+
+    /** Swap x and y of gm when placing by column. */
+    Geometry transpose(const Geometry &gm) const {
+        return _row ? gm : Geometry(gm.y, gm.x, gm.height, gm.width);
+    }
+
+    /** Placement is done by row, column placement is transposed. */
+    bool _row;
+    Geometry _head;
+    bool _ltr;
+    bool _ttb;
+    int _offset_x;
+    int _offset_y;
+    std::vector<Geometry> _obstacles;
+};
+
 class WinLayouter {
 public:
     WinLayouter() {}
@@ -26,6 +26,7 @@
 #include "PFont.hh"
 #include "PTexture.hh"
 #include "FontHandler.hh"
+#include "ImageHandler.hh"
 #include "TextureHandler.hh"
 #include "Workspaces.hh"
 #include "Util.hh"
@@ -67,43 +68,6 @@ extern "C" {
 // include after all includes to get ifndefs right
 #include "Compat.hh"
 
-extern "C" {
-
-    static bool is_signal = false;
-    static bool is_signal_hup = false;
-    static bool is_signal_int_term = false;
-    static bool is_signal_alrm = false;
-    static bool is_signal_chld = false;
-
-    /**
-      * Signal handler setting signal flags.
-      */
-    static void
-    sigHandler(int signal)
-    {
-        is_signal = true;
-
-        switch (signal) {
-        case SIGHUP:
-            is_signal_hup = true;
-            break;
-        case SIGINT:
-        case SIGTERM:
-            is_signal_int_term = true;
-            break;
-        case SIGCHLD:
-            is_signal_chld = true;
-            break;
-        case SIGALRM:
-            // Do nothing, just used to break out of waiting
-            is_signal_alrm = true;
-            break;
-        }
-    }
-
-} // extern "C"
-
-
 // WindowManager
 
 /**
@@ -166,23 +130,58 @@ WindowManager::WindowManager()
     _screen_edges[2] = 0;
     _screen_edges[3] = 0;
 
-    struct sigaction act;
-
-    // Set up the signal handlers.
-    act.sa_handler = sigHandler;
-    act.sa_mask = sigset_t();
-    act.sa_flags = SA_NOCLDSTOP | SA_NODEFER;
-
-    sigaction(SIGTERM, &act, 0);
-    sigaction(SIGINT, &act, 0);
-    sigaction(SIGHUP, &act, 0);
-    sigaction(SIGCHLD, &act, 0);
-    sigaction(SIGALRM, &act, 0);
+    _reactor.addSignal(SIGTERM);
+    _reactor.addSignal(SIGINT);
+    _reactor.addSignal(SIGHUP);
+    _reactor.addSignal(SIGCHLD);
+
+    Debug::addStats("clients", [](std::ostream &os) {
+                                   os << Client::getManageStats();
+                               });
+    Debug::addStats("startup", [this](std::ostream &os) {
+                                   os << _startup_stats;
+                               });
+    Debug::addStats("reload", [this](std::ostream &os) {
+                                   os << _reload_stats;
+                               });
+    Debug::addStats("client_list", [](std::ostream &os) {
+                                   os << Workspaces::getClientListStats();
+                               });
+    Debug::addStats("titles", [](std::ostream &os) {
+                                   os << PDecor::getTitleStats();
+                               });
+    Debug::addStats("pixmaps", [](std::ostream &os) {
+                                   auto th = pekwm::textureHandler();
+                                   os << th->getPixmapCache().getStats();
+                               });
+    Debug::addStats("theme", [](std::ostream &os) {
+                                   os << pekwm::theme()->getStats();
+                               });
+    Debug::addStats("textures", [](std::ostream &os) {
+                                   os << pekwm::textureHandler()->getStats();
+                               });
+    Debug::addStats("images", [](std::ostream &os) {
+                                   os << pekwm::imageHandler()->getStats();
+                               });
+    Debug::addStats("image_cache", [](std::ostream &os) {
+                                   auto ih = pekwm::imageHandler();
+                                   os << ih->getDiskCache().getStats();
+                               });
 }
 
 //! @brief WindowManager destructor
 WindowManager::~WindowManager(void)
 {
+    Debug::removeStats("clients");
+    Debug::removeStats("startup");
+    Debug::removeStats("reload");
+    Debug::removeStats("client_list");
+    Debug::removeStats("titles");
+    Debug::removeStats("pixmaps");
+    Debug::removeStats("theme");
+    Debug::removeStats("textures");
+    Debug::removeStats("images");
+    Debug::removeStats("image_cache");
     cleanup();
 
     MenuHandler::deleteMenus();
@@ -271,9 +270,11 @@ WindowManager::setupDisplay(Display* dpy)
 {
     pekwm::autoProperties()->load();
 
-    Workspaces::init();
+    Workspaces::init(&_reactor);
     Workspaces::setSize(pekwm::config()->getWorkspaces());
     Workspaces::setPerRow(pekwm::config()->getWorkspacesPerRow());
+    pekwm::textureHandler()->getPixmapCache().setSize(
+        pekwm::config()->getTextureCacheSize() * 1024);
 
     MenuHandler::createMenus(pekwm::actionHandler());
 
@@ -297,15 +298,43 @@ WindowManager::scanWindows(void)
         return;
     }
 
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     uint num_wins;
     Window d_win1, d_win2, *wins;
 
+    // keep the server grabbed while scanning, prefetched data is
+    // only valid as long as no other client can change it.
+    X11::grabServer();
+
     // Lets create a list of windows on the display
     XQueryTree(X11::getDpy(), X11::getRoot(),
                &d_win1, &d_win2, &wins, &num_wins);
     std::vector<Window> win_list(wins, wins + num_wins);
     X11::free(wins);
 
+    // Phase 1, read attributes and hints of all windows in a single
+    // round-trip followed by the properties of all windows that will
+    // be managed in another round-trip.
+    X11::prefetchWindows(win_list, std::vector<Atom>(1, XA_WM_HINTS), true);
+
+    std::vector<Window> manage_list;
+    for (auto win : win_list) {
+        XWindowAttributes attr;
+        if (X11::getWindowAttributes(win, attr)
+            && ! attr.override_redirect && attr.map_state != IsUnmapped) {
+            manage_list.push_back(win);
+        }
+    }
+
+    std::vector<Atom> atoms;
+    Client::getPrefetchAtoms(atoms);
+    X11::prefetchWindows(manage_list, atoms, false);
+
+    struct timespec prefetched;
+    clock_gettime(CLOCK_MONOTONIC, &prefetched);
+
     auto it(win_list.begin());
 
     // We filter out all windows with the the IconWindowHint
@@ -316,7 +345,7 @@ WindowManager::scanWindows(void)
             continue;
         }
 
-        auto wm_hints = XGetWMHints(X11::getDpy(), *it);
+        auto wm_hints = X11::getWMHints(*it);
         if (wm_hints) {
             if ((wm_hints->flags&IconWindowHint) &&
                     (wm_hints->icon_window != *it)) {
@@ -329,11 +358,23 @@ WindowManager::scanWindows(void)
         }
     }
 
+    // Phase 2, create clients and frames.
     for (it = win_list.begin(); it != win_list.end(); ++it) {
         if (*it != None) {
             createClient(*it, false);
+            X11::clearPrefetched(*it);
         }
     }
+    X11::clearAllPrefetched();
+    X11::ungrabServer(true);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    _startup_stats.windows = win_list.size();
+    _startup_stats.managed = Client::client_size();
+    _startup_stats.prefetch_ms = Util::timeDiffMs(prefetched, start);
+    _startup_stats.manage_ms = Util::timeDiffMs(end, prefetched);
+    LOG("startup scan: " << _startup_stats);
 
     // Try to focus the ontop window, if no window we give root focus
     PWinObj *wo = Workspaces::getTopWO(PWinObj::WO_FRAME);
@@ -439,29 +480,75 @@ WindowManager::screenEdgeMapUnmap(void)
     }
 }
 
-//! @brief Reloads configuration and updates states.
+/**
+ * Reloads configuration and updates states. Each step only re-applies
+ * its configuration if the content changed since the last load.
+ */
 void
 WindowManager::doReload(void)
 {
-    doReloadConfig();
-    doReloadTheme();
-    doReloadMouse();
-    doReloadKeygrabber();
-    doReloadAutoproperties();
+    _reload_stats.reloads++;
+    _reload_stats.steps.clear();
+
+    bool config = doReloadStep("config",
+                               [this] { return doReloadConfig(); });
+    bool theme = doReloadStep("theme", [this, config] {
+                                           return doReloadTheme(config);
+                                       });
+    doReloadStep("mouse", [this] { return doReloadMouse(); });
+    doReloadStep("keys", [this] { return doReloadKeygrabber(); });
+    doReloadStep("autoproperties",
+                 [this] { return doReloadAutoproperties(); });
+    doReloadStep("menus", [] {
+                              auto act = pekwm::actionHandler();
+                              return MenuHandler::reloadMenus(act);
+                          });
+
+    // Harbour uses the harbour theme and HARBOUR config section
+    bool harbour = theme || pekwm::config()->isChanged("HARBOUR");
+    doReloadStep("harbour", [this, harbour] {
+                                if (harbour) {
+                                    doReloadHarbour();
+                                }
+                                return harbour;
+                            });
+
+    if (config) {
+        pekwm::rootWo()->setEwmhDesktopNames();
+        pekwm::rootWo()->setEwmhDesktopLayout();
+    }
+    LOG("reload: " << _reload_stats);
 
-    MenuHandler::reloadMenus(pekwm::actionHandler());
-    doReloadHarbour();
+    _reload = false;
+}
 
-    pekwm::rootWo()->setEwmhDesktopNames();
-    pekwm::rootWo()->setEwmhDesktopLayout();
+/**
+ * Run reload step, recording if it rebuilt anything and the time
+ * spent.
+ *
+ * @return true if step rebuilt anything.
+ */
+bool
+WindowManager::doReloadStep(const char *name, std::function<bool()> step)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    _reload = false;
+    bool rebuilt = step();
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ReloadStats::Step stats = {name, rebuilt, Util::timeDiffMs(end, start)};
+    _reload_stats.steps.push_back(stats);
+    return rebuilt;
 }
 
 /**
  * Reload main config file.
+ *
+ * @return true if configuration changed.
  */
-void
+bool
 WindowManager::doReloadConfig(void)
 {
     // If any of these changes, re-fetch of all names is required
@@ -471,13 +558,18 @@ WindowManager::doReloadConfig(void)
 
     // Reload configuration
     if (! pekwm::config()->load(pekwm::config()->getConfigFile())) {
-        return;
+        return false;
     }
 
     // Update what might have changed in the cfg touching the hints
     Workspaces::setSize(pekwm::config()->getWorkspaces());
     Workspaces::setPerRow(pekwm::config()->getWorkspacesPerRow());
     Workspaces::setNames();
+    pekwm::textureHandler()->getPixmapCache().setSize(
+        pekwm::config()->getTextureCacheSize() * 1024);
+    pekwm::imageHandler()->getDiskCache().setDir(
+        pekwm::config()->isImageDiskCache()
+        ? ImageDiskCache::getDefaultDir() : "");
 
     // Update the ClientUniqueNames if needed
     if ((old_client_unique_name != pekwm::config()->getClientUniqueName()) ||
@@ -492,18 +584,29 @@ WindowManager::doReloadConfig(void)
     screenEdgeMapUnmap();
 
     pekwm::rootWo()->updateStrut();
+    return true;
 }
 
 /**
  * Reload theme file and update decorations.
+ *
+ * @param config Configuration changed, the background is restarted as
+ *               background options could have changed.
+ * @return true if theme changed.
  */
-void
-WindowManager::doReloadTheme(void)
+bool
+WindowManager::doReloadTheme(bool config)
 {
     // Reload the theme
     if (! pekwm::theme()->load(pekwm::config()->getThemeFile(),
                                pekwm::config()->getThemeVariant())) {
-        return;
+        // Theme unchanged, restart the background if it has exited or
+        // stop it if disabled.
+        if (config || _bg_pid == -1) {
+            startBackground(pekwm::theme()->getThemeDir(),
+                            pekwm::theme()->getBackground());
+        }
+        return false;
     }
 
     startBackground(pekwm::theme()->getThemeDir(),
@@ -512,6 +615,7 @@ WindowManager::doReloadTheme(void)
     // Reload the themes on all decors
     for_each(PDecor::pdecor_begin(), PDecor::pdecor_end(),
              std::mem_fn(&PDecor::loadDecor));
+    return true;
 }
 
 void
@@ -521,8 +625,11 @@ WindowManager::startBackground(const std::string& theme_dir,
     stopBackground();
     if (pekwm::config()->getThemeBackground() && ! texture.empty()) {
         std::vector<std::string> args =
-            {BINDIR "/pekwm_bg", "--load-dir", theme_dir + "/backgrounds",
-             texture};
+            {BINDIR "/pekwm_bg", "--load-dir", theme_dir + "/backgrounds"};
+        if (pekwm::config()->isImageDiskCache()) {
+            args.push_back("--cache");
+        }
+        args.push_back(texture);
         _bg_pid = Util::forkExec(args);
     }
 }
@@ -540,27 +647,32 @@ WindowManager::stopBackground(void)
 
 /**
  * Reload mouse configuration and re-grab buttons on all windows.
+ *
+ * @return true if mouse configuration changed.
  */
-void
+bool
 WindowManager::doReloadMouse(void)
 {
     if (! pekwm::config()->loadMouseConfig(pekwm::config()->getMouseConfigFile())) {
-        return;
+        return false;
     }
 
     for_each(Client::client_begin(), Client::client_end(),
              std::mem_fn(&Client::grabButtons));
+    return true;
 }
 
 /**
  * Reload keygrabber configuration and re-grab keys on all windows.
+ *
+ * @return true if key configuration changed.
  */
-void
+bool
 WindowManager::doReloadKeygrabber(bool force)
 {
     // Reload the keygrabber
     if (! pekwm::keyGrabber()->load(pekwm::config()->getKeyFile(), force)) {
-        return;
+        return false;
     }
 
     pekwm::keyGrabber()->ungrabKeys(X11::getRoot());
@@ -573,16 +685,19 @@ WindowManager::doReloadKeygrabber(bool force)
         pekwm::keyGrabber()->ungrabKeys((*c_it)->getWindow());
         pekwm::keyGrabber()->grabKeys((*c_it)->getWindow());
     }
+    return true;
 }
 
 /**
  * Reload autoproperties.
+ *
+ * @return true if autoproperties changed.
  */
-void
+bool
 WindowManager::doReloadAutoproperties(void)
 {
     if (! pekwm::autoProperties()->load()) {
-        return;
+        return false;
     }
 
     // NOTE: we need to load autoproperties after decor have been updated
@@ -596,6 +711,7 @@ WindowManager::doReloadAutoproperties(void)
     for (; it_f != Frame::frame_end(); ++it_f) {
         (*it_f)->readAutoprops(APPLY_ON_RELOAD);
     }
+    return true;
 }
 
 /**
@@ -626,27 +742,20 @@ WindowManager::restart(std::string command)
 // Event handling routins beneath this =====================================
 
 void
-WindowManager::handleSignals(void)
+WindowManager::handleSignal(int signum)
 {
-    TRACE("handle received signal(s):"
-          << " SIGALRM " << is_signal_alrm
-          << " SIGHUP " << is_signal_hup
-          << " SIGCHILD " << is_signal_chld);
+    TRACE("handle received signal " << signum);
 
-    // SIGALRM used to timeout workspace indicator
-    if (is_signal_alrm) {
-        is_signal_alrm = false;
-        Workspaces::hideWorkspaceIndicator();
-    }
-
-    // SIGHUP
-    if (is_signal_hup || _reload) {
-        is_signal_hup = false;
+    switch (signum) {
+    case SIGHUP:
         doReload();
-    }
-
-    // Wait for children if a SIGCHLD was received
-    if (is_signal_chld) {
+        break;
+    case SIGINT:
+    case SIGTERM:
+        _shutdown = true;
+        break;
+    case SIGCHLD: {
+        // Wait for children if a SIGCHLD was received
         pid_t pid;
         do {
             pid = waitpid(WAIT_ANY, nullptr, WNOHANG);
@@ -658,32 +767,51 @@ WindowManager::handleSignals(void)
                 TRACE("no more finished child processes");
             } else {
                 TRACE("child process " << pid << " finished");
+                if (pid == _bg_pid) {
+                    _bg_pid = -1;
+                }
             }
         } while (pid > 0 || (pid == -1 && errno == EINTR));
-
-        is_signal_chld = false;
+        break;
+    }
     }
 }
 
 void
 WindowManager::doEventLoop(void)
 {
+    std::vector<Reactor::Event> events;
+    struct timeval no_wait = { 0, 0 };
     XEvent ev;
 
-    while (! _shutdown && ! is_signal_int_term) {
-        if (is_signal) {
-            handleSignals();
-            is_signal = false;
-        }
+    _reactor.addFd(ConnectionNumber(X11::getDpy()));
+
+    while (! _shutdown) {
         if (_reload) {
             doReload();
         }
 
-        // Get next event, drop event handling if none was given
-        if (X11::getNextEvent(ev)) {
+        // Check for signals once per batch of X events, only block
+        // if no X events are queued.
+        Workspaces::publishClientList();
+        X11::flush();
+        if (_reactor.wait(events, X11::pending() ? 0 : -1)) {
+            for (auto &rev : events) {
+                if (rev.type == Reactor::EVENT_SIGNAL) {
+                    handleSignal(rev.value);
+                } else if (rev.type == Reactor::EVENT_TIMER) {
+                    Workspaces::handleTimer(rev.value);
+                }
+            }
+        }
+
+        while (! _shutdown && X11::getNextEvent(ev, &no_wait)) {
             if (! _event_handler || ! handleEventHandlerEvent(ev)) {
                 handleEvent(ev);
             }
+            if (! X11::hasBatchedEvents()) {
+                break;
+            }
         }
     }
 }
@@ -1445,10 +1573,12 @@ WindowManager::createClient(Window window, bool is_new)
     ClientInitConfig initConfig;
 
     XWindowAttributes attr;
-    XGetWindowAttributes(X11::getDpy(), window, &attr);
+    if (! X11::getWindowAttributes(window, attr)) {
+        return nullptr;
+    }
     if (! attr.override_redirect && (is_new || attr.map_state != IsUnmapped)) {
         // We need to figure out whether or not this is a dockapp.
-        XWMHints *wm_hints = XGetWMHints(X11::getDpy(), window);
+        XWMHints *wm_hints = X11::getWMHints(window);
         if (wm_hints) {
             if ((wm_hints->flags&StateHint)
                 && (wm_hints->initial_state == WithdrawnState)) {
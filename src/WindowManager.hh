@@ -22,9 +22,88 @@
 #include "EventLoop.hh"
 #include "ManagerWindows.hh"
 #include "PWinObj.hh"
+#include "Reactor.hh"
 
 #include <algorithm>
+#include <functional>
 #include <map>
+#include <vector>
+
+/**
+ * Timing of the scan for existing windows done at startup.
+ */
+class StartupStats {
+public:
+    StartupStats(void)
+        : windows(0),
+          managed(0),
+          prefetch_ms(0),
+          manage_ms(0)
+    {
+    }
+
+    /** Number of windows found on the root window. */
+    ulong windows;
+    /** Number of clients managed. */
+    ulong managed;
+    /** Time spent reading window attributes and properties. */
+    long prefetch_ms;
+    /** Time spent creating clients and frames. */
+    long manage_ms;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const StartupStats &stats) {
+        os << "windows " << stats.windows
+           << " managed " << stats.managed
+           << " total " << (stats.prefetch_ms + stats.manage_ms) << "ms"
+           << " (prefetch " << stats.prefetch_ms << "ms"
+           << " manage " << stats.manage_ms << "ms)";
+        return os;
+    }
+};
+
+/**
+ * Steps run by the last reload, steps with unchanged configuration
+ * skip rebuilding.
+ */
+class ReloadStats {
+public:
+    class Step {
+    public:
+        const char *name;
+        /** Set to true if the step rebuilt anything. */
+        bool rebuilt;
+        long ms;
+    };
+
+    ReloadStats(void)
+        : reloads(0)
+    {
+    }
+
+    /** Number of reloads. */
+    ulong reloads;
+    /** Steps of the last reload. */
+    std::vector<Step> steps;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const ReloadStats &stats) {
+        long total_ms = 0;
+        for (auto &step : stats.steps) {
+            total_ms += step.ms;
+        }
+        os << "reloads " << stats.reloads << " total " << total_ms << "ms";
+        for (auto &step : stats.steps) {
+            os << " " << step.name;
+            if (step.rebuilt) {
+                os << " " << step.ms << "ms";
+            } else {
+                os << " unchanged";
+            }
+        }
+        return os;
+    }
+};
 
 class WindowManager : public AppCtrl,
                       public EventLoop
@@ -71,14 +150,15 @@ private:
     void scanWindows(void);
     void execStartFile(void);
 
-    void handleSignals(void);
+    void handleSignal(int signum);
 
     void doReload(void);
-    void doReloadConfig(void);
-    void doReloadTheme(void);
-    void doReloadMouse(void);
-    void doReloadKeygrabber(bool force=false);
-    void doReloadAutoproperties(void);
+    bool doReloadStep(const char *name, std::function<bool()> step);
+    bool doReloadConfig(void);
+    bool doReloadTheme(bool config);
+    bool doReloadMouse(void);
+    bool doReloadKeygrabber(bool force=false);
+    bool doReloadAutoproperties(void);
     void doReloadHarbour(void);
 
     void startBackground(const std::string& theme_dir,
@@ -137,6 +217,11 @@ private:
 
     EventHandler *_event_handler;
 
+    /** Main loop, waits for X11 connection and signals. */
+    Reactor _reactor;
+    StartupStats _startup_stats;
+    ReloadStats _reload_stats;
+
     EdgeWO *_screen_edges[4];
 
     /**
@@ -16,18 +16,17 @@
 #include "Frame.hh"
 #include "Client.hh" // For isSkip()
 #include "ManagerWindows.hh"
+#include "Reactor.hh"
 #include "WinLayouter.hh"
 #include "WorkspaceIndicator.hh"
 #include "X11.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <limits>
 
 extern "C" {
-#include <signal.h>
-#include <sys/time.h>
-
 #include <X11/Xatom.h> // for XA_WINDOW
 }
 
@@ -63,22 +62,36 @@ Workspace::setDefaultLayouter(const std::string &layo)
 uint Workspaces::_active;
 uint Workspaces::_previous;
 uint Workspaces::_per_row;
-std::vector<PWinObj*> Workspaces::_wobjs;
+StackingList<PWinObj*> Workspaces::_wobjs;
 std::vector<Workspace> Workspaces::_workspaces;
 std::vector<Frame*> Workspaces::_mru;
 WorkspaceIndicator* Workspaces::_workspace_indicator = nullptr;
+Reactor* Workspaces::_reactor = nullptr;
+int Workspaces::_workspace_indicator_timer = 0;
+bool Workspaces::_client_list_dirty = false;
+bool Workspaces::_client_list_stacking_dirty = false;
+std::vector<Window> Workspaces::_client_list;
+std::vector<Window> Workspaces::_client_list_published;
+std::vector<Window> Workspaces::_client_list_stacking_published;
+ClientListStats Workspaces::_client_list_stats;
 
 WinLayouter *Workspace::_default_layouter = WinLayouterFactory("SMART");
 
 void
-Workspaces::init(void)
+Workspaces::init(Reactor *reactor)
 {
+    _reactor = reactor;
     _workspace_indicator = new WorkspaceIndicator();
 }
 
 void
 Workspaces::cleanup()
 {
+    if (_workspace_indicator_timer) {
+        _reactor->removeTimer(_workspace_indicator_timer);
+        _workspace_indicator_timer = 0;
+    }
+    _reactor = nullptr;
     delete _workspace_indicator;
 }
 
@@ -182,12 +195,10 @@ Workspaces::showWorkspaceIndicator(void)
         _workspace_indicator->mapWindowRaised();
         PWinObj::setSkipEnterAfter(_workspace_indicator);
 
-        struct itimerval value;
-        timerclear(&value.it_value);
-        timerclear(&value.it_interval);
-        value.it_value.tv_sec += timeout / 1000;
-        value.it_value.tv_usec += (timeout % 1000) * 1000;
-        setitimer(ITIMER_REAL, &value, 0);
+        if (_workspace_indicator_timer) {
+            _reactor->removeTimer(_workspace_indicator_timer);
+        }
+        _workspace_indicator_timer = _reactor->addTimer(timeout, false);
     }
 }
 
@@ -197,6 +208,22 @@ Workspaces::hideWorkspaceIndicator(void)
     _workspace_indicator->unmapWindow();
 }
 
+/**
+ * Handle expired reactor timer.
+ *
+ * @return true if the timer was the workspace indicator timer.
+ */
+bool
+Workspaces::handleTimer(int id)
+{
+    if (! _workspace_indicator_timer || id != _workspace_indicator_timer) {
+        return false;
+    }
+    _workspace_indicator_timer = 0;
+    hideWorkspaceIndicator();
+    return true;
+}
+
 bool
 Workspaces::gotoWorkspace(uint direction, bool warp)
 {
@@ -348,16 +375,16 @@ Workspaces::warpToWorkspace(uint num, int dir)
 void
 Workspaces::fixStacking(PWinObj *pwo)
 {
-    Window winlist[2];
-    const_iterator it = find(_wobjs.begin(), _wobjs.end(), pwo);
-    if (it == _wobjs.end()) {
+    if (! _wobjs.contains(pwo)) {
         return;
     }
 
-    if (++it == _wobjs.end()) {
+    PWinObj *above = _wobjs.getAbove(pwo);
+    if (above == nullptr) {
         X11::raiseWindow(pwo->getWindow());
     } else {
-        winlist[0] = (*it)->getWindow();
+        Window winlist[2];
+        winlist[0] = above->getWindow();
         winlist[1] = pwo->getWindow();
         XRestackWindows(X11::getDpy(), winlist, 2);
     }
@@ -372,55 +399,57 @@ void
 Workspaces::insert(PWinObj *wo, bool raise)
 {
     PWinObj *top_obj = 0;
-    Frame *frame, *wo_frame = dynamic_cast<Frame*>(wo);
-    iterator it;
+    Frame *wo_frame = dynamic_cast<Frame*>(wo);
 
+    PWinObj *trans_for = nullptr;
     if (! raise && wo_frame && wo_frame->getTransFor()
                 && wo_frame->getTransFor()->getLayer() == wo_frame->getLayer()) {
+        trans_for = wo_frame->getTransFor()->getParent();
+    }
+
+    if (trans_for && _wobjs.contains(trans_for)) {
         // Lower only to the top of the transient_for window.
-        it = ++find(_wobjs.begin(), _wobjs.end(), wo_frame->getTransFor()->getParent());
-        top_obj = it!=_wobjs.end()?*it:0; // I think it==_wobjs.end() can't happen
+        top_obj = _wobjs.getAbove(trans_for);
+        _wobjs.insertAbove(wo, wo->getLayer(), trans_for);
     } else {
-        it = _wobjs.begin();
-        for (; it != _wobjs.end(); ++it) {
-            if (raise) {
-                // If raising, make sure the inserted wo gets below the first
-                // window in the next layer.
-                if ((*it)->getLayer() > wo->getLayer()) {
-                    top_obj = *it;
-                    break;
-                }
-            } else if (wo->getLayer() <= (*it)->getLayer()) {
-                // If lowering, put the window below the first window with the same level.
-                top_obj = *it;
-                break;
-            }
+        if (raise) {
+            // If raising, make sure the inserted wo gets below the first
+            // window in the next layer.
+            top_obj = _wobjs.findFirstAbove(wo->getLayer());
+        } else {
+            // If lowering, put the window below the first window with the same level.
+            top_obj = _wobjs.findFirstFrom(wo->getLayer());
         }
+        _wobjs.insertBelow(wo, wo->getLayer(), top_obj);
     }
 
-    _wobjs.insert(it, wo);
-
     std::vector<PWinObj*> winstack;
     winstack.reserve(3);
     winstack.push_back(wo);
 
     if (wo_frame && wo_frame->hasTrans()) {
-        std::vector<Client*>::const_iterator t_it;
-        for (it = _wobjs.begin(); *it != wo;) {
-            if ((frame = dynamic_cast<Frame*>(*it))) {
-                t_it = find(wo_frame->getTransBegin(), wo_frame->getTransEnd(),
-                            frame->getActiveClient());
-                if (t_it != wo_frame->getTransEnd()) {
-                    winstack.push_back(frame);
-                    it = _wobjs.erase(it);
-                    continue;
-                }
+        // Frames with a transient of wo active that are stacked below
+        // wo are moved directly above it, keeping their order.
+        auto t_it = wo_frame->getTransBegin();
+        for (; t_it != wo_frame->getTransEnd(); ++t_it) {
+            Frame *frame = static_cast<Frame*>((*t_it)->getParent());
+            if (frame && frame != wo_frame
+                && frame->getActiveClient() == *t_it
+                && _wobjs.contains(frame) && _wobjs.isBelow(frame, wo)
+                && std::find(winstack.begin(), winstack.end(), frame)
+                   == winstack.end()) {
+                winstack.push_back(frame);
             }
-            ++it;
         }
+        std::sort(winstack.begin() + 1, winstack.end(),
+                  [](PWinObj *wo1, PWinObj *wo2) {
+                      return _wobjs.isBelow(wo1, wo2);
+                  });
 
-        it = ++find(_wobjs.begin(), _wobjs.end(), wo);
-        _wobjs.insert(it, winstack.begin()+1, winstack.end());
+        auto it = winstack.begin() + 1;
+        for (; it != winstack.end(); ++it) {
+            _wobjs.insertAbove(*it, (*it)->getLayer(), *(it - 1));
+        }
     }
 
     if (top_obj) {
@@ -443,14 +472,7 @@ Workspaces::insert(PWinObj *wo, bool raise)
 void
 Workspaces::remove(PWinObj* wo)
 {
-    iterator it_wo(_wobjs.begin());
-    for (;it_wo != _wobjs.end();) {
-        if (wo == *it_wo) {
-            it_wo = _wobjs.erase(it_wo);
-        } else {
-            ++it_wo;
-        }
-    }
+    _wobjs.remove(wo);
 
     // remove from last focused
     for (auto it : _workspaces) {
@@ -460,6 +482,16 @@ Workspaces::remove(PWinObj* wo)
     }
 }
 
+/**
+ * Update layer of PWinObj in the stacking list index, the position
+ * is kept until it is raised or lowered.
+ */
+void
+Workspaces::updateLayer(PWinObj* wo)
+{
+    _wobjs.setLayer(wo, wo->getLayer());
+}
+
 //! @brief Hides all non-sticky Frames on the workspace.
 void
 Workspaces::hideAll(uint workspace)
@@ -532,12 +564,9 @@ Workspaces::unhideAll(uint workspace, bool focus)
 void
 Workspaces::raise(PWinObj* wo)
 {
-    iterator it(find(_wobjs.begin(), _wobjs.end(), wo));
-
-    if (it == _wobjs.end()) { // no Frame to raise.
+    if (! _wobjs.remove(wo)) { // no Frame to raise.
         return;
     }
-    _wobjs.erase(it);
 
     insert(wo, true); // reposition and restack
 }
@@ -546,11 +575,9 @@ Workspaces::raise(PWinObj* wo)
 void
 Workspaces::lower(PWinObj* wo)
 {
-    iterator it(find(_wobjs.begin(), _wobjs.end(), wo));
-
-    if (it == _wobjs.end()) // no Frame to raise.
+    if (! _wobjs.remove(wo)) { // no Frame to raise.
         return;
-    _wobjs.erase(it);
+    }
 
     insert(wo, false); // reposition and restack
 }
@@ -605,15 +632,15 @@ Workspaces::getTopWO(uint type_mask)
  * Builds a list of all clients in stacking order, clients in the same
  * frame come after each other.
  */
-Window*
-Workspaces::buildClientList(unsigned int &num_windows)
+void
+Workspaces::buildClientList(std::vector<Window> &windows)
 {
     Frame *frame;
     Client *client, *client_active;
 
-    std::vector<Window> windows;
+    windows.clear();
     iterator it_f;
-    const_iterator it_c;
+    std::vector<PWinObj*>::const_iterator it_c;
     for (it_f = _wobjs.begin(); it_f != _wobjs.end(); ++it_f) {
         if ((*it_f)->getType() != PWinObj::WO_FRAME) {
             continue;
@@ -637,48 +664,87 @@ Workspaces::buildClientList(unsigned int &num_windows)
             windows.push_back(client_active->getWindow());
         }
     }
+}
 
-    num_windows = windows.size();
-    Window *wins = new Window[num_windows ? num_windows : 1];
-    if (num_windows > 0) {
-        copy(windows.begin(), windows.end(), wins);
-    }
+/**
+ * Mark the Ewmh Client list hint, and the Stacking list hint, for
+ * update. The hints are written by publishClientList.
+ */
+void
+Workspaces::updateClientList(void)
+{
+    _client_list_stats.updates++;
+    _client_list_dirty = true;
+    _client_list_stacking_dirty = true;
+}
 
-    return wins;
+/**
+ * Mark the Ewmh Stacking list hint for update.
+ */
+void
+Workspaces::updateClientStackingList(void)
+{
+    _client_list_stats.updates++;
+    _client_list_stacking_dirty = true;
 }
 
 /**
- * Updates the Ewmh Client list hint.
+ * Write the client list hints marked for update since the last call,
+ * called once per batch of events from the main loop.
  */
 void
-Workspaces::updateClientList(void)
+Workspaces::publishClientList(void)
 {
-    uint num;
-    auto windows = buildClientList(num);
-    if (num == 0) {
-        X11::unsetProperty(X11::getRoot(), NET_CLIENT_LIST);
-        X11::unsetProperty(X11::getRoot(), NET_CLIENT_LIST_STACKING);
-    } else {
-        X11::setWindows(X11::getRoot(), NET_CLIENT_LIST, windows, num);
-        X11::setWindows(X11::getRoot(), NET_CLIENT_LIST_STACKING, windows, num);
+    if (! _client_list_dirty && ! _client_list_stacking_dirty) {
+        return;
+    }
+
+    _client_list_stats.builds++;
+    buildClientList(_client_list);
+    if (_client_list_dirty) {
+        publishClientListProperty(NET_CLIENT_LIST, _client_list_published);
+        _client_list_dirty = false;
+    }
+    if (_client_list_stacking_dirty) {
+        publishClientListProperty(NET_CLIENT_LIST_STACKING,
+                                  _client_list_stacking_published);
+        _client_list_stacking_dirty = false;
     }
-    delete [] windows;
 }
 
 /**
- * Updates the Ewmh Stacking list hint.
+ * Write _client_list to the aname property on the root window unless
+ * it is unchanged since the last write. If windows have only been
+ * added at the end of the list the new windows are appended to the
+ * property, avoiding a re-write of the full list.
  */
 void
-Workspaces::updateClientStackingList(void)
+Workspaces::publishClientListProperty(AtomName aname,
+                                      std::vector<Window> &published)
 {
-    uint num;
-    auto windows = buildClientList(num);
-    if (num == 0) {
-        X11::unsetProperty(X11::getRoot(), NET_CLIENT_LIST_STACKING);
+    if (_client_list == published) {
+        _client_list_stats.skipped++;
+        return;
+    }
+
+    _client_list_stats.writes++;
+    if (_client_list.empty()) {
+        X11::unsetProperty(X11::getRoot(), aname);
+    } else if (! published.empty()
+               && published.size() < _client_list.size()
+               && std::equal(published.begin(), published.end(),
+                             _client_list.begin())) {
+        _client_list_stats.appends++;
+        X11::changeProperty(X11::getRoot(), X11::getAtom(aname), XA_WINDOW, 32,
+                            PropModeAppend,
+                            reinterpret_cast<const uchar*>(
+                                _client_list.data() + published.size()),
+                            _client_list.size() - published.size());
     } else {
-        X11::setWindows(X11::getRoot(), NET_CLIENT_LIST_STACKING, windows, num);
+        X11::setWindows(X11::getRoot(), aname, _client_list.data(),
+                        _client_list.size());
     }
-    delete [] windows;
+    published = _client_list;
 }
 
 /**
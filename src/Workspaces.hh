@@ -10,14 +10,68 @@
 
 #include "config.h"
 
+#include <iostream>
 #include <string>
+#include <vector>
+
+extern "C" {
+#include <time.h>
+}
 
 #include "pekwm.hh"
+#include "StackingList.hh"
+#include "Util.hh"
 #include "WinLayouter.hh"
 #include "WorkspaceIndicator.hh"
+#include "X11.hh"
 
 class PWinObj;
 class Frame;
+class Reactor;
+
+/**
+ * Statistics for _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING
+ * publication.
+ */
+class ClientListStats {
+public:
+    ClientListStats(void)
+        : updates(0),
+          builds(0),
+          writes(0),
+          appends(0),
+          skipped(0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+
+    /** Number of update requests, marking the lists dirty. */
+    ulong updates;
+    /** Number of times the list was built from the stacking order. */
+    ulong builds;
+    /** Number of property writes, including appends. */
+    ulong writes;
+    /** Number of writes done with PropModeAppend. */
+    ulong appends;
+    /** Number of dirty properties not written as they were unchanged. */
+    ulong skipped;
+    struct timespec start;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const ClientListStats &stats) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_ms = Util::timeDiffMs(now, stats.start);
+        os << "updates " << stats.updates
+           << " builds " << stats.builds
+           << " writes " << stats.writes
+           << " appends " << stats.appends
+           << " skipped " << stats.skipped
+           << " writes/s "
+           << (elapsed_ms > 0 ? stats.writes * 1000.0 / elapsed_ms : 0.0);
+        return os;
+    }
+};
 
 class Workspace {
 public:
@@ -51,13 +105,13 @@ private:
 
 class Workspaces {
 public:
-    typedef std::vector<PWinObj*>::iterator iterator;
-    typedef std::vector<PWinObj*>::const_iterator const_iterator;
-    typedef std::vector<PWinObj*>::reverse_iterator reverse_iterator;
-    typedef std::vector<PWinObj*>::const_reverse_iterator
+    typedef StackingList<PWinObj*>::iterator iterator;
+    typedef StackingList<PWinObj*>::const_iterator const_iterator;
+    typedef StackingList<PWinObj*>::reverse_iterator reverse_iterator;
+    typedef StackingList<PWinObj*>::const_reverse_iterator
         const_reverse_iterator;
 
-    static void init(void);
+    static void init(Reactor *reactor);
     static void cleanup(void);
 
     static inline iterator begin(void) { return _wobjs.begin(); }
@@ -100,6 +154,7 @@ public:
 
     static void insert(PWinObj* wo, bool raise = true);
     static void remove(PWinObj* wo);
+    static void updateLayer(PWinObj* wo);
 
     static void hideAll(uint workspace);
     static void unhideAll(uint workspace, bool focus);
@@ -113,6 +168,10 @@ public:
     static PWinObj* getTopWO(uint type_mask);
     static void updateClientList(void);
     static void updateClientStackingList(void);
+    static void publishClientList(void);
+    static const ClientListStats &getClientListStats(void) {
+        return _client_list_stats;
+    }
     static void placeWoInsideScreen(PWinObj *wo);
 
     static void findWOAndFocus(PWinObj *search);
@@ -125,6 +184,7 @@ public:
 
     static void showWorkspaceIndicator(void);
     static void hideWorkspaceIndicator(void);
+    static bool handleTimer(int id);
 
     // list iterators
     static std::vector<Frame*>::iterator mru_begin(void) {
@@ -154,7 +214,9 @@ public:
     }
 
 private:
-    static Window *buildClientList(unsigned int &num_windows);
+    static void buildClientList(std::vector<Window> &windows);
+    static void publishClientListProperty(AtomName aname,
+                                          std::vector<Window> &published);
     static bool warpToWorkspace(uint num, int dir);
 
     static std::wstring getWorkspaceName(uint num);
@@ -165,9 +227,26 @@ private:
 
     /** Window popping up when switching workspace */
     static WorkspaceIndicator *_workspace_indicator;
+    /** Reactor timing out the workspace indicator. */
+    static Reactor *_reactor;
+    /** Timer hiding the workspace indicator, 0 if not shown. */
+    static int _workspace_indicator_timer;
 
-    static std::vector<PWinObj*> _wobjs;
+    /** Stacking order of all PWinObjs, bottom to top. */
+    static StackingList<PWinObj*> _wobjs;
     /** The most recently used frame is kept at the front. */
     static std::vector<Frame*> _mru;
     static std::vector<Workspace> _workspaces;
+
+    /** Set when _NET_CLIENT_LIST needs to be published. */
+    static bool _client_list_dirty;
+    /** Set when _NET_CLIENT_LIST_STACKING needs to be published. */
+    static bool _client_list_stacking_dirty;
+    /** Client list built when publishing, re-used between builds. */
+    static std::vector<Window> _client_list;
+    /** Last published _NET_CLIENT_LIST. */
+    static std::vector<Window> _client_list_published;
+    /** Last published _NET_CLIENT_LIST_STACKING. */
+    static std::vector<Window> _client_list_stacking_published;
+    static ClientListStats _client_list_stats;
 };
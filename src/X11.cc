@@ -10,7 +10,9 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring> // required for memset in FD_ZERO
 #include <limits>
 
@@ -24,6 +26,11 @@ extern "C" {
 #ifdef HAVE_XRANDR
 #include <X11/extensions/Xrandr.h>
 #endif // HAVE_XRANDR
+#ifdef HAVE_SHM
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif // HAVE_SHM
 #include <X11/keysym.h> // For XK_ entries
 #include <sys/select.h>
 #ifdef HAVE_X11_XKBLIB_H
@@ -36,6 +43,7 @@ unsigned int xerrors_count = 0;
 
 #include "X11.hh"
 #include "Debug.hh"
+#include "Util.hh"
 
 const uint X11::MODIFIER_TO_MASK[] = {
     ShiftMask, LockMask, ControlMask,
@@ -183,23 +191,61 @@ operator<<(std::ostream& os, const Geometry& gm)
  */
 class X11::ColorEntry {
 public:
-    ColorEntry(const std::string &name) : _name(name), _ref(0) { }
+    ColorEntry(const std::string &name)
+        : _name(name),
+          _ref(0),
+          _allocated(false)
+    {
+    }
     ~ColorEntry(void) { }
 
+    inline const std::string &getName(void) const { return _name; }
     inline XColor *getColor(void) { return &_xc; }
 
     inline uint getRef(void) const { return _ref; }
     inline void incRef(void) { _ref++; }
     inline void decRef(void) { if (_ref > 0) { _ref--; } }
 
-    inline bool operator==(const std::string &name) {
-        return (::strcasecmp(_name.c_str(), name.c_str()) == 0);
-    }
+    /** Set if the pixel is allocated on the server and must be freed. */
+    inline bool isAllocated(void) const { return _allocated; }
+    inline void setAllocated(bool allocated) { _allocated = allocated; }
 
 private:
     std::string _name;
     XColor _xc;
     uint _ref;
+    bool _allocated;
+};
+
+/** Images smaller than this are sent over the socket. */
+#define SHM_MIN_SIZE (64 * 1024)
+/** Max number of unused segments kept for re-use. */
+#define SHM_POOL_SIZE 4
+/** Max size of unused segments kept for re-use. */
+#define SHM_POOL_MAX_SIZE (16 * 1024 * 1024)
+
+/**
+ * Shared memory segment attached to the server.
+ */
+class X11::ShmSegment {
+public:
+    ShmSegment(size_t size_)
+        : size(size_),
+          in_use(false),
+          pending(false)
+    {
+#ifdef HAVE_SHM
+        memset(&info, 0, sizeof(info));
+#endif // HAVE_SHM
+    }
+
+#ifdef HAVE_SHM
+    XShmSegmentInfo info;
+#endif // HAVE_SHM
+    size_t size;
+    bool in_use;
+    /** Set when a XShmPutImage request might still read the segment. */
+    bool pending;
 };
 
 /**
@@ -272,6 +318,8 @@ X11::init(Display *dpy, bool synchronous, bool honour_randr)
     }
 #endif // HAVE_XRANDR
 
+    initShm();
+
 #ifdef HAVE_X11_XKBLIB_H
     {
         int major = XkbMajorVersion;
@@ -305,20 +353,33 @@ X11::init(Display *dpy, bool synchronous, bool honour_randr)
                        0, _atoms)) {
         ERR("XInternAtoms did not return all requested atoms");
     }
+
+    Debug::addStats("events", [](std::ostream &os) {
+                                  os << _event_batch.getStats();
+                              });
+    Debug::addStats("properties", [](std::ostream &os) {
+                                      os << _property_stats;
+                                  });
+    Debug::addStats("colors", [](std::ostream &os) {
+                                  os << _color_stats;
+                              });
 }
 
 //! @brief X11 destructor
 void
 X11::destruct(void) {
-    if (_colours.size() > 0) {
-        ulong *pixels = new ulong[_colours.size()];
-        for (uint i=0; i < _colours.size(); ++i) {
-            pixels[i] = _colours[i]->getColor()->pixel;
-            delete _colours[i];
+    std::vector<ulong> pixels;
+    for (auto &it : _colours) {
+        if (it.second->isAllocated()) {
+            pixels.push_back(it.second->getColor()->pixel);
         }
+        delete it.second;
+    }
+    _colours.clear();
+    _colour_entries.clear();
+    if (! pixels.empty()) {
         XFreeColors(_dpy, X11::getColormap(),
-                    pixels, _colours.size(), 0);
-        delete [] pixels;
+                    pixels.data(), pixels.size(), 0);
     }
 
     if (_modifier_map) {
@@ -333,46 +394,66 @@ X11::destruct(void) {
     // use 100% of the CPU without making any progress with the restart.
     // This X11:sync() seems to be work around the issue (c.f. #300).
     X11::sync(True);
+    destructShm();
+    _event_batch.clear();
+    Debug::removeStats("events");
+    Debug::removeStats("properties");
+    Debug::removeStats("colors");
 
     XCloseDisplay(_dpy);
     _dpy = 0;
 }
 
+/**
+ * Get color, the color is allocated if not already in use and must be
+ * returned with returnColor.
+ *
+ * On TrueColor visuals the pixel is computed from the color value
+ * avoiding a round-trip for allocation, numeric color values are
+ * parsed without a round-trip.
+ */
 XColor *
 X11::getColor(const std::string &color)
 {
-    // check for already existing entry
-    auto it(_colours.begin());
-
     if (strcasecmp(color.c_str(), "EMPTY") == 0) {
         return &_xc_default;
     }
 
-    for (; it != _colours.end(); ++it) {
-        if (*(*it) == color) {
-            (*it)->incRef();
-            return (*it)->getColor();
+    _color_stats.lookups++;
+
+    // check for already existing entry
+    std::string name(color);
+    Util::to_lower(name);
+    auto it = _colours.find(name);
+    if (it != _colours.end()) {
+        if (it->second->getRef() == 0) {
+            _color_stats.unused--;
         }
+        it->second->incRef();
+        _color_stats.hits++;
+        return it->second->getColor();
     }
 
     // create new entry
-    ColorEntry *entry = new ColorEntry(color);
-
-    // X alloc
-    XColor dummy;
-    if (XAllocNamedColor(_dpy, X11::getColormap(),
-                         color.c_str(), entry->getColor(), &dummy) == 0) {
+    auto entry = new ColorEntry(name);
+    bool allocated;
+    if (! allocColor(color, *entry->getColor(), allocated)) {
         ERR("failed to alloc color: " << color);
         delete entry;
-        entry = 0;
-    } else {
-        _colours.push_back(entry);
-        entry->incRef();
+        return &_xc_default;
     }
 
-    return entry ? entry->getColor() : &_xc_default;
+    entry->setAllocated(allocated);
+    entry->incRef();
+    _colours[name] = entry;
+    _colour_entries[entry->getColor()] = entry;
+    return entry->getColor();
 }
 
+/**
+ * Return color, colors without references are kept for re-use as
+ * they are likely to be requested again on theme reload.
+ */
 void
 X11::returnColor(XColor *xc)
 {
@@ -380,20 +461,114 @@ X11::returnColor(XColor *xc)
         return;
     }
 
-    auto it(_colours.begin());
-    for (; it != _colours.end(); ++it) {
-        if ((*it)->getColor() == xc) {
-            (*it)->decRef();
-            if (((*it)->getRef() == 0)) {
-                ulong pixels[1] = { (*it)->getColor()->pixel };
-                XFreeColors(X11::getDpy(), X11::getColormap(), pixels, 1, 0);
+    auto it = _colour_entries.find(xc);
+    if (it != _colour_entries.end()) {
+        it->second->decRef();
+        if (it->second->getRef() == 0) {
+            _color_stats.unused++;
+        }
+    }
+}
+
+/**
+ * Parse and allocate color, if the colormap is full unused colors are
+ * freed before trying again.
+ */
+bool
+X11::allocColor(const std::string &color, XColor &xc, bool &allocated)
+{
+    allocated = false;
+    if (! XParseColor(_dpy, _colormap, color.c_str(), &xc)) {
+        return false;
+    }
+
+    if (setTrueColorPixel(xc, _visual)) {
+        _color_stats.computed++;
+        return true;
+    }
+
+    if (! XAllocColor(_dpy, _colormap, &xc)) {
+        freeUnusedColors();
+        if (! XAllocColor(_dpy, _colormap, &xc)) {
+            return false;
+        }
+    }
+    _color_stats.allocated++;
+    allocated = true;
+    return true;
+}
 
-                delete *it;
-                _colours.erase(it);
+/**
+ * Free colors without references.
+ */
+void
+X11::freeUnusedColors(void)
+{
+    std::vector<ulong> pixels;
+    auto it = _colours.begin();
+    while (it != _colours.end()) {
+        if (it->second->getRef() == 0) {
+            if (it->second->isAllocated()) {
+                pixels.push_back(it->second->getColor()->pixel);
             }
-            break;
+            _colour_entries.erase(it->second->getColor());
+            delete it->second;
+            it = _colours.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    _color_stats.unused = 0;
+
+    if (! pixels.empty()) {
+        XFreeColors(_dpy, _colormap, pixels.data(), pixels.size(), 0);
+    }
+}
+
+/**
+ * Compute pixel for xc if visual is a TrueColor visual, the color
+ * values are updated to the values representable by the visual the
+ * same way XAllocColor does, rounding to the nearest value.
+ *
+ * @return true if visual is TrueColor and the pixel was set.
+ */
+bool
+X11::setTrueColorPixel(XColor &xc, const Visual *visual)
+{
+    if (visual == nullptr || visual->c_class != TrueColor) {
+        return false;
+    }
+
+    ulong masks[3] = {visual->red_mask, visual->green_mask, visual->blue_mask};
+    ushort *values[3] = {&xc.red, &xc.green, &xc.blue};
+    xc.pixel = 0;
+    for (int i = 0; i < 3; i++) {
+        ulong mask = masks[i];
+        if (mask == 0) {
+            return false;
+        }
+
+        uint shift = 0;
+        while (! (mask & 1)) {
+            mask >>= 1;
+            shift++;
+        }
+        uint bits = 0;
+        while (mask & 1) {
+            mask >>= 1;
+            bits++;
         }
+        if (bits > 16) {
+            return false;
+        }
+
+        ulong max = (1ul << bits) - 1;
+        ulong value = (*values[i] * max + 0x8000) >> 16;
+        xc.pixel |= value << shift;
+        *values[i] = value * 65535 / max;
     }
+    xc.flags = DoRed | DoGreen | DoBlue;
+    return true;
 }
 
 /**
@@ -407,30 +582,54 @@ X11::setLockKeys(void)
 }
 
 //! @brief Get next event using select to avoid signal blocking
+//!
+//! Events are read in batches, all events available are read from
+//! the server and coalesced before the first one is returned.
+//!
 //! @param ev Event to fill in.
 //! @return true if event was fetched, else false.
 bool
 X11::getNextEvent(XEvent &ev, struct timeval *timeout)
 {
-    if (pending()) {
-        XNextEvent(_dpy, &ev);
+    if (_event_batch.pop(ev)) {
         return true;
     }
+    if (! _dpy) {
+        return false;
+    }
 
-    int ret;
-    fd_set rfds;
+    if (! XPending(_dpy)) {
+        fd_set rfds;
 
-    flush();
+        flush();
 
-    FD_ZERO(&rfds);
-    FD_SET(_fd, &rfds);
+        FD_ZERO(&rfds);
+        FD_SET(_fd, &rfds);
 
-    ret = select(_fd + 1, &rfds, nullptr, nullptr, timeout);
-    if (ret > 0) {
-        XNextEvent(_dpy, &ev);
+        int ret = select(_fd + 1, &rfds, nullptr, nullptr, timeout);
+        if (ret < 1) {
+            return false;
+        }
     }
 
-    return ret > 0;
+    fillEventBatch();
+    return _event_batch.pop(ev);
+}
+
+/**
+ * Read all events currently available into the event batch, blocks
+ * until at least one event is available.
+ */
+void
+X11::fillEventBatch(void)
+{
+    _event_batch.beginBatch();
+
+    XEvent ev;
+    do {
+        XNextEvent(_dpy, &ev);
+        _event_batch.push(ev);
+    } while (XPending(_dpy));
 }
 
 //! @brief Grabs the server, counting number of grabs
@@ -687,6 +886,58 @@ X11::getAtomName(Atom atom)
     return MAX_NR_ATOMS;
 }
 
+/**
+ * Wrapper for XGetWindowProperty always reading from offset 0, data
+ * read with prefetchProperties is used if available.
+ */
+int
+X11::getWindowProperty(Window win, Atom atom, long length, Atom req_type,
+                       Atom *type_ret, int *format_ret, ulong *nitems_ret,
+                       ulong *after_ret, uchar **data_ret)
+{
+    auto it = _prefetched.find(PropertyKey(win, atom));
+    if (it == _prefetched.end()) {
+        if (! _prefetched.empty()) {
+            _property_stats.misses++;
+        }
+        return XGetWindowProperty(_dpy, win, atom, 0L, length, False,
+                                  req_type, type_ret, format_ret, nitems_ret,
+                                  after_ret, data_ret);
+    }
+    _property_stats.hits++;
+
+    const PrefetchedProperty &prop = it->second;
+    *type_ret = prop.type;
+    *format_ret = prop.format;
+    *after_ret = 0;
+    if (prop.type == None) {
+        *nitems_ret = 0;
+        *data_ret = nullptr;
+    } else if (req_type != AnyPropertyType && req_type != prop.type) {
+        // type mismatch, no data is returned but the size of the
+        // property is, as the server does.
+        *nitems_ret = 0;
+        *after_ret = prop.nitems * (prop.format / 8);
+        *data_ret = nullptr;
+    } else {
+        // limit to length, the same way the server would do.
+        ulong wire_size = std::max(prop.format / 8, 1);
+        ulong nitems = std::min(prop.nitems, length * 4 / wire_size);
+        size_t size = nitems ? prop.data.size() / prop.nitems * nitems : 0;
+
+        // Xlib always null terminates the returned data
+        uchar *data = static_cast<uchar*>(malloc(size + 1));
+        if (size) {
+            memcpy(data, prop.data.data(), size);
+        }
+        data[size] = '\0';
+        *nitems_ret = nitems;
+        *after_ret = (prop.nitems - nitems) * wire_size;
+        *data_ret = data;
+    }
+    return Success;
+}
+
 bool
 X11::getProperty(Window win, Atom atom, Atom type,
                  ulong expected, uchar **data_ret, ulong *actual)
@@ -706,10 +957,8 @@ X11::getProperty(Window win, Atom atom, Atom type,
 
         Atom r_type;
         int r_format, status;
-        status =
-            XGetWindowProperty(_dpy, win, atom,
-                               0L, expected, False, type,
-                               &r_type, &r_format, &read, &left, &data);
+        status = getWindowProperty(win, atom, expected, type,
+                                   &r_type, &r_format, &read, &left, &data);
         if (status != Success || type != r_type || read == 0) {
             if (data != nullptr) {
                 X11::free(data);
@@ -732,8 +981,19 @@ X11::getTextProperty(Window win, Atom atom, std::string &value)
 {
     // Read text property, return if it fails.
     XTextProperty text_property;
-    if (! XGetTextProperty(_dpy, win, &text_property, atom)
-        || ! text_property.value || ! text_property.nitems) {
+    ulong after;
+    int status = getWindowProperty(win, atom, 0x7fffffff, AnyPropertyType,
+                                   &text_property.encoding,
+                                   &text_property.format,
+                                   &text_property.nitems, &after,
+                                   &text_property.value);
+    if (status != Success || text_property.encoding == None) {
+        return false;
+    }
+    if (! text_property.value || ! text_property.nitems) {
+        if (text_property.value) {
+            X11::free(text_property.value);
+        }
         return false;
     }
 
@@ -763,13 +1023,180 @@ X11::getEwmhPropData(Window win, AtomName prop, Atom type, int &num)
     ulong items_ret, after_ret;
     uchar *prop_data = 0;
 
-    XGetWindowProperty(_dpy, win, _atoms[prop], 0, 0x7fffffff,
-                       False, type, &type_ret, &format_ret, &items_ret,
-                       &after_ret, &prop_data);
+    getWindowProperty(win, _atoms[prop], 0x7fffffff, type,
+                      &type_ret, &format_ret, &items_ret,
+                      &after_ret, &prop_data);
     num = items_ret;
     return prop_data;
 }
 
+/**
+ * Read property with format 32, returned as an array of long.
+ */
+static long*
+getLongProperty(Window win, Atom atom, Atom type, ulong &num)
+{
+    Atom type_ret;
+    int format_ret;
+    ulong after_ret;
+    uchar *data = nullptr;
+    int status = X11::getWindowProperty(win, atom, 0x7fffffff, type,
+                                        &type_ret, &format_ret, &num,
+                                        &after_ret, &data);
+    if (status != Success || type_ret != type || format_ret != 32) {
+        if (data) {
+            X11::free(data);
+        }
+        num = 0;
+        return nullptr;
+    }
+    return reinterpret_cast<long*>(data);
+}
+
+/**
+ * Read WM_HINTS, result should be freed with X11::free.
+ */
+XWMHints*
+X11::getWMHints(Window win)
+{
+    ulong num;
+    long *prop = getLongProperty(win, XA_WM_HINTS, XA_WM_HINTS, num);
+    // version 1 of the ICCCM did not include window_group
+    if (! prop || num < 8) {
+        if (prop) {
+            X11::free(prop);
+        }
+        return nullptr;
+    }
+
+    XWMHints *hints = XAllocWMHints();
+    if (hints) {
+        hints->flags = prop[0];
+        hints->input = prop[1] ? True : False;
+        hints->initial_state = prop[2];
+        hints->icon_pixmap = prop[3];
+        hints->icon_window = prop[4];
+        hints->icon_x = prop[5];
+        hints->icon_y = prop[6];
+        hints->icon_mask = prop[7];
+        hints->window_group = num > 8 ? prop[8] : 0;
+    }
+    X11::free(prop);
+    return hints;
+}
+
+/**
+ * Read WM_NORMAL_HINTS into hints, hints is left untouched if the
+ * property is not set.
+ */
+bool
+X11::getWMNormalHints(Window win, XSizeHints *hints, long *supplied)
+{
+    ulong num;
+    long *prop = getLongProperty(win, XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS,
+                                 num);
+    // version 1 of the ICCCM did not include base size and gravity
+    if (! prop || num < 15) {
+        if (prop) {
+            X11::free(prop);
+        }
+        return false;
+    }
+
+    hints->flags = prop[0];
+    hints->x = prop[1];
+    hints->y = prop[2];
+    hints->width = prop[3];
+    hints->height = prop[4];
+    hints->min_width = prop[5];
+    hints->min_height = prop[6];
+    hints->max_width = prop[7];
+    hints->max_height = prop[8];
+    hints->width_inc = prop[9];
+    hints->height_inc = prop[10];
+    hints->min_aspect.x = prop[11];
+    hints->min_aspect.y = prop[12];
+    hints->max_aspect.x = prop[13];
+    hints->max_aspect.y = prop[14];
+
+    *supplied = USPosition | USSize | PAllHints;
+    if (num >= 18) {
+        *supplied |= PBaseSize | PWinGravity;
+        hints->base_width = prop[15];
+        hints->base_height = prop[16];
+        hints->win_gravity = prop[17];
+    } else {
+        hints->flags &= ~(PBaseSize | PWinGravity);
+    }
+    hints->flags &= *supplied;
+
+    X11::free(prop);
+    return true;
+}
+
+/**
+ * Read WM_PROTOCOLS, protocols should be freed with X11::free.
+ */
+bool
+X11::getWMProtocols(Window win, Atom **protocols, int *count)
+{
+    ulong num;
+    long *prop = getLongProperty(win, _atoms[WM_PROTOCOLS], XA_ATOM, num);
+    if (! prop) {
+        return false;
+    }
+    *protocols = reinterpret_cast<Atom*>(prop);
+    *count = num;
+    return true;
+}
+
+bool
+X11::getTransientForHint(Window win, Window &transient_for)
+{
+    ulong num;
+    long *prop = getLongProperty(win, XA_WM_TRANSIENT_FOR, XA_WINDOW, num);
+    if (! prop) {
+        return false;
+    }
+    if (num > 0) {
+        transient_for = prop[0];
+    }
+    X11::free(prop);
+    return num > 0;
+}
+
+/**
+ * Read WM_CLASS, consisting of the instance and class name separated
+ * with a null byte.
+ */
+bool
+X11::getClassHint(Window win, std::string &res_name, std::string &res_class)
+{
+    Atom type_ret;
+    int format_ret;
+    ulong num, after_ret;
+    uchar *data = nullptr;
+    int status = getWindowProperty(win, XA_WM_CLASS, 0x7fffffff, XA_STRING,
+                                   &type_ret, &format_ret, &num,
+                                   &after_ret, &data);
+    if (status != Success || type_ret != XA_STRING || format_ret != 8
+        || ! data) {
+        if (data) {
+            X11::free(data);
+        }
+        return false;
+    }
+
+    // data is always null terminated
+    const char *str = reinterpret_cast<const char*>(data);
+    res_name = str;
+    size_t len = res_name.size() + 1;
+    res_class = len < num ? str + len : "";
+
+    X11::free(data);
+    return true;
+}
+
 void
 X11::getMousePosition(int &x, int &y)
 {
@@ -829,6 +1256,257 @@ X11::sendEvent(Window dest, Bool propagate, long mask, XEvent *ev)
     return BadValue;
 }
 
+/**
+ * Create image with data in a shared memory segment, the image must
+ * be destroyed with destroyImage.
+ *
+ * @return XImage or nullptr if MIT-SHM is not available or the image
+ *         is small enough to be sent over the socket.
+ */
+XImage*
+X11::createShmImage(uint width, uint height)
+{
+#ifdef HAVE_SHM
+    if (! _has_extension_shm || (width * height * 4) < SHM_MIN_SIZE) {
+        return nullptr;
+    }
+
+    XShmSegmentInfo info;
+    auto ximage = XShmCreateImage(_dpy, _visual, _depth, ZPixmap, nullptr,
+                                  &info, width, height);
+    if (ximage == nullptr) {
+        return nullptr;
+    }
+
+    auto segment =
+        acquireShmSegment(static_cast<size_t>(ximage->bytes_per_line)
+                          * height);
+    if (segment == nullptr) {
+        XDestroyImage(ximage);
+        return nullptr;
+    }
+    ximage->data = segment->info.shmaddr;
+    ximage->obdata = reinterpret_cast<char*>(&segment->info);
+    return ximage;
+#else // ! HAVE_SHM
+    return nullptr;
+#endif // HAVE_SHM
+}
+
+/**
+ * Returns true if ximage was created with createShmImage.
+ */
+bool
+X11::isShmImage(XImage *ximage)
+{
+#ifdef HAVE_SHM
+    if (ximage && ximage->obdata) {
+        for (auto segment : _shm_segments) {
+            if (ximage->obdata == reinterpret_cast<char*>(&segment->info)) {
+                return true;
+            }
+        }
+    }
+#endif // HAVE_SHM
+    return false;
+}
+
+/**
+ * Read image from drawable, using a shared memory segment for large
+ * images if available.
+ */
+XImage*
+X11::getImage(Drawable src, int x, int y, uint width, uint height,
+              unsigned long plane_mask, int format)
+{
+    if (! _dpy) {
+        return nullptr;
+    }
+
+#ifdef HAVE_SHM
+    if (plane_mask == AllPlanes && format == ZPixmap) {
+        auto ximage = createShmImage(width, height);
+        if (ximage) {
+            if (XShmGetImage(_dpy, src, ximage, x, y, plane_mask)) {
+                return ximage;
+            }
+            destroyImage(ximage);
+        }
+    }
+#endif // HAVE_SHM
+
+    return XGetImage(_dpy, src, x, y, width, height, plane_mask, format);
+}
+
+void
+X11::putImage(Drawable dest, GC gc, XImage *ximage,
+              int src_x, int src_y, int dest_x, int dest_y,
+              uint width, uint height)
+{
+    if (! _dpy) {
+        return;
+    }
+
+#ifdef HAVE_SHM
+    if (isShmImage(ximage)) {
+        auto info = reinterpret_cast<XShmSegmentInfo*>(ximage->obdata);
+        for (auto segment : _shm_segments) {
+            if (&segment->info == info) {
+                segment->pending = true;
+            }
+        }
+        XShmPutImage(_dpy, dest, gc, ximage,
+                     src_x, src_y, dest_x, dest_y, width, height, False);
+        return;
+    }
+#endif // HAVE_SHM
+
+    XPutImage(_dpy, dest, gc, ximage,
+              src_x, src_y, dest_x, dest_y, width, height);
+}
+
+void
+X11::destroyImage(XImage *ximage)
+{
+    if (! ximage) {
+        return;
+    }
+
+#ifdef HAVE_SHM
+    if (isShmImage(ximage)) {
+        auto info = reinterpret_cast<XShmSegmentInfo*>(ximage->obdata);
+        for (auto segment : _shm_segments) {
+            if (&segment->info == info) {
+                releaseShmSegment(segment);
+                break;
+            }
+        }
+        // data and obdata belongs to the segment
+        ximage->data = nullptr;
+        ximage->obdata = nullptr;
+    }
+#endif // HAVE_SHM
+
+    XDestroyImage(ximage);
+}
+
+/**
+ * Check for the MIT-SHM extension, only usable if the server can
+ * attach to segments created by this process which is not the case on
+ * remote displays. This is checked when the first segment is
+ * attached.
+ */
+void
+X11::initShm(void)
+{
+#ifdef HAVE_SHM
+    _has_extension_shm = XShmQueryExtension(_dpy);
+#endif // HAVE_SHM
+}
+
+void
+X11::destructShm(void)
+{
+#ifdef HAVE_SHM
+    for (auto segment : _shm_segments) {
+        XShmDetach(_dpy, &segment->info);
+        shmdt(segment->info.shmaddr);
+        delete segment;
+    }
+    _shm_segments.clear();
+#endif // HAVE_SHM
+}
+
+/**
+ * Get unused segment of at least size bytes, creating a new segment
+ * if no unused segment is large enough.
+ */
+X11::ShmSegment*
+X11::acquireShmSegment(size_t size)
+{
+#ifdef HAVE_SHM
+    ShmSegment *best = nullptr;
+    for (auto segment : _shm_segments) {
+        if (! segment->in_use && segment->size >= size
+            && (best == nullptr || segment->size < best->size)) {
+            best = segment;
+        }
+    }
+    if (best) {
+        if (best->pending) {
+            // wait for the server to finish reading the segment
+            XSync(_dpy, False);
+            for (auto segment : _shm_segments) {
+                segment->pending = false;
+            }
+        }
+        best->in_use = true;
+        return best;
+    }
+
+    auto segment = new ShmSegment(size);
+    segment->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (segment->info.shmid == -1) {
+        delete segment;
+        return nullptr;
+    }
+    segment->info.shmaddr =
+        static_cast<char*>(shmat(segment->info.shmid, nullptr, 0));
+    if (segment->info.shmaddr == reinterpret_cast<char*>(-1)) {
+        shmctl(segment->info.shmid, IPC_RMID, nullptr);
+        delete segment;
+        return nullptr;
+    }
+    segment->info.readOnly = False;
+
+    uint errors = xerrors_count;
+    XShmAttach(_dpy, &segment->info);
+    XSync(_dpy, False);
+    // segment is removed once both sides have detached
+    shmctl(segment->info.shmid, IPC_RMID, nullptr);
+    if (errors != xerrors_count) {
+        TRACE("failed to attach shared memory segment, disabling MIT-SHM");
+        _has_extension_shm = false;
+        shmdt(segment->info.shmaddr);
+        delete segment;
+        return nullptr;
+    }
+
+    segment->in_use = true;
+    _shm_segments.push_back(segment);
+    return segment;
+#else // ! HAVE_SHM
+    return nullptr;
+#endif // HAVE_SHM
+}
+
+/**
+ * Mark segment as unused, keeping a limited number of segments around
+ * for re-use.
+ */
+void
+X11::releaseShmSegment(ShmSegment *segment)
+{
+#ifdef HAVE_SHM
+    segment->in_use = false;
+
+    uint unused = 0;
+    for (auto it : _shm_segments) {
+        if (! it->in_use) {
+            unused++;
+        }
+    }
+    if (unused > SHM_POOL_SIZE || segment->size > SHM_POOL_MAX_SIZE) {
+        // the server processes the detach after any pending put
+        XShmDetach(_dpy, &segment->info);
+        shmdt(segment->info.shmaddr);
+        _shm_segments.erase(std::find(_shm_segments.begin(),
+                                      _shm_segments.end(), segment));
+        delete segment;
+    }
+#endif // HAVE_SHM
+}
+
 //! @brief Initialize head information
 void
 X11::initHeads(void)
@@ -1070,13 +1748,21 @@ bool X11::_has_extension_xkb = false;
 bool X11::_has_extension_xinerama = false;
 bool X11::_has_extension_xrandr = false;
 int X11::_event_xrandr = -1;
+bool X11::_has_extension_shm = false;
+std::vector<X11::ShmSegment*> X11::_shm_segments;
 uint X11::_num_lock;
 uint X11::_scroll_lock;
 std::vector<Head> X11::_heads;
 uint X11::_server_grabs;
+EventBatch X11::_event_batch;
+std::map<X11::PropertyKey, X11::PrefetchedProperty> X11::_prefetched;
+std::map<Window, XWindowAttributes> X11::_prefetched_attributes;
+PropertyStats X11::_property_stats;
 Time X11::_last_event_time;
 Window X11::_last_click_id = None;
 Time X11::_last_click_time[BUTTON_NO - 1];
-std::vector<X11::ColorEntry*> X11::_colours;
+std::unordered_map<std::string, X11::ColorEntry*> X11::_colours;
+std::unordered_map<XColor*, X11::ColorEntry*> X11::_colour_entries;
+ColorStats X11::_color_stats;
 XColor X11::_xc_default;
 std::array<Cursor, CURSOR_NONE> X11::_cursor_map;
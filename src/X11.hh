@@ -10,11 +10,14 @@
 
 #include "config.h"
 
+#include "EventBatch.hh"
 #include "Types.hh"
 
 #include <array>
 #include <iostream>
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
@@ -309,6 +312,73 @@ public:
     uint height;
 };
 
+/**
+ * Counters for property prefetching.
+ */
+class PropertyStats {
+public:
+    PropertyStats(void)
+        : prefetches(0),
+          prefetched(0),
+          hits(0),
+          misses(0)
+    {
+    }
+
+    /** Number of prefetchProperties calls (one round-trip each). */
+    ulong prefetches;
+    /** Number of properties requested with prefetchProperties. */
+    ulong prefetched;
+    /** Property reads served from prefetched data. */
+    ulong hits;
+    /** Property reads requiring a round-trip. */
+    ulong misses;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const PropertyStats &stats) {
+        os << "prefetches " << stats.prefetches
+           << " prefetched " << stats.prefetched
+           << " hits " << stats.hits
+           << " misses " << stats.misses;
+        return os;
+    }
+};
+
+/**
+ * Counters for color allocation.
+ */
+class ColorStats {
+public:
+    ColorStats(void)
+        : lookups(0),
+          hits(0),
+          computed(0),
+          allocated(0),
+          unused(0)
+    {
+    }
+
+    ulong lookups;
+    /** Lookups served by an already allocated color. */
+    ulong hits;
+    /** Colors with the pixel computed without a round-trip. */
+    ulong computed;
+    /** Colors allocated on the server, one round-trip each. */
+    ulong allocated;
+    /** Colors without references kept for re-use. */
+    ulong unused;
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const ColorStats &stats) {
+        os << "lookups " << stats.lookups
+           << " hits " << stats.hits
+           << " computed " << stats.computed
+           << " allocated " << stats.allocated
+           << " unused " << stats.unused;
+        return os;
+    }
+};
+
 //! @brief Display information class.
 class X11
 {
@@ -399,9 +469,21 @@ public:
     static Cursor getCursor(CursorType type) { return _cursor_map[type]; }
 
     static void flush(void) { if (_dpy) { XFlush(_dpy); } }
-    static int pending(void) { if (_dpy) { return XPending(_dpy); } return 0; }
+    static int pending(void) {
+        if (! _event_batch.empty()) {
+            return _event_batch.size();
+        }
+        if (_dpy) {
+            return XPending(_dpy);
+        }
+        return 0;
+    }
 
     static bool getNextEvent(XEvent &ev, struct timeval *timeout = nullptr);
+    static bool hasBatchedEvents(void) { return ! _event_batch.empty(); }
+    static const EventBatch::Stats &getEventBatchStats(void) {
+        return _event_batch.getStats();
+    }
     static void allowEvents(int event_mode, Time time) {
         if (_dpy) {
             XAllowEvents(_dpy, event_mode, time);
@@ -547,6 +629,19 @@ public:
                        (uchar*)value.c_str(), value.size());
     }
 
+    static void prefetchProperties(Window win, const std::vector<Atom> &atoms);
+    static void prefetchWindows(const std::vector<Window> &wins,
+                                const std::vector<Atom> &atoms,
+                                bool attributes);
+    static void clearPrefetched(Window win);
+    static void clearAllPrefetched(void);
+    static bool isPrefetched(Window win);
+    static bool getWindowAttributes(Window win, XWindowAttributes &attr);
+    static int getWindowProperty(Window win, Atom atom, long length,
+                                 Atom req_type, Atom *type_ret,
+                                 int *format_ret, ulong *nitems_ret,
+                                 ulong *after_ret, uchar **data_ret);
+
     static bool getProperty(Window win, Atom atom, Atom type,
                             ulong expected, uchar **data, ulong *actual);
     static bool getTextProperty(Window win, Atom atom, std::string &value);
@@ -554,10 +649,22 @@ public:
                                  Atom type, int &num);
     static void unsetProperty(Window win, AtomName aname) {
         if (_dpy) {
+            invalidatePrefetched(win, _atoms[aname]);
             XDeleteProperty(_dpy, win, _atoms[aname]);
         }
     }
 
+    // ICCCM hints, same as the Xlib functions but using prefetched
+    // properties if available.
+
+    static XWMHints *getWMHints(Window win);
+    static bool getWMNormalHints(Window win, XSizeHints *hints,
+                                 long *supplied);
+    static bool getWMProtocols(Window win, Atom **protocols, int *count);
+    static bool getTransientForHint(Window win, Window &transient_for);
+    static bool getClassHint(Window win, std::string &res_name,
+                             std::string &res_class);
+
     static void getMousePosition(int &x, int &y);
     static uint getButtonFromState(uint state);
 
@@ -567,6 +674,8 @@ public:
 
     inline static void removeMotionEvents(void)
     {
+        _event_batch.removeTypedEvents(MotionNotify);
+
         XEvent xev;
         while (XCheckMaskEvent(_dpy, PointerMotionMask, &xev))
             ;
@@ -667,8 +776,30 @@ public:
         }
     }
 
+    // Event queue wrappers, events already read into the event batch
+    // are older than events in the Xlib queue and are checked first.
+
     inline static bool checkTypedEvent(int type, XEvent *ev) {
-        return XCheckTypedEvent(_dpy, type, ev);
+        return _event_batch.checkTypedEvent(type, *ev)
+            || XCheckTypedEvent(_dpy, type, ev);
+    }
+    inline static bool checkTypedWindowEvent(Window win, int type,
+                                             XEvent *ev) {
+        return _event_batch.checkTypedWindowEvent(win, type, *ev)
+            || XCheckTypedWindowEvent(_dpy, win, type, ev);
+    }
+    inline static void maskEvent(long mask, XEvent *ev) {
+        if (! _event_batch.checkMaskEvent(mask, *ev)) {
+            XMaskEvent(_dpy, mask, ev);
+        }
+    }
+    inline static void windowEvent(Window win, long mask, XEvent *ev) {
+        if (! _event_batch.checkWindowEvent(win, mask, *ev)) {
+            XWindowEvent(_dpy, win, mask, ev);
+        }
+    }
+    inline static void putBackEvent(XEvent *ev) {
+        _event_batch.putBack(*ev);
     }
 
     static void sync(Bool discard) {
@@ -697,6 +828,7 @@ public:
                               int mode, const unsigned char *data, int num_e)
     {
         if (_dpy) {
+            invalidatePrefetched(win, prop);
             return XChangeProperty(_dpy, win, prop, type, format, mode,
                                    data, num_e);
         }
@@ -762,27 +894,14 @@ public:
         }
         return nullptr;
     }
+    static XImage *createShmImage(uint width, uint height);
+    static bool isShmImage(XImage *ximage);
     static XImage *getImage(Drawable src, int x, int y, uint width, uint height,
-                           unsigned long plane_mask, int format) {
-        if (_dpy) {
-            return XGetImage(_dpy, src, x, y, width, height,
-                             plane_mask, format);
-        }
-        return nullptr;
-    }
+                            unsigned long plane_mask, int format);
     static void putImage(Drawable dest, GC gc, XImage *ximage,
                          int src_x, int src_y, int dest_x, int dest_y,
-                         uint width, uint height) {
-        if (_dpy) {
-            XPutImage(_dpy, dest, gc, ximage,
-                      src_x, src_y, dest_x, dest_y, width, height);
-        }
-    }
-    static void destroyImage(XImage *ximage) {
-        if (ximage) {
-            XDestroyImage(ximage);
-        }
-    }
+                         uint width, uint height);
+    static void destroyImage(XImage *ximage);
 
     static void setWindowBackground(Window window, ulong pixel) {
         if (_dpy) {
@@ -871,6 +990,7 @@ public:
 protected:
     static int parseGeometryVal(const char *c_str, const char *e_end,
                                 int &val_ret);
+    static bool setTrueColorPixel(XColor &xc, const Visual *visual);
 
 private:
     // squared distance because computing with sqrt is expensive
@@ -884,6 +1004,18 @@ private:
         return (p1 - p2) * (p1 - p2);
     }
 
+    static void fillEventBatch(void);
+
+    static void invalidatePrefetched(Window win, Atom atom) {
+        if (! _prefetched.empty()) {
+            _prefetched.erase(PropertyKey(win, atom));
+        }
+    }
+
+    static bool allocColor(const std::string &color, XColor &xc,
+                           bool &allocated);
+    static void freeUnusedColors(void);
+
     static void initHeads(void);
     static void initHeadsRandr(void);
     static void initHeadsXinerama(void);
@@ -920,11 +1052,24 @@ private:
     static bool _has_extension_xrandr;
     static int _event_xrandr;
 
+    static bool _has_extension_shm;
+    class ShmSegment;
+    /** Shared memory segments used for image transfers, re-used. */
+    static std::vector<ShmSegment*> _shm_segments;
+
+    static void initShm(void);
+    static void destructShm(void);
+    static ShmSegment *acquireShmSegment(size_t size);
+    static void releaseShmSegment(ShmSegment *segment);
+
     static std::vector<Head> _heads; //! Array of head information
     static uint _last_head; //! Last accessed head
 
     static uint _server_grabs;
 
+    /** Events read from the server but not yet processed. */
+    static EventBatch _event_batch;
+
     static Time _last_event_time;
     // information for dobule clicks
     static Window _last_click_id;
@@ -933,7 +1078,34 @@ private:
     static std::array<Cursor, CURSOR_NONE> _cursor_map;
 
     class ColorEntry;
-    static std::vector<ColorEntry *> _colours;
+    /** Colors, keyed on the lower cased color name. */
+    static std::unordered_map<std::string, ColorEntry*> _colours;
+    /** Colors, keyed on the XColor returned by getColor. */
+    static std::unordered_map<XColor*, ColorEntry*> _colour_entries;
+    static ColorStats _color_stats;
+
+    /**
+     * Property read with prefetchProperties, data is stored in the
+     * same format as returned by XGetWindowProperty.
+     */
+    class PrefetchedProperty {
+    public:
+        PrefetchedProperty(void)
+            : type(None),
+              format(0),
+              nitems(0)
+        {
+        }
+
+        Atom type;
+        int format;
+        ulong nitems;
+        std::vector<uchar> data;
+    };
+    typedef std::pair<Window, Atom> PropertyKey;
+    static std::map<PropertyKey, PrefetchedProperty> _prefetched;
+    static std::map<Window, XWindowAttributes> _prefetched_attributes;
+    static PropertyStats _property_stats;
     static XColor _xc_default; // when allocating fails
 
     static Atom _atoms[MAX_NR_ATOMS];
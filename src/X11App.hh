@@ -11,41 +11,16 @@
 #include "Debug.hh"
 #include "Charset.hh"
 #include "PWinObj.hh"
+#include "Reactor.hh"
 #include "X11.hh"
 
 extern "C" {
+#include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
 }
 
 
-static bool is_signal = false;
-static bool is_signal_alrm = false;
-static bool is_signal_hup = false;
-static bool is_signal_int_term = false;
-static bool is_signal_chld = false;
-
-static void sigHandler(int signal)
-{
-    is_signal = true;
-    switch (signal) {
-    case SIGHUP:
-        is_signal_hup = true;
-        break;
-    case SIGINT:
-    case SIGTERM:
-        is_signal_int_term = true;
-        break;
-    case SIGCHLD:
-        is_signal_chld = true;
-        break;
-    case SIGALRM:
-        // Do nothing, just used to break out of waiting
-        is_signal_alrm = true;
-        break;
-    }
-}
-
 /**
  * Base for X11 applications
  */
@@ -57,13 +32,15 @@ public:
         : PWinObj(true),
           _wm_name(wm_name),
           _wm_class(wm_class),
-          _stop(-1),
-          _max_fd(-1)
+          _stop(-1)
     {
         _dpy_fd = ConnectionNumber(X11::getDpy());
         addFd(_dpy_fd);
 
-        initSignalHandler();
+        _reactor.addSignal(SIGTERM);
+        _reactor.addSignal(SIGINT);
+        _reactor.addSignal(SIGHUP);
+        _reactor.addSignal(SIGCHLD);
 
         _gm = gm;
         _window =
@@ -107,51 +84,48 @@ public:
      */
     void stop(uint code) { _stop = code; }
 
-    void addFd(int fd)
-    {
-        if (fd > _max_fd) {
-            _max_fd = fd;
-        }
-        _fds.push_back(fd);
-    }
-
-    void removeFd(int fd)
-    {
-        _max_fd = 0;
-        auto it = _fds.begin();
-        for (; it != _fds.end(); ) {
-            if (*it == fd) {
-                it = _fds.erase(it);
-            } else {
-                if (*it > _max_fd) {
-                    _max_fd = *it;
-                }
-                ++it;
-            }
-        }
-    }
+    void addFd(int fd) { _reactor.addFd(fd); }
+    void removeFd(int fd) { _reactor.removeFd(fd); }
 
     virtual int main(uint timeout_s)
     {
-        bool timed_out = false;
+        std::vector<Reactor::Event> events;
+        int timer = timeout_s ? _reactor.addTimer(timeout_s * 1000, true) : 0;
 
         TRACE(_wm_name << ", " << _wm_class << ": entering main loop");
         while (_stop == -1) {
-            if (is_signal) {
-                handleSignal();
-            } else {
-                refresh(timed_out);
+            refresh(false);
+
+            // flush before waiting ensuring any outstanding output is
+            // sent before waiting on a reply.
+            X11::flush();
+            _reactor.wait(events, X11::pending() ? 0 : -1);
+            for (auto &ev : events) {
+                if (ev.type == Reactor::EVENT_FD && ev.value != _dpy_fd) {
+                    handleFd(ev.value);
+                } else if (ev.type == Reactor::EVENT_TIMER) {
+                    refresh(true);
+                }
+            }
+            // signals last, child done handlers may remove fds.
+            for (auto &ev : events) {
+                if (ev.type == Reactor::EVENT_SIGNAL) {
+                    handleSignal(ev.value);
+                }
+            }
 
-                if (X11::pending()) {
-                    XEvent ev;
-                    X11::getNextEvent(ev);
-                    handleEvent(&ev);
-                    timed_out = false;
-                } else {
-                    timed_out = waitForData(timeout_s);
+            XEvent ev;
+            struct timeval no_wait = { 0, 0 };
+            while (_stop == -1 && X11::getNextEvent(ev, &no_wait)) {
+                handleEvent(&ev);
+                if (! X11::hasBatchedEvents()) {
+                    break;
                 }
             }
         }
+        if (timer) {
+            _reactor.removeTimer(timer);
+        }
 
         return _stop;
     }
@@ -186,25 +160,10 @@ protected:
     }
 
 private:
-    void initSignalHandler(void)
+    void handleSignal(int signum)
     {
-        struct sigaction act;
-
-        // Set up the signal handlers.
-        act.sa_handler = sigHandler;
-        act.sa_mask = sigset_t();
-        act.sa_flags = SA_NOCLDSTOP | SA_NODEFER;
-
-        sigaction(SIGTERM, &act, 0);
-        sigaction(SIGINT, &act, 0);
-        sigaction(SIGHUP, &act, 0);
-        sigaction(SIGCHLD, &act, 0);
-        sigaction(SIGALRM, &act, 0);
-    }
-
-    void handleSignal(void)
-    {
-        if (is_signal_chld) {
+        switch (signum) {
+        case SIGCHLD: {
             pid_t pid;
             do {
                 int status;
@@ -220,47 +179,13 @@ private:
                     handleChildDone(pid, WEXITSTATUS(status));
                 }
             } while (pid > 0 || (pid == -1 && errno == EINTR));
-
-            is_signal_chld = false;
+            break;
         }
-        if (is_signal_int_term) {
+        case SIGINT:
+        case SIGTERM:
             stop(1);
-            is_signal_int_term = false;
+            break;
         }
-        is_signal = false;
-    }
-
-    bool waitForData(int timeout_s)
-    {
-        // flush before selecting input ensuring any outstanding
-        // output is sent before waiting on a reply.
-        X11::flush();
-
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        for (int fd : _fds) {
-            FD_SET(fd, &rfds);
-        }
-
-        struct timeval timeout = { timeout_s, 0 };
-        int ret = select(_max_fd + 1, &rfds, nullptr, nullptr, &timeout);
-        if (ret > 0) {
-            for (int fd : _fds) {
-                if (! FD_ISSET(fd, &rfds)) {
-                    continue;
-                }
-
-                if (fd == _dpy_fd) {
-                    XEvent ev;
-                    X11::getNextEvent(ev);
-                    handleEvent(&ev);
-                } else {
-                    handleFd(fd);
-                }
-            }
-        }
-
-        return ret < 1;
     }
 
 private:
@@ -268,7 +193,7 @@ private:
     std::string _wm_class;
 
     int _stop;
-    std::vector<int> _fds;
     int _dpy_fd;
-    int _max_fd;
+    /** Main loop, waits for X11 connection, added fds and signals. */
+    Reactor _reactor;
 };
@@ -0,0 +1,392 @@
+//
+// X11Prefetch.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "Debug.hh"
+#include "X11.hh"
+
+#include <cstring>
+
+extern "C" {
+#include <X11/Xlibint.h>
+#include <X11/Xproto.h>
+}
+
+// Xlibint.h defines min and max macros conflicting with std::min/max
+#undef min
+#undef max
+
+/** Max number of longs read for a single prefetched property. */
+#define PREFETCH_MAX_LENGTH (1024 * 1024)
+
+/**
+ * State for a single GetProperty request issued by
+ * prefetchProperties, filled in by prefetchHandler.
+ */
+class PrefetchRequest {
+public:
+    PrefetchRequest(void)
+        : seq(0),
+          done(false),
+          type(None),
+          format(0),
+          nitems(0),
+          after(0)
+    {
+        memset(&handler, 0, sizeof(handler));
+    }
+
+    _XAsyncHandler handler;
+    ulong seq;
+    bool done;
+
+    Atom type;
+    int format;
+    ulong nitems;
+    ulong after;
+    std::vector<uchar> data;
+};
+
+/**
+ * Async reply handler for GetProperty requests, converts data to the
+ * same format as returned by XGetWindowProperty.
+ */
+static Bool
+prefetchHandler(Display *dpy, xReply *rep, char *buf, int len, XPointer data)
+{
+    PrefetchRequest *req = reinterpret_cast<PrefetchRequest*>(data);
+    if (dpy->last_request_read != req->seq) {
+        return False;
+    }
+
+    if (rep->generic.type == X_Error) {
+        // let the error handler see the error, same as
+        // XGetWindowProperty would.
+        return False;
+    }
+    req->done = true;
+
+    xGetPropertyReply replbuf;
+    xGetPropertyReply *repl = reinterpret_cast<xGetPropertyReply*>(
+        _XGetAsyncReply(dpy, reinterpret_cast<char*>(&replbuf), rep,
+                        buf, len, 0, False));
+
+    req->type = repl->propertyType;
+    req->format = repl->format;
+    req->nitems = repl->nItems;
+    req->after = repl->bytesAfter;
+
+    ulong wire_size;
+    switch (req->format) {
+    case 8:
+        wire_size = 1;
+        break;
+    case 16:
+        wire_size = 2;
+        break;
+    case 32:
+        wire_size = 4;
+        break;
+    default:
+        wire_size = 0;
+        req->nitems = 0;
+        break;
+    }
+
+    ulong nbytes = req->nitems * wire_size;
+    ulong total = static_cast<ulong>(repl->length) << 2;
+    if (nbytes > total) {
+        nbytes = 0;
+        req->nitems = 0;
+        req->type = None;
+    }
+
+    std::vector<uchar> wire(nbytes);
+    if (total > 0) {
+        _XGetAsyncData(dpy, reinterpret_cast<char*>(wire.data()), buf, len,
+                       SIZEOF(xReply), nbytes, total);
+    }
+
+    // Xlib returns format 16 data as short and format 32 as long.
+    if (req->format == 32) {
+        req->data.resize(req->nitems * sizeof(long));
+        long *dst = reinterpret_cast<long*>(req->data.data());
+        for (ulong i = 0; i < req->nitems; i++) {
+            CARD32 val;
+            memcpy(&val, wire.data() + i * 4, 4);
+            dst[i] = static_cast<long>(static_cast<int32_t>(val));
+        }
+    } else if (req->format == 16) {
+        req->data.resize(req->nitems * sizeof(short));
+        short *dst = reinterpret_cast<short*>(req->data.data());
+        for (ulong i = 0; i < req->nitems; i++) {
+            CARD16 val;
+            memcpy(&val, wire.data() + i * 2, 2);
+            dst[i] = static_cast<short>(val);
+        }
+    } else {
+        req->data.swap(wire);
+    }
+
+    return True;
+}
+
+/**
+ * State for the GetWindowAttributes and GetGeometry requests issued
+ * for a window by prefetchWindows, filled in by attributesHandler.
+ */
+class AttributesRequest {
+public:
+    AttributesRequest(void)
+        : attr_seq(0),
+          geom_seq(0),
+          attr_done(false),
+          geom_done(false)
+    {
+        memset(&handler, 0, sizeof(handler));
+        memset(&attr, 0, sizeof(attr));
+    }
+
+    _XAsyncHandler handler;
+    ulong attr_seq;
+    ulong geom_seq;
+    bool attr_done;
+    bool geom_done;
+
+    XWindowAttributes attr;
+};
+
+/**
+ * Async reply handler for GetWindowAttributes and GetGeometry
+ * requests, fills in XWindowAttributes the same way as
+ * XGetWindowAttributes.
+ */
+static Bool
+attributesHandler(Display *dpy, xReply *rep, char *buf, int len, XPointer data)
+{
+    AttributesRequest *req = reinterpret_cast<AttributesRequest*>(data);
+    bool is_attr = dpy->last_request_read == req->attr_seq;
+    if (! is_attr && dpy->last_request_read != req->geom_seq) {
+        return False;
+    }
+    if (rep->generic.type == X_Error) {
+        return False;
+    }
+
+    XWindowAttributes &attr = req->attr;
+    if (is_attr) {
+        xGetWindowAttributesReply replbuf;
+        xGetWindowAttributesReply *repl =
+            reinterpret_cast<xGetWindowAttributesReply*>(
+                _XGetAsyncReply(dpy, reinterpret_cast<char*>(&replbuf), rep,
+                                buf, len,
+                                (SIZEOF(xGetWindowAttributesReply)
+                                 - SIZEOF(xReply)) >> 2, True));
+        attr.c_class = repl->c_class;
+        attr.bit_gravity = repl->bitGravity;
+        attr.win_gravity = repl->winGravity;
+        attr.backing_store = repl->backingStore;
+        attr.backing_planes = repl->backingBitPlanes;
+        attr.backing_pixel = repl->backingPixel;
+        attr.save_under = repl->saveUnder;
+        attr.colormap = repl->colormap;
+        attr.map_installed = repl->mapInstalled;
+        attr.map_state = repl->mapState;
+        attr.all_event_masks = repl->allEventMasks;
+        attr.your_event_mask = repl->yourEventMask;
+        attr.do_not_propagate_mask = repl->doNotPropagateMask;
+        attr.override_redirect = repl->override;
+        attr.visual = _XVIDtoVisual(dpy, repl->visualID);
+        req->attr_done = true;
+    } else {
+        xGetGeometryReply replbuf;
+        xGetGeometryReply *repl = reinterpret_cast<xGetGeometryReply*>(
+            _XGetAsyncReply(dpy, reinterpret_cast<char*>(&replbuf), rep,
+                            buf, len, 0, True));
+        attr.root = repl->root;
+        attr.x = cvtINT16toInt(repl->x);
+        attr.y = cvtINT16toInt(repl->y);
+        attr.width = repl->width;
+        attr.height = repl->height;
+        attr.border_width = repl->borderWidth;
+        attr.depth = repl->depth;
+        for (int i = 0; i < dpy->nscreens; i++) {
+            if (ScreenOfDisplay(dpy, i)->root == attr.root) {
+                attr.screen = ScreenOfDisplay(dpy, i);
+                break;
+            }
+        }
+        req->geom_done = true;
+    }
+
+    return True;
+}
+
+/**
+ * Read properties from win in a single round-trip, subsequent reads
+ * of the same properties with getWindowProperty (and all helpers
+ * built on top of it) are served from memory until clearPrefetched
+ * is called.
+ */
+void
+X11::prefetchProperties(Window win, const std::vector<Atom> &atoms)
+{
+    prefetchWindows(std::vector<Window>(1, win), atoms, false);
+}
+
+/**
+ * Same as prefetchProperties but for multiple windows, optionally
+ * reading the window attributes used by getWindowAttributes.
+ *
+ * All requests are written at once with an async reply handler each,
+ * then a GetInputFocus request is used to wait for all of the
+ * replies.
+ */
+void
+X11::prefetchWindows(const std::vector<Window> &wins,
+                     const std::vector<Atom> &atoms, bool attributes)
+{
+    if (! _dpy || wins.empty() || (atoms.empty() && ! attributes)) {
+        return;
+    }
+
+    _property_stats.prefetches++;
+    _property_stats.prefetched += wins.size() * atoms.size();
+
+    // handlers are linked into the display, the vectors must not be
+    // resized after this point.
+    std::vector<PrefetchRequest> reqs(wins.size() * atoms.size());
+    std::vector<AttributesRequest> attr_reqs(attributes ? wins.size() : 0);
+
+    Display *dpy = _dpy;
+    LockDisplay(dpy);
+    for (size_t i = 0; i < wins.size(); i++) {
+        if (attributes) {
+            AttributesRequest &attr_req = attr_reqs[i];
+            xResourceReq *req;
+            GetResReq(GetWindowAttributes, wins[i], req);
+            attr_req.attr_seq = dpy->request;
+            GetResReq(GetGeometry, wins[i], req);
+            attr_req.geom_seq = dpy->request;
+
+            attr_req.handler.next = dpy->async_handlers;
+            attr_req.handler.handler = attributesHandler;
+            attr_req.handler.data = reinterpret_cast<XPointer>(&attr_req);
+            dpy->async_handlers = &attr_req.handler;
+        }
+
+        for (size_t j = 0; j < atoms.size(); j++) {
+            PrefetchRequest &prop_req = reqs[i * atoms.size() + j];
+            xGetPropertyReq *req;
+            GetReq(GetProperty, req);
+            req->window = wins[i];
+            req->property = atoms[j];
+            req->type = AnyPropertyType;
+            req->c_delete = False;
+            req->longOffset = 0;
+            req->longLength = PREFETCH_MAX_LENGTH;
+
+            prop_req.seq = dpy->request;
+            prop_req.handler.next = dpy->async_handlers;
+            prop_req.handler.handler = prefetchHandler;
+            prop_req.handler.data = reinterpret_cast<XPointer>(&prop_req);
+            dpy->async_handlers = &prop_req.handler;
+        }
+    }
+
+    xReq *sync_req;
+    GetEmptyReq(GetInputFocus, sync_req);
+    (void) sync_req;
+    xGetInputFocusReply sync_rep;
+    _XReply(dpy, reinterpret_cast<xReply*>(&sync_rep), 0, xTrue);
+
+    for (auto &req : reqs) {
+        DeqAsyncHandler(dpy, &req.handler);
+    }
+    for (auto &req : attr_reqs) {
+        DeqAsyncHandler(dpy, &req.handler);
+    }
+    UnlockDisplay(dpy);
+    SyncHandle();
+
+    for (size_t i = 0; i < wins.size(); i++) {
+        if (attributes && attr_reqs[i].attr_done && attr_reqs[i].geom_done) {
+            _prefetched_attributes[wins[i]] = attr_reqs[i].attr;
+        }
+
+        for (size_t j = 0; j < atoms.size(); j++) {
+            PrefetchRequest &req = reqs[i * atoms.size() + j];
+            // failed requests and incomplete reads are left for
+            // XGetWindowProperty.
+            if (! req.done || req.after > 0) {
+                continue;
+            }
+
+            PrefetchedProperty &prop =
+                _prefetched[PropertyKey(wins[i], atoms[j])];
+            prop.type = req.type;
+            prop.format = req.format;
+            prop.nitems = req.nitems;
+            prop.data.swap(req.data);
+        }
+    }
+}
+
+/**
+ * Wrapper for XGetWindowAttributes, attributes read with
+ * prefetchWindows are used if available.
+ */
+bool
+X11::getWindowAttributes(Window win, XWindowAttributes &attr)
+{
+    auto it = _prefetched_attributes.find(win);
+    if (it == _prefetched_attributes.end()) {
+        if (! _prefetched_attributes.empty()) {
+            _property_stats.misses++;
+        }
+        return XGetWindowAttributes(_dpy, win, &attr);
+    }
+    _property_stats.hits++;
+    attr = it->second;
+    return true;
+}
+
+/**
+ * Check if any data has been prefetched for win.
+ */
+bool
+X11::isPrefetched(Window win)
+{
+    if (_prefetched_attributes.count(win)) {
+        return true;
+    }
+    auto it = _prefetched.lower_bound(PropertyKey(win, 0));
+    return it != _prefetched.end() && it->first.first == win;
+}
+
+/**
+ * Drop prefetched properties and attributes for win.
+ */
+void
+X11::clearPrefetched(Window win)
+{
+    _prefetched_attributes.erase(win);
+    auto it = _prefetched.lower_bound(PropertyKey(win, 0));
+    while (it != _prefetched.end() && it->first.first == win) {
+        it = _prefetched.erase(it);
+    }
+}
+
+/**
+ * Drop all prefetched properties and attributes.
+ */
+void
+X11::clearAllPrefetched(void)
+{
+    _prefetched.clear();
+    _prefetched_attributes.clear();
+}
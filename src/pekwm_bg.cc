@@ -9,6 +9,7 @@
 #include "pekwm.hh"
 
 #include "ImageHandler.hh"
+#include "Reactor.hh"
 #include "TextureHandler.hh"
 #include "Util.hh"
 #include "X11.hh"
@@ -19,7 +20,6 @@ extern "C" {
 #include <unistd.h>
 }
 
-static bool _stop = false;
 static ImageHandler* _image_handler = nullptr;
 static TextureHandler* _texture_handler = nullptr;
 
@@ -36,13 +36,6 @@ namespace pekwm
     }
 }
 
-static void sighandler(int signal)
-{
-    if (signal == SIGINT) {
-        _stop = true;
-    }
-}
-
 static void init(Display* dpy)
 {
     _image_handler = new ImageHandler();
@@ -58,6 +51,7 @@ static void cleanup()
 static void usage(const char* name, int ret)
 {
     std::cout << "usage: " << name << " [-hl] texture" << std::endl
+              << "  -c --cache          Cache decoded images on disk" << std::endl
               << "  -d --display dpy    Display" << std::endl
               << "  -D --daemon         Run in the background" << std::endl
               << "  -h --help           Display this information" << std::endl
@@ -96,9 +90,27 @@ void modeBackground(const std::string& tex_str)
         // used for stop actions
         X11::setCardinal(X11::getRoot(), PEKWM_BG_PID, getpid());
 
-        XEvent ev;
-        while (! _stop && X11::getNextEvent(ev)) {
-            ;
+        // wait for SIGINT, X events are read and discarded.
+        Reactor reactor;
+        reactor.addFd(ConnectionNumber(X11::getDpy()));
+        reactor.addSignal(SIGINT);
+
+        std::vector<Reactor::Event> events;
+        bool stop = false;
+        while (! stop) {
+            X11::flush();
+            reactor.wait(events, X11::pending() ? 0 : -1);
+            for (auto &rev : events) {
+                if (rev.type == Reactor::EVENT_SIGNAL) {
+                    stop = true;
+                }
+            }
+
+            XEvent ev;
+            struct timeval no_wait = { 0, 0 };
+            while (X11::getNextEvent(ev, &no_wait)) {
+                ;
+            }
         }
 
         X11::freePixmap(pix);
@@ -124,10 +136,12 @@ int main(int argc, char* argv[])
 {
     const char* display = NULL;
     bool do_daemon = false;
+    bool cache = false;
     bool stop = false;
     std::string load_dir("./");
 
     static struct option opts[] = {
+        {"cache", no_argument, NULL, 'c'},
         {"display", required_argument, NULL, 'd'},
         {"daemon", no_argument, NULL, 'D'},
         {"help", no_argument, NULL, 'h'},
@@ -137,8 +151,11 @@ int main(int argc, char* argv[])
     };
 
     int ch;
-    while ((ch = getopt_long(argc, argv, "d:Dhl:s", opts, NULL)) != -1) {
+    while ((ch = getopt_long(argc, argv, "cd:Dhl:s", opts, NULL)) != -1) {
         switch (ch) {
+        case 'c':
+            cache = true;
+            break;
         case 'd':
             display = optarg;
             break;
@@ -186,14 +203,14 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    // setup signal handler after connecting to the display
-    signal(SIGINT, &sighandler);
-
     X11::init(dpy, true);
     init(dpy);
 
     std::cout << "Load dir " << load_dir << std::endl;
     _image_handler->path_push_back(load_dir);
+    if (cache) {
+        _image_handler->getDiskCache().setDir(ImageDiskCache::getDefaultDir());
+    }
 
     modeStop();
     if (! stop) {
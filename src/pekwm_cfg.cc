@@ -8,6 +8,7 @@
 
 #include "Compat.hh"
 #include "CfgParser.hh"
+#include "CfgParserCache.hh"
 #include "Util.hh"
 
 #include <map>
@@ -20,8 +21,12 @@ extern "C" {
 
 static void usage(const char* name, int ret)
 {
-    std::cout << "usage: " << name << " [-j]" << std::endl
-              << "  -j --json file    dump file as JSON" << std::endl;
+    std::cout << "usage: " << name << " [-c|-j|-s]" << std::endl
+              << "  -c --compile file compile file into the cache"
+              << std::endl
+              << "  -j --json file    dump file as JSON" << std::endl
+              << "  -s --stats file   print parse tree statistics"
+              << std::endl;
     exit(ret);
 }
 
@@ -77,21 +82,88 @@ jsonDump(const std::string& path,
     std::cout << "}" << std::endl;
 }
 
+/**
+ * Parse file the same way as pekwm, overwriting duplicate entries,
+ * and print statistics on memory use and lookups.
+ */
+static void
+statsDump(const std::string& path,
+          const std::map<std::string, std::string> &cfg_env)
+{
+    CfgParser cfg;
+    for (auto it : cfg_env) {
+        cfg.setVar(it.first, it.second);
+    }
+    cfg.parse(path, CfgParserSource::SOURCE_FILE, true);
+
+    std::cout << cfg.getStats() << std::endl;
+}
+
+/**
+ * Compile file into the configuration cache, both with and without
+ * overwrite of duplicate entries as the file may be parsed both ways.
+ */
+static bool
+compile(const std::string& path,
+        const std::map<std::string, std::string> &cfg_env)
+{
+    // same environment as set by pekwm before parsing
+    setenv("PEKWM_ETC_PATH", SYSCONFDIR, 1);
+    setenv("PEKWM_SCRIPT_PATH", DATADIR "/pekwm/scripts", 1);
+    setenv("PEKWM_THEME_PATH", DATADIR "/pekwm/themes", 1);
+
+    auto dir = Util::getCacheDir() + "/config";
+    if (! Util::makeDirs(dir)) {
+        std::cerr << "failed to create " << dir << std::endl;
+        return false;
+    }
+    CfgParserCache::setDir(dir);
+
+    for (int overwrite = 0; overwrite < 2; overwrite++) {
+        CfgParser cfg;
+        for (auto it : cfg_env) {
+            cfg.setVar(it.first, it.second);
+        }
+        if (! cfg.parse(path, CfgParserSource::SOURCE_FILE, overwrite)) {
+            std::cerr << "failed to parse " << path << std::endl;
+            return false;
+        }
+        if (cfg.isDynamicContent()) {
+            std::cerr << path << " includes COMMAND output, not compiled"
+                      << std::endl;
+            return false;
+        }
+        if (! CfgParserCache::save(cfg, path, overwrite)) {
+            std::cerr << "failed to compile " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char* argv[])
 {
+    bool compile_cfg = false;
+    bool stats = false;
     std::string cfg_path;
     std::map<std::string, std::string> cfg_env;
 
     static struct option opts[] = {
+        {"compile", required_argument, NULL, 'c'},
         {"json", required_argument, NULL, 'd'},
         {"env", required_argument, NULL, 'e'},
         {"help", no_argument, NULL, 'h'},
+        {"stats", required_argument, NULL, 's'},
         {NULL, 0, NULL, 0}
     };
 
     int ch;
-    while ((ch = getopt_long(argc, argv, "e:j:h", opts, NULL)) != -1) {
+    while ((ch = getopt_long(argc, argv, "c:e:j:hs:", opts, NULL)) != -1) {
         switch (ch) {
+        case 'c':
+            compile_cfg = true;
+            cfg_path = optarg;
+            break;
         case 'e': {
             std::vector<std::string> vals;
             if (Util::splitString<char>(optarg, vals, "=", 2) == 2) {
@@ -106,13 +178,21 @@ int main(int argc, char* argv[])
         case 'h':
             usage(argv[0], 0);
             break;
+        case 's':
+            stats = true;
+            cfg_path = optarg;
+            break;
         default:
             usage(argv[0], 1);
             break;
         }
     }
 
-    if (! cfg_path.empty()) {
+    if (compile_cfg) {
+        return compile(cfg_path, cfg_env) ? 0 : 1;
+    } else if (stats) {
+        statsDump(cfg_path, cfg_env);
+    } else if (! cfg_path.empty()) {
         jsonDump(cfg_path, cfg_env);
     }
 
@@ -0,0 +1,548 @@
+//
+// bench_pekwm.cc for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+// Micro benchmarks for internal data structures, not run as part of
+// the test suite. Run with bench_pekwm [name] to only run benchmarks
+// with name in the benchmark name.
+//
+
+#include "CfgParser.hh"
+#include "ImageHandler.hh"
+#include "PFont.hh"
+#include "PImage.hh"
+#include "PImageLoaderPng.hh"
+#include "SnapIndex.hh"
+#include "StackingList.hh"
+#include "Util.hh"
+#include "WinLayouter.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <stdlib.h>
+#include <time.h>
+}
+
+typedef void(*bench_fn)(uint);
+
+static void
+runBenchmark(const std::string &name, bench_fn fn, uint iterations)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    fn(iterations);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long us = Util::timeDiffUs(end, start);
+    std::cout << name << ": " << iterations << " iterations in "
+              << us << "us, " << (static_cast<double>(us) / iterations)
+              << "us/iteration" << std::endl;
+}
+
+// Stacking
+
+#define STACKING_FRAMES 1000
+
+class StackObj {
+public:
+    Layer layer;
+};
+
+static std::vector<StackObj>
+stackingObjs(void)
+{
+    std::vector<StackObj> objs(STACKING_FRAMES);
+    for (uint i = 0; i < objs.size(); i++) {
+        // mostly normal windows with a few in the other layers
+        objs[i].layer = i % 10 ? LAYER_NORMAL : static_cast<Layer>(i % 7);
+    }
+    return objs;
+}
+
+/**
+ * Raise with a flat vector, the way Workspaces used to do it.
+ */
+static void
+benchStackingVector(uint iterations)
+{
+    auto objs = stackingObjs();
+    std::vector<StackObj*> stack;
+    for (auto &obj : objs) {
+        stack.push_back(&obj);
+    }
+
+    for (uint i = 0; i < iterations; i++) {
+        StackObj *obj = &objs[(i * 7919) % objs.size()];
+        stack.erase(std::find(stack.begin(), stack.end(), obj));
+        auto it = stack.begin();
+        for (; it != stack.end() && (*it)->layer <= obj->layer; ++it)
+            ;
+        stack.insert(it, obj);
+    }
+}
+
+static void
+benchStackingList(uint iterations)
+{
+    auto objs = stackingObjs();
+    StackingList<StackObj*> stack;
+    for (auto &obj : objs) {
+        stack.insertBelow(&obj, obj.layer, stack.findFirstAbove(obj.layer));
+    }
+
+    for (uint i = 0; i < iterations; i++) {
+        StackObj *obj = &objs[(i * 7919) % objs.size()];
+        stack.remove(obj);
+        stack.insertBelow(obj, obj->layer, stack.findFirstAbove(obj->layer));
+    }
+}
+
+// Snapping
+
+#define SNAP_FRAMES 1000
+
+static std::vector<Geometry>
+snapGeometries(void)
+{
+    std::vector<Geometry> gms;
+    for (uint i = 0; i < SNAP_FRAMES; i++) {
+        gms.push_back(Geometry((i * 7919) % 3600, (i * 104729) % 2000,
+                               100 + (i * 31) % 600, 100 + (i * 17) % 400));
+    }
+    return gms;
+}
+
+/**
+ * Check all frames for snapping, the way checkWOSnap used to do it.
+ */
+static void
+benchSnapLinear(uint iterations)
+{
+    auto gms = snapGeometries();
+    uint found = 0;
+    for (uint i = 0; i < iterations; i++) {
+        Geometry gm((i * 13) % 3600, (i * 7) % 2000, 400, 300);
+        int x = gm.x + gm.width;
+        int y = gm.y + gm.height;
+        for (auto &o : gms) {
+            int rx = o.x + o.width;
+            int by = o.y + o.height;
+            if ((x >= o.x - 10 && x <= o.x + 5)
+                || (gm.x >= rx - 5 && gm.x <= rx + 10)
+                || (y >= o.y - 10 && y <= o.y + 5)
+                || (gm.y >= by - 5 && gm.y <= by + 10)) {
+                found++;
+            }
+        }
+    }
+    if (found == 0) {
+        std::cerr << "no frames found" << std::endl;
+    }
+}
+
+static void
+benchSnapIndex(uint iterations)
+{
+    SnapIndex index;
+    for (auto &gm : snapGeometries()) {
+        index.add(gm);
+    }
+
+    uint found = 0;
+    std::vector<size_t> entries;
+    for (uint i = 0; i < iterations; i++) {
+        Geometry gm((i * 13) % 3600, (i * 7) % 2000, 400, 300);
+        index.find(gm, 10, 5, entries);
+        found += entries.size();
+    }
+    if (found == 0) {
+        std::cerr << "no frames found" << std::endl;
+    }
+}
+
+// Placement
+
+#define PLACEMENT_FRAMES 30
+
+static std::vector<Geometry>
+placementGeometries(void)
+{
+    // 4K head mostly covered by windows
+    std::vector<Geometry> gms;
+    for (uint i = 0; i < PLACEMENT_FRAMES; i++) {
+        gms.push_back(Geometry((i % 6) * 640, (i / 6) * 432,
+                               600 + (i * 31) % 80, 400 + (i * 17) % 60));
+    }
+    return gms;
+}
+
+static const Geometry*
+placementFindObstacle(const std::vector<Geometry> &gms, int x, int y,
+                      uint width, uint height)
+{
+    for (auto &gm : gms) {
+        if ((gm.x < signed(x + width))
+            && (signed(gm.x + gm.width) > x)
+            && (gm.y < signed(y + height))
+            && (signed(gm.y + gm.height) > y)) {
+            return &gm;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Check every row of the head, the way smart placement used to do it.
+ */
+static void
+benchPlacementScan(uint iterations)
+{
+    Geometry head(0, 0, 3840, 2160);
+    auto gms = placementGeometries();
+    for (uint i = 0; i < iterations; i++) {
+        uint width = 200 + i % 200;
+        uint height = 150;
+        bool placed = false;
+        for (int y = head.y;
+             ! placed && y + height <= head.y + head.height; y++) {
+            int x = head.x;
+            while (! placed && x + width <= head.x + head.width) {
+                auto gm = placementFindObstacle(gms, x, y, width, height);
+                if (gm) {
+                    x = gm->x + gm->width;
+                } else {
+                    placed = true;
+                }
+            }
+        }
+    }
+}
+
+static void
+benchPlacementSmart(uint iterations)
+{
+    Geometry head(0, 0, 3840, 2160);
+    SmartPlacement placement(head, true, true, true, 0, 0);
+    for (auto &gm : placementGeometries()) {
+        placement.addObstacle(gm);
+    }
+    for (uint i = 0; i < iterations; i++) {
+        int x, y;
+        placement.place(200 + i % 200, 150, x, y);
+    }
+}
+
+// Image scaling
+
+#define SCALE_SRC_WIDTH 1920
+#define SCALE_SRC_HEIGHT 1080
+#define SCALE_DST_WIDTH 3840
+#define SCALE_DST_HEIGHT 2160
+
+static std::vector<uchar>
+scaleImage(uint width, uint height)
+{
+    std::vector<uchar> data(width * height * 4);
+    for (uint i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uchar>(i * 31);
+    }
+    return data;
+}
+
+/**
+ * Floating point scaling per channel, the way PImage used to do it.
+ */
+static void
+benchScaleFloat(uint iterations)
+{
+    auto src = scaleImage(SCALE_SRC_WIDTH, SCALE_SRC_HEIGHT);
+    std::vector<uchar> dst(SCALE_DST_WIDTH * SCALE_DST_HEIGHT * 4);
+    float x_ratio = static_cast<float>(SCALE_SRC_WIDTH - 1) / SCALE_DST_WIDTH;
+    float y_ratio = static_cast<float>(SCALE_SRC_HEIGHT - 1) / SCALE_DST_HEIGHT;
+    for (uint i = 0; i < iterations; i++) {
+        uchar *d = dst.data();
+        for (uint dy = 0; dy < SCALE_DST_HEIGHT; dy++) {
+            for (uint dx = 0; dx < SCALE_DST_WIDTH; dx++) {
+                uint sx = static_cast<uint>(x_ratio * dx);
+                uint sy = static_cast<uint>(y_ratio * dy);
+                float x_diff = (x_ratio * dx) - sx;
+                float y_diff = (y_ratio * dy) - sy;
+                for (uint c = 0; c < 4; c++) {
+                    const uchar *p = src.data()
+                        + (sy * SCALE_SRC_WIDTH + sx) * 4 + c;
+                    float res = p[0] * (1 - x_diff) * (1 - y_diff)
+                        + p[4] * x_diff * (1 - y_diff)
+                        + p[SCALE_SRC_WIDTH * 4] * y_diff * (1 - x_diff)
+                        + p[SCALE_SRC_WIDTH * 4 + 4] * x_diff * y_diff;
+                    *d++ = static_cast<uchar>(res);
+                }
+            }
+        }
+    }
+}
+
+static void
+benchScaleFixed(uint iterations)
+{
+    auto src = scaleImage(SCALE_SRC_WIDTH, SCALE_SRC_HEIGHT);
+    std::vector<uchar> dst(SCALE_DST_WIDTH * SCALE_DST_HEIGHT * 4);
+    for (uint i = 0; i < iterations; i++) {
+        PImage::scaleData(src.data(), SCALE_SRC_WIDTH, SCALE_SRC_HEIGHT,
+                          dst.data(), SCALE_DST_WIDTH, SCALE_DST_HEIGHT);
+    }
+}
+
+static void
+benchScaleArea(uint iterations)
+{
+    auto src = scaleImage(SCALE_DST_WIDTH, SCALE_DST_HEIGHT);
+    std::vector<uchar> dst(SCALE_SRC_WIDTH / 2 * SCALE_SRC_HEIGHT / 2 * 4);
+    for (uint i = 0; i < iterations; i++) {
+        PImage::scaleData(src.data(), SCALE_DST_WIDTH, SCALE_DST_HEIGHT,
+                          dst.data(), SCALE_SRC_WIDTH / 2,
+                          SCALE_SRC_HEIGHT / 2);
+    }
+}
+
+// Title trimming
+
+/**
+ * Font computing text width client side, each getWidth call
+ * corresponds to a text extents query.
+ */
+class PFontBench : public PFont {
+public:
+    virtual uint getWidth(const std::wstring &text, uint max_chars = 0) {
+        if (! max_chars || max_chars > text.size()) {
+            max_chars = text.size();
+        }
+        uint width = 0;
+        for (uint i = 0; i < max_chars; i++) {
+            width += 5 + text[i] % 7;
+        }
+        return width;
+    }
+};
+
+static const std::wstring TRIM_TITLE =
+    L"A rather long title of a web page with a lot of words in it, "
+    L"as seen in most tabs - Web Browser";
+
+static void
+benchTrimLinear(uint iterations)
+{
+    PFontBench font;
+    for (uint i = 0; i < iterations; i++) {
+        std::wstring text(TRIM_TITLE);
+        for (uint j = text.size(); j > 0; --j) {
+            if (font.getWidth(text, j) <= 100 + i % 50) {
+                text = text.substr(0, j);
+                break;
+            }
+        }
+    }
+}
+
+static void
+benchTrimCached(uint iterations)
+{
+    PFontBench font;
+    for (uint i = 0; i < iterations; i++) {
+        std::wstring text(TRIM_TITLE);
+        font.trimEnd(text, 100 + i % 50);
+    }
+}
+
+// Configuration parsing
+
+#define CFG_PARSE_ENTRIES 20000
+
+/**
+ * Generate configuration resembling a generated menu with
+ * CFG_PARSE_ENTRIES entries.
+ */
+static std::string
+cfgParseData(void)
+{
+    static std::string data;
+    if (! data.empty()) {
+        return data;
+    }
+
+    data = "# generated menu\n$TERM = \"xterm -fn fixed\"\n";
+    data += "RootMenu = \"Applications\" {\n";
+    for (uint i = 0; i < CFG_PARSE_ENTRIES; i++) {
+        if (i % 100 == 0) {
+            if (i) {
+                data += "\t}\n";
+            }
+            data += "\tSubmenu = \"Category " + std::to_string(i / 100)
+                + "\" {\n";
+        }
+        data += "\t\tEntry = \"Application " + std::to_string(i)
+            + "\" { Icon = \"app" + std::to_string(i) + ".png\"; "
+            + "Actions = \"Exec $TERM -e /usr/bin/application-"
+            + std::to_string(i) + " --option \\\"value\\\" &\" }"
+            + " // entry " + std::to_string(i) + "\n";
+    }
+    data += "\t}\n}\n";
+    return data;
+}
+
+/**
+ * Write cfgParseData to a temporary file, returns the file name.
+ */
+static std::string
+cfgParseFile(void)
+{
+    static std::string file;
+    if (! file.empty()) {
+        return file;
+    }
+
+    char tmpl[] = "/tmp/bench_pekwm.XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        return file;
+    }
+    file = std::string(tmpl) + "/menu";
+    std::ofstream ofs(file.c_str());
+    ofs << cfgParseData();
+    return file;
+}
+
+static void
+benchCfgParseFile(uint iterations)
+{
+    auto file = cfgParseFile();
+    for (uint i = 0; i < iterations; i++) {
+        CfgParser cfg;
+        cfg.parse(file);
+    }
+}
+
+static void
+benchCfgParseString(uint iterations)
+{
+    auto data = cfgParseData();
+    for (uint i = 0; i < iterations; i++) {
+        CfgParser cfg;
+        cfg.parse(new CfgParserSourceString(":memory:", data));
+    }
+}
+
+// Theme images
+
+#ifdef HAVE_IMAGE_PNG
+
+#define THEME_IMAGES 64
+#define THEME_IMAGE_SIZE 256
+
+/**
+ * Write THEME_IMAGES png images to a temporary directory, returns the
+ * directory.
+ */
+static std::string
+themeImagesDir(void)
+{
+    static std::string dir;
+    if (! dir.empty()) {
+        return dir;
+    }
+
+    char tmpl[] = "/tmp/bench_pekwm.XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        return dir;
+    }
+    dir = std::string(tmpl) + "/";
+
+    auto data = scaleImage(THEME_IMAGE_SIZE, THEME_IMAGE_SIZE);
+    for (uint i = 0; i < THEME_IMAGES; i++) {
+        PImageLoaderPng::save(dir + std::to_string(i) + ".png", data.data(),
+                              THEME_IMAGE_SIZE, THEME_IMAGE_SIZE);
+    }
+    return dir;
+}
+
+static void
+benchThemeImages(uint iterations, bool prefetch)
+{
+    std::vector<std::string> files;
+    for (uint i = 0; i < THEME_IMAGES; i++) {
+        files.push_back(std::to_string(i) + ".png#SCALED");
+    }
+
+    ImageHandler handler;
+    handler.setCacheSize(0);
+    handler.path_push_back(themeImagesDir());
+    for (uint i = 0; i < iterations; i++) {
+        if (prefetch) {
+            handler.prefetch(files);
+        }
+        std::vector<PImage*> images;
+        for (auto &file : files) {
+            images.push_back(handler.getImage(file));
+        }
+        handler.prefetchDone();
+        for (auto image : images) {
+            handler.returnImage(image);
+        }
+    }
+}
+
+static void
+benchThemeImagesSerial(uint iterations)
+{
+    benchThemeImages(iterations, false);
+}
+
+static void
+benchThemeImagesPrefetch(uint iterations)
+{
+    benchThemeImages(iterations, true);
+}
+
+#endif // HAVE_IMAGE_PNG
+
+int
+main(int argc, char *argv[])
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+    struct {
+        const char *name;
+        bench_fn fn;
+        uint iterations;
+    } benchmarks[] = {
+        {"stacking_raise_vector", benchStackingVector, 100000},
+        {"stacking_raise_list", benchStackingList, 100000},
+        {"snap_linear", benchSnapLinear, 100000},
+        {"snap_index", benchSnapIndex, 100000},
+        {"placement_scan", benchPlacementScan, 100},
+        {"placement_smart", benchPlacementSmart, 100},
+        {"scale_float", benchScaleFloat, 5},
+        {"scale_fixed", benchScaleFixed, 5},
+        {"scale_area", benchScaleArea, 5},
+        {"trim_linear", benchTrimLinear, 10000},
+        {"trim_cached", benchTrimCached, 10000},
+        {"cfg_parse_file", benchCfgParseFile, 10},
+        {"cfg_parse_string", benchCfgParseString, 10},
+#ifdef HAVE_IMAGE_PNG
+        {"theme_images_serial", benchThemeImagesSerial, 5},
+        {"theme_images_prefetch", benchThemeImagesPrefetch, 5},
+#endif // HAVE_IMAGE_PNG
+    };
+
+    for (auto &bench : benchmarks) {
+        if (filter.empty() || std::string(bench.name).find(filter) != std::string::npos) {
+            runBenchmark(bench.name, bench.fn, bench.iterations);
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef _TEST_HH_
 #define _TEST_HH_
 
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -8,6 +10,13 @@
 #include <string>
 #include <sstream>
 
+extern "C" {
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+}
+
 class AssertFailed {
 public:
     AssertFailed(std::string file, int line, std::string msg)
@@ -33,6 +42,76 @@ private:
         throw AssertFailed(__FILE__, __LINE__, oss.str());              \
     }
 
+/**
+ * Temporary directory, removed with all of its content when destroyed.
+ */
+class TestDir {
+public:
+    TestDir(void)
+    {
+        char tmpl[] = "/tmp/test_pekwm.XXXXXX";
+        if (mkdtemp(tmpl) != nullptr) {
+            _path = tmpl;
+        }
+    }
+    ~TestDir(void)
+    {
+        if (! _path.empty()) {
+            remove(_path);
+        }
+    }
+
+    /** Path of the directory, empty if it could not be created. */
+    const std::string &path(void) const { return _path; }
+
+    /**
+     * Write data to name in the directory, setting the modification
+     * time to mtime if not 0.
+     *
+     * @return Path of written file.
+     */
+    std::string writeFile(const std::string &name, const std::string &data,
+                          time_t mtime = 0) const
+    {
+        auto file = _path + "/" + name;
+        {
+            std::ofstream ofs(file.c_str());
+            ofs << data;
+        }
+        if (mtime) {
+            struct timeval times[2] = {{mtime, 0}, {mtime, 0}};
+            utimes(file.c_str(), times);
+        }
+        return file;
+    }
+
+    /** Remove path, including all content if path is a directory. */
+    static void remove(const std::string &path)
+    {
+        auto dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            unlink(path.c_str());
+            return;
+        }
+
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != nullptr) {
+            std::string name(ent->d_name);
+            if (name != "." && name != "..") {
+                remove(path + "/" + name);
+            }
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+    }
+
+private:
+    TestDir(const TestDir&);
+    TestDir &operator=(const TestDir&);
+
+    std::string _path;
+};
+
 class TestSuite {
 public:
     typedef std::function<void()> test_fn;
@@ -9,6 +9,43 @@
 #include "test.hh"
 #include "CfgParser.hh"
 
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+/**
+ * String source providing data in blocks of block_size bytes.
+ */
+class CfgParserSourceBlocks : public CfgParserSource {
+public:
+    CfgParserSourceBlocks(const std::string &data, size_t block_size)
+        : CfgParserSource(":blocks:"),
+          _data(data),
+          _offset(0),
+          _block_size(block_size)
+    {
+    }
+
+    virtual bool open(void) override { return true; }
+    virtual void close(void) override { }
+
+protected:
+    virtual bool fill(void) override {
+        if (_offset >= _data.size()) {
+            return false;
+        }
+        auto len = std::min(_block_size, _data.size() - _offset);
+        setBuffer(_data.data() + _offset, _data.data() + _offset + len);
+        _offset += len;
+        return true;
+    }
+
+private:
+    std::string _data;
+    size_t _offset;
+    size_t _block_size;
+};
+
 class TestCfgParser : public TestSuite,
                       public CfgParser {
 public:
@@ -21,6 +58,44 @@ public:
         register_test("INCLUDE without newline",
                       std::bind(&TestCfgParser::testIncludeWithoutNewline,
                                 this));
+        register_test("entry without newline",
+                      std::bind(&TestCfgParser::testEntryWithoutNewline,
+                                this));
+        register_test("blocks",
+                      std::bind(&TestCfgParser::testBlocks, this));
+        register_test("lookup",
+                      std::bind(&TestCfgParser::testLookup, this));
+        register_test("overwrite",
+                      std::bind(&TestCfgParser::testOverwrite, this));
+        register_test("commands",
+                      std::bind(&TestCfgParser::testCommands, this));
+        register_test("commands_after_slow",
+                      std::bind(&TestCfgParser::testCommandsAfterSlow, this));
+        register_test("hash",
+                      std::bind(&TestCfgParser::testHash, this));
+    }
+
+    /**
+     * Parse source and return the tree as a string with line numbers.
+     */
+    std::string parseTree(CfgParserSource *source) {
+        clear();
+        parse(source);
+        std::ostringstream os;
+        formatTree(os, getEntryRoot());
+        return os.str();
+    }
+
+    static void formatTree(std::ostream &os, CfgParser::Entry *section) {
+        for (auto it : *section) {
+            os << it->getLine() << " " << it->getName()
+               << "=" << it->getValue() << "\n";
+            if (it->getSection()) {
+                os << "{\n";
+                formatTree(os, it->getSection());
+                os << "}\n";
+            }
+        }
     }
 
     void testEmptyVal(void) {
@@ -45,4 +120,211 @@ public:
         ASSERT_EQUAL("parse ok", true, parse(source));
         ASSERT_EQUAL("var in include", "value", getVar("$VAR"));
     }
+
+    void testEntryWithoutNewline(void) {
+        auto cfg = "Key = \"value\"";
+        auto source = new CfgParserSourceString(":memory:", cfg);
+
+        clear();
+        ASSERT_EQUAL("parse ok", true, parse(source));
+        auto entry = getEntryRoot()->findEntry("KEY");
+        ASSERT_EQUAL("entry", true, entry != nullptr);
+        ASSERT_EQUAL("value", "value", entry->getValue());
+    }
+
+    /**
+     * Verify that the parsed tree, including line numbers, does not
+     * depend on how the source data is split into blocks.
+     */
+    void testBlocks(void) {
+        std::string cfg =
+            "$VAR = \"x y\"\n"
+            "# comment\n"
+            "Section = \"a\" // trailing\n"
+            "{\n"
+            "  Key = \"val\\\"ue \\\ncontinued\"; Other = \"$VAR\"\n"
+            "  /* multi\n"
+            "   line **/ Path = \"/usr/bin/a/b\" // c\n"
+            "  a/b = \"slash\"\n"
+            "  Empty = \"\"\n"
+            "  Sub {\n"
+            "    Deep = \"1\" }\n"
+            "}\n"
+            "Define = \"Tmpl\" { Inner = \"t\" }\n"
+            "Use { @Tmpl\n"
+            "Extra = \"e\" }\n";
+
+        std::string expected =
+            "3 Section=a\n"
+            "{\n"
+            "5 Key=val\"ue continued\n"
+            "6 Other=x y\n"
+            "8 Path=/usr/bin/a/b\n"
+            "9 a/b=slash\n"
+            "10 Empty=\n"
+            "10 Sub=\n"
+            "{\n"
+            "11 Deep=1\n"
+            "}\n"
+            "}\n"
+            "14 Use=\n"
+            "{\n"
+            "13 Inner=t\n"
+            "15 Extra=e\n"
+            "}\n";
+
+        ASSERT_EQUAL("string", expected,
+                     parseTree(new CfgParserSourceString(":memory:", cfg)));
+        for (size_t block_size = 1; block_size < 8; block_size++) {
+            ASSERT_EQUAL("blocks " + std::to_string(block_size), expected,
+                         parseTree(new CfgParserSourceBlocks(cfg,
+                                                             block_size)));
+        }
+    }
+
+    /**
+     * Lookups in sections large enough to be indexed must find the
+     * first matching entry, also for entries added after the index
+     * was built.
+     */
+    void testLookup(void) {
+        std::string cfg;
+        for (int i = 0; i < 20; i++) {
+            cfg += "Key" + std::to_string(i % 5) + " = \"" + std::to_string(i)
+                + "\"\n";
+            cfg += "Section = \"" + std::to_string(i) + "\" { }\n";
+        }
+
+        clear();
+        parse(new CfgParserSourceString(":memory:", cfg));
+        auto root = getEntryRoot();
+        ASSERT_EQUAL("entry", "3", root->findEntry("KEY3")->getValue());
+        ASSERT_EQUAL("entry case", "3", root->findEntry("key3")->getValue());
+        ASSERT_EQUAL("entry missing", true, root->findEntry("KEY5") == nullptr);
+        ASSERT_EQUAL("entry no section", true,
+                     root->findEntry("SECTION") == nullptr);
+        ASSERT_EQUAL("entry section", "7",
+                     root->findEntry("SECTION", true, "7")->getValue());
+        ASSERT_EQUAL("section", "0", root->findSection("SECTION")->getValue());
+        ASSERT_EQUAL("section value", "12",
+                     root->findSection("SECTION", "12")->getValue());
+        ASSERT_EQUAL("stats index", 1u, getStats().index_builds);
+
+        root->addEntry(":memory:", 0, "Added", "added");
+        ASSERT_EQUAL("added", "added", root->findEntry("ADDED")->getValue());
+        root->addEntry(":memory:", 0, "Key0", "overwritten", nullptr, true);
+        ASSERT_EQUAL("overwrite", "overwritten",
+                     root->findEntry("KEY0")->getValue());
+        ASSERT_EQUAL("overwrite second", "5",
+                     root->findEntry("KEY0", false, "5")->getValue());
+    }
+
+    void testOverwrite(void) {
+        auto cfg =
+            "Define = \"Tmpl\" { Key = \"t\" }\n"
+            "Section { Key = \"1\"; Other = \"o\" }\n"
+            "Section { Key = \"2\"; @Tmpl }\n";
+
+        clear();
+        parse(new CfgParserSourceString(":memory:", cfg), true);
+        auto section = getEntryRoot()->findSection("SECTION");
+        ASSERT_EQUAL("section", true, section != nullptr);
+        ASSERT_EQUAL("key", "t", section->findEntry("KEY")->getValue());
+        ASSERT_EQUAL("other", "o", section->findEntry("OTHER")->getValue());
+
+        std::ostringstream os;
+        formatTree(os, getEntryRoot());
+        ASSERT_EQUAL("tree", "1 Section=\n{\n1 Key=t\n1 Other=o\n}\n",
+                     os.str());
+    }
+
+    /**
+     * The first command waits for the second to have run, only
+     * finishing as concurrent if the commands run in parallel.
+     */
+    void testCommands(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        setenv("TEST_CFG_COMMAND_DIR", tmp.path().c_str(), 1);
+        unsetenv("TEST_CFG_COMMAND");
+
+        clear();
+        ASSERT_EQUAL("parse", true,
+                     parse("../test/data/cfg_parser_commands.cfg"));
+
+        std::ostringstream os;
+        formatTree(os, getEntryRoot());
+        ASSERT_EQUAL("tree",
+                     "1 First=concurrent\n"
+                     "3 Between=b\n"
+                     "3 Section=\n"
+                     "{\n"
+                     "1 Second=2\n"
+                     "}\n"
+                     "1 Var=var\n"
+                     "1 Env=set\n",
+                     os.str());
+
+        std::ifstream runs(tmp.path() + "/second");
+        std::string data((std::istreambuf_iterator<char>(runs)),
+                         std::istreambuf_iterator<char>());
+        ASSERT_EQUAL("run once", "run\n", data);
+        unsetenv("TEST_CFG_COMMAND");
+        unsetenv("TEST_CFG_COMMAND_DIR");
+    }
+
+    /**
+     * Output of a started command is used even if its entry is
+     * reached after the timeout, the timeout counts from when the
+     * entry is reached.
+     */
+    void testCommandsAfterSlow(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        auto path =
+            tmp.writeFile("slow.cfg",
+                          "$V = \"v\"\n"
+                          "COMMAND = \"sleep 1; echo 'Slow = \\\"$V\\\"'\"\n"
+                          "COMMAND = \"echo 'Fast = \\\"1\\\"'\"\n");
+
+        CfgParserCommands::setTimeout(500);
+        clear();
+        ASSERT_EQUAL("parse", true, parse(path));
+        CfgParserCommands::setTimeout(CFG_PARSER_COMMAND_TIMEOUT_MS);
+
+        std::ostringstream os;
+        formatTree(os, getEntryRoot());
+        ASSERT_EQUAL("tree", "1 Slow=v\n1 Fast=1\n", os.str());
+    }
+
+    uint64_t parseHash(const std::string &cfg) {
+        clear();
+        parse(new CfgParserSourceString(":memory:", cfg));
+        return getEntryRoot()->getHash();
+    }
+
+    /**
+     * Hash only changes with the content, not with formatting.
+     */
+    void testHash(void) {
+        auto hash = parseHash("Section = \"s\" { Key = \"v\" }\n"
+                              "Other = \"o\"\n");
+        ASSERT_EQUAL("formatting", hash,
+                     parseHash("# comment\n"
+                               "Section = \"s\" {\n"
+                               "  Key = \"v\"\n"
+                               "}\n"
+                               "Other = \"o\""));
+        ASSERT_EQUAL("value", true,
+                     hash != parseHash("Section = \"s\" { Key = \"x\" }\n"
+                                       "Other = \"o\"\n"));
+        ASSERT_EQUAL("order", true,
+                     hash != parseHash("Other = \"o\"\n"
+                                       "Section = \"s\" { Key = \"v\" }\n"));
+        ASSERT_EQUAL("nesting", true,
+                     hash != parseHash("Section = \"s\" { }\n"
+                                       "Key = \"v\"\nOther = \"o\"\n"));
+        ASSERT_EQUAL("name value boundary", true,
+                     parseHash("Key = \"ab\"\n") != parseHash("Keya = \"b\"\n"));
+    }
 };
@@ -0,0 +1,172 @@
+//
+// test_CfgParserCache.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "CfgParserCache.hh"
+
+#include <sstream>
+
+extern "C" {
+#include <stdlib.h>
+#include <sys/stat.h>
+}
+
+/**
+ * String source with dynamic content, as from a COMMAND.
+ */
+class CfgParserSourceDynamic : public CfgParserSourceString {
+public:
+    CfgParserSourceDynamic(const std::string &data)
+        : CfgParserSourceString(":dynamic:", data)
+    {
+        _is_dynamic = true;
+    }
+};
+
+class TestCfgParserCache : public TestSuite {
+public:
+    TestCfgParserCache()
+        : TestSuite("CfgParserCache")
+    {
+        register_test("saveLoad", TestCfgParserCache::testSaveLoad);
+        register_test("dynamic", TestCfgParserCache::testDynamic);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        register_test("subSecond", TestCfgParserCache::testSubSecond);
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+    }
+
+    static void testSaveLoad(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        auto dir = tmp.path();
+        mkdir((dir + "/cache").c_str(), 0700);
+        CfgParserCache::setDir(dir + "/cache");
+
+        tmp.writeFile("include", "$VAR = \"v\"\n");
+        auto file = tmp.writeFile("main",
+                                  "$_TEST_CFG_CACHE_DEFINED = \"d\"\n"
+                                  "INCLUDE = \"" + dir + "/include\"\n"
+                                  "INCLUDE = \"" + dir + "/missing\"\n"
+                                  "Section = \"s\" {\n"
+                                  "  Key = \"$VAR $_TEST_CFG_CACHE_DEFINED "
+                                  "$_TEST_CFG_CACHE_ENV\"\n"
+                                  "}\n");
+        setenv("TEST_CFG_CACHE_ENV", "e", 1);
+
+        CfgParser cfg;
+        ASSERT_EQUAL("parse", true, cfg.parse(file));
+        ASSERT_EQUAL("exists", false, CfgParserCache::exists(file, false));
+        ASSERT_EQUAL("save", true, CfgParserCache::save(cfg, file, false));
+        ASSERT_EQUAL("exists", true, CfgParserCache::exists(file, false));
+        ASSERT_EQUAL("exists", false, CfgParserCache::exists(file, true));
+        auto tree = formatTree(cfg.getEntryRoot());
+
+        unsetenv("TEST_CFG_CACHE_DEFINED");
+        CfgParser cached;
+        ASSERT_EQUAL("load", true, CfgParserCache::load(cached, file, false));
+        ASSERT_EQUAL("tree", tree, formatTree(cached.getEntryRoot()));
+        ASSERT_EQUAL("var", "v", cached.getVar("$VAR"));
+        ASSERT_EQUAL("env", "d", Util::getEnv("TEST_CFG_CACHE_DEFINED"));
+        ASSERT_EQUAL("files", 2, cached.getCfgFiles().files.size());
+        ASSERT_EQUAL("overwrite", false, loads(file, true));
+
+        // variables set before parsing must match
+        CfgParser with_var;
+        with_var.setVar("$VAR", "x");
+        ASSERT_EQUAL("var set", false,
+                     CfgParserCache::load(with_var, file, false));
+
+        // expanded environment
+        setenv("TEST_CFG_CACHE_ENV", "changed", 1);
+        ASSERT_EQUAL("env changed", false, loads(file, false));
+        setenv("TEST_CFG_CACHE_ENV", "e", 1);
+        ASSERT_EQUAL("env restored", true, loads(file, false));
+
+        // included file that did not exist
+        tmp.writeFile("missing", "");
+        ASSERT_EQUAL("missing created", false, loads(file, false));
+        unlink((dir + "/missing").c_str());
+        ASSERT_EQUAL("missing removed", true, loads(file, false));
+
+        // included file
+        tmp.writeFile("include", "$VAR = \"changed\"\n");
+        ASSERT_EQUAL("include changed", false, loads(file, false));
+
+        // stale trees are refreshed when parsing
+        CfgParser refresh;
+        ASSERT_EQUAL("refresh", true, refresh.parse(file));
+        ASSERT_EQUAL("refreshed", true, loads(file, false));
+        CfgParser refreshed;
+        refreshed.parse(file);
+        ASSERT_EQUAL("refreshed var", "changed", refreshed.getVar("$VAR"));
+
+        CfgParserCache::setDir("");
+        unsetenv("TEST_CFG_CACHE_ENV");
+        unsetenv("TEST_CFG_CACHE_DEFINED");
+    }
+
+    static void testDynamic(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        CfgParserCache::setDir(tmp.path());
+
+        auto file = tmp.path() + "/main";
+        CfgParser cfg;
+        ASSERT_EQUAL("parse", true,
+                     cfg.parse(new CfgParserSourceDynamic("Key = \"v\"\n")));
+        ASSERT_EQUAL("dynamic", true, cfg.isDynamicContent());
+        ASSERT_EQUAL("save", false, CfgParserCache::save(cfg, file, false));
+        ASSERT_EQUAL("exists", false, CfgParserCache::exists(file, false));
+
+        CfgParserCache::setDir("");
+    }
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    /**
+     * A file changed within the same second, keeping its size, makes
+     * the tree stale.
+     */
+    static void testSubSecond(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        CfgParserCache::setDir(tmp.path());
+
+        auto file = tmp.writeFile("main", "Key = \"a\"\n");
+        struct timeval times[2] = {{1000, 100}, {1000, 100}};
+        utimes(file.c_str(), times);
+
+        CfgParser cfg;
+        ASSERT_EQUAL("parse", true, cfg.parse(file));
+        ASSERT_EQUAL("save", true, CfgParserCache::save(cfg, file, false));
+        ASSERT_EQUAL("loads", true, loads(file, false));
+
+        tmp.writeFile("main", "Key = \"b\"\n");
+        times[0].tv_usec = times[1].tv_usec = 200;
+        utimes(file.c_str(), times);
+        ASSERT_EQUAL("changed", false, loads(file, false));
+
+        CfgParserCache::setDir("");
+    }
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+
+    static bool loads(const std::string &file, bool overwrite) {
+        CfgParser cfg;
+        return CfgParserCache::load(cfg, file, overwrite);
+    }
+
+    static std::string formatTree(CfgParser::Entry *section) {
+        std::ostringstream os;
+        for (auto it : *section) {
+            os << *it << "\n";
+            if (it->getSection()) {
+                os << "{\n" << formatTree(it->getSection()) << "}\n";
+            }
+        }
+        return os.str();
+    }
+};
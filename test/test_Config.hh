@@ -2,6 +2,10 @@
 #include "Config.hh"
 #include "Action.hh"
 
+extern "C" {
+#include <stdlib.h>
+}
+
 class TestConfig : public TestSuite,
                    public Config {
 public:
@@ -12,6 +16,8 @@ public:
         register_test("parseMoveResizeAction",
                       std::bind(&TestConfig::testParseMoveResizeAction,
                                 this));
+        register_test("reloadUnchanged",
+                      std::bind(&TestConfig::testReloadUnchanged, this));
     }
 
     void testParseMoveResizeAction(void) {
@@ -25,4 +31,41 @@ public:
         ASSERT_EQUAL("parsed value", -3, action.getParamI(0));
         ASSERT_EQUAL("parsed unit", UNIT_PERCENT, action.getParamI(1));
     }
+
+    /**
+     * Files with updated modification time but unchanged content are
+     * not re-applied, changed sections are reported.
+     */
+    void testReloadUnchanged(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        time_t now = time(nullptr);
+
+        auto file = tmp.writeFile("config",
+                                  "Screen { Workspaces = \"3\" }\n"
+                                  "Harbour { OnTop = \"True\" }\n",
+                                  now - 100);
+        ASSERT_EQUAL("load", true, load(file));
+        ASSERT_EQUAL("load screen", true, isChanged("SCREEN"));
+        ASSERT_EQUAL("load workspaces", 3, getWorkspaces());
+
+        tmp.writeFile("config",
+                      "# comment\n"
+                      "Screen {\n  Workspaces = \"3\"\n}\n"
+                      "Harbour { OnTop = \"True\" }\n",
+                      now - 50);
+        ASSERT_EQUAL("unchanged", false, load(file));
+        ASSERT_EQUAL("unchanged screen", false, isChanged("SCREEN"));
+
+        tmp.writeFile("config",
+                      "Screen { Workspaces = \"3\" }\n"
+                      "Harbour { OnTop = \"False\" }\n",
+                      now - 10);
+        ASSERT_EQUAL("changed", true, load(file));
+        ASSERT_EQUAL("changed screen", false, isChanged("SCREEN"));
+        ASSERT_EQUAL("changed harbour", true, isChanged("HARBOUR"));
+        ASSERT_EQUAL("changed ontop", false, isHarbourOntop());
+
+        unsetenv("PEKWM_CONFIG_FILE");
+    }
 };
@@ -0,0 +1,168 @@
+//
+// test_ImageDiskCache.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "ImageDiskCache.hh"
+
+#include <cstring>
+
+class TestImageDiskCache : public TestSuite {
+public:
+    TestImageDiskCache()
+        : TestSuite("ImageDiskCache")
+    {
+        register_test("disabled", TestImageDiskCache::testDisabled);
+        register_test("saveLoad", TestImageDiskCache::testSaveLoad);
+        register_test("prune", TestImageDiskCache::testPrune);
+    }
+
+    static void testDisabled(void) {
+        ImageDiskCache cache;
+        ASSERT_EQUAL("enabled", false, cache.isEnabled());
+
+        ImageDiskCache::Source source;
+        source.path = "/nonexisting.png";
+        uchar data[4] = {1, 2, 3, 4};
+        cache.save(source, false, data, 1, 1, false);
+
+        uint width = 0, height = 0;
+        bool use_alpha;
+        ASSERT_EQUAL("load", true,
+                     cache.load(source, width, height, use_alpha) == nullptr);
+        ASSERT_EQUAL("stats", 0, cache.getStats().writes);
+    }
+
+    static void testSaveLoad(void) {
+        TestDir dir;
+        ASSERT_EQUAL("mkdtemp", false, dir.path().empty());
+
+        ImageDiskCache cache;
+        ASSERT_EQUAL("setDir", true,
+                     cache.setDir(dir.path() + "/pekwm/images"));
+
+        ImageDiskCache::Source source;
+        source.path = "/themes/test/image.png";
+        source.mtime = 1;
+        source.size = 2;
+
+        uchar data[2 * 2 * 4];
+        for (uint i = 0; i < sizeof(data); i++) {
+            data[i] = i;
+        }
+        cache.save(source, false, data, 2, 2, true);
+        ASSERT_EQUAL("save", 1, cache.getStats().writes);
+
+        // decoded image
+        uint width = 0, height = 0;
+        bool use_alpha = false;
+        uchar *loaded = cache.load(source, width, height, use_alpha);
+        ASSERT_EQUAL("load", true, loaded != nullptr);
+        ASSERT_EQUAL("load", 2, width);
+        ASSERT_EQUAL("load", 2, height);
+        ASSERT_EQUAL("load", true, use_alpha);
+        ASSERT_EQUAL("load", 0, memcmp(data, loaded, sizeof(data)));
+        delete [] loaded;
+
+        // scaled image not in cache
+        width = 4;
+        height = 4;
+        ASSERT_EQUAL("scaled", true,
+                     cache.load(source, width, height, use_alpha) == nullptr);
+
+        // source changed within the same second
+        source.mtime_nsec = 3;
+        width = height = 0;
+        ASSERT_EQUAL("changed nsec", true,
+                     cache.load(source, width, height, use_alpha) == nullptr);
+        source.mtime_nsec = 0;
+
+        // changed source
+        source.mtime = 2;
+        width = height = 0;
+        ASSERT_EQUAL("changed", true,
+                     cache.load(source, width, height, use_alpha) == nullptr);
+        ASSERT_EQUAL("stats", 1, cache.getStats().hits);
+        ASSERT_EQUAL("stats", 3, cache.getStats().misses);
+    }
+
+    /**
+     * Call fun with the path and stat of all files in dir.
+     */
+    template<typename Fun>
+    static void forEachFile(const std::string &dir, Fun fun) {
+        DIR *dh = opendir(dir.c_str());
+        if (dh == nullptr) {
+            return;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dh)) != nullptr) {
+            std::string path = dir + "/" + entry->d_name;
+            struct stat stat_buf;
+            if (! stat(path.c_str(), &stat_buf)
+                && S_ISREG(stat_buf.st_mode)) {
+                fun(path, stat_buf);
+            }
+        }
+        closedir(dh);
+    }
+
+    static uint64_t dirSize(const std::string &dir) {
+        uint64_t size = 0;
+        forEachFile(dir, [&size](const std::string&, struct stat &stat_buf) {
+                size += stat_buf.st_size;
+            });
+        return size;
+    }
+
+    static bool isCached(ImageDiskCache &cache,
+                         const ImageDiskCache::Source &source) {
+        uint width = 0, height = 0;
+        bool use_alpha;
+        uchar *data = cache.load(source, width, height, use_alpha);
+        delete [] data;
+        return data != nullptr;
+    }
+
+    /**
+     * Least recently loaded, or saved, entries are removed when the
+     * cache exceeds its max size.
+     */
+    static void testPrune(void) {
+        TestDir dir;
+        ASSERT_EQUAL("mkdtemp", false, dir.path().empty());
+
+        ImageDiskCache cache;
+        ASSERT_EQUAL("setDir", true, cache.setDir(dir.path()));
+
+        uchar data[2 * 2 * 4] = {0};
+        ImageDiskCache::Source a, b, c;
+        a.path = "/a.png";
+        b.path = "/b.png";
+        c.path = "/c.png";
+
+        cache.save(a, false, data, 2, 2, false);
+        uint64_t entry_size = dirSize(dir.path());
+        ASSERT_EQUAL("entry", true, entry_size > sizeof(data));
+        cache.setMaxSize(entry_size * 2);
+        cache.save(b, false, data, 2, 2, false);
+
+        // make a and b old, loading a makes it recently used
+        forEachFile(dir.path(), [](const std::string &path, struct stat&) {
+                struct timeval times[2] = {{1000, 0}, {1000, 0}};
+                utimes(path.c_str(), times);
+            });
+        ASSERT_EQUAL("load a", true, isCached(cache, a));
+
+        cache.save(c, false, data, 2, 2, false);
+        ASSERT_EQUAL("size", entry_size * 2, dirSize(dir.path()));
+        ASSERT_EQUAL("prunes", 1, cache.getStats().prunes);
+        ASSERT_EQUAL("a", true, isCached(cache, a));
+        ASSERT_EQUAL("b", false, isCached(cache, b));
+        ASSERT_EQUAL("c", true, isCached(cache, c));
+    }
+};
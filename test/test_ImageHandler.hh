@@ -0,0 +1,166 @@
+//
+// test_ImageHandler.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "ImageHandler.hh"
+
+#include <fstream>
+#include <sstream>
+
+class TestImageHandler : public TestSuite {
+public:
+    TestImageHandler()
+        : TestSuite("ImageHandler")
+    {
+        register_test("reuseUnused", TestImageHandler::testReuseUnused);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        register_test("changedFile", TestImageHandler::testChangedFile);
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+        register_test("mapped", TestImageHandler::testMapped);
+        register_test("cacheSize", TestImageHandler::testCacheSize);
+        register_test("prefetch", TestImageHandler::testPrefetch);
+    }
+
+    static void testReuseUnused(void) {
+        ImageHandler handler;
+        handler.path_push_back("../test/data/");
+        auto image = handler.getImage("image.png");
+        ASSERT_EQUAL("load", true, image != nullptr);
+        ASSERT_EQUAL("load", 1, handler.getStats().decodes);
+        handler.returnImage(image);
+        ASSERT_EQUAL("unused", 1, handler.getStats().unused);
+
+        // unchanged file, image without references is re-used
+        auto image2 = handler.getImage("image.png");
+        ASSERT_EQUAL("revive", image, image2);
+        ASSERT_EQUAL("revive", 1, handler.getStats().decodes);
+        ASSERT_EQUAL("revive", 1, handler.getStats().revived);
+        ASSERT_EQUAL("revive", 0, handler.getStats().unused);
+        handler.returnImage(image2);
+    }
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    /**
+     * An image file changed within the same second, keeping its size,
+     * is decoded again instead of re-using the unused image.
+     */
+    static void testChangedFile(void) {
+        TestDir tmp;
+        ASSERT_EQUAL("mkdtemp", false, tmp.path().empty());
+        std::ifstream ifs("../test/data/image.png");
+        std::ostringstream data;
+        data << ifs.rdbuf();
+        auto file = tmp.writeFile("image.png", data.str());
+        struct timeval times[2] = {{1000, 100}, {1000, 100}};
+        utimes(file.c_str(), times);
+
+        ImageHandler handler;
+        auto image = handler.getImage(file);
+        ASSERT_EQUAL("load", true, image != nullptr);
+        handler.returnImage(image);
+
+        times[0].tv_usec = times[1].tv_usec = 200;
+        utimes(file.c_str(), times);
+        image = handler.getImage(file);
+        ASSERT_EQUAL("changed", true, image != nullptr);
+        ASSERT_EQUAL("changed", 2, handler.getStats().decodes);
+        ASSERT_EQUAL("changed", 0, handler.getStats().revived);
+        handler.returnImage(image);
+    }
+#endif // HAVE_STRUCT_STAT_ST_MTIM
+
+    static void testMapped(void) {
+        ImageHandler handler;
+        handler.path_push_back("../test/data/");
+        auto image = handler.getImage("image.png");
+        ASSERT_EQUAL("load", true, image != nullptr);
+        int pixel = *reinterpret_cast<int*>(image->getData());
+
+        std::map<int, int> color_map;
+        color_map[pixel] = 0;
+        handler.addColorMap("test", color_map);
+
+        // mapped image is created from the already loaded image
+        auto mapped = handler.getMappedImage("image.png",
+                                             "test");
+        ASSERT_EQUAL("mapped", true, mapped != image);
+        ASSERT_EQUAL("mapped", 1, handler.getStats().decodes);
+        ASSERT_EQUAL("mapped", 1, handler.getStats().mapped);
+        ASSERT_EQUAL("mapped", 0, *reinterpret_cast<int*>(mapped->getData()));
+        ASSERT_EQUAL("original", pixel,
+                     *reinterpret_cast<int*>(image->getData()));
+
+        handler.returnMappedImage(mapped, "test");
+        handler.returnImage(image);
+
+        // changing the color map drops the unused mapped image
+        color_map[pixel] = 1;
+        handler.addColorMap("test", color_map);
+        mapped = handler.getMappedImage("image.png", "test");
+        ASSERT_EQUAL("remapped", 1, *reinterpret_cast<int*>(mapped->getData()));
+        ASSERT_EQUAL("remapped", 1, handler.getStats().decodes);
+        ASSERT_EQUAL("remapped", 2, handler.getStats().mapped);
+        handler.returnMappedImage(mapped, "test");
+
+        // color maps are cleared and added on theme reload, an
+        // unchanged color map re-uses the unused mapped image
+        handler.clearColorMaps();
+        handler.addColorMap("test", color_map);
+        auto reused = handler.getMappedImage("image.png", "test");
+        ASSERT_EQUAL("reused", mapped, reused);
+        ASSERT_EQUAL("reused", 2, handler.getStats().mapped);
+        handler.returnMappedImage(reused, "test");
+
+        // a changed color map added after clear drops it
+        handler.clearColorMaps();
+        color_map[pixel] = 2;
+        handler.addColorMap("test", color_map);
+        auto cleared = handler.getMappedImage("image.png", "test");
+        ASSERT_EQUAL("cleared", 2, *reinterpret_cast<int*>(cleared->getData()));
+        ASSERT_EQUAL("cleared", 3, handler.getStats().mapped);
+        handler.returnMappedImage(cleared, "test");
+    }
+
+    static void testCacheSize(void) {
+        ImageHandler handler;
+        handler.path_push_back("../test/data/");
+        handler.setCacheSize(0);
+        auto image = handler.getImage("image.png");
+        ASSERT_EQUAL("load", true, image != nullptr);
+        handler.returnImage(image);
+        ASSERT_EQUAL("unused", 0, handler.getStats().unused);
+
+        image = handler.getImage("image.png");
+        ASSERT_EQUAL("reload", 2, handler.getStats().decodes);
+        ASSERT_EQUAL("reload", 0, handler.getStats().revived);
+        handler.returnImage(image);
+    }
+
+    static void testPrefetch(void) {
+        ImageHandler handler;
+        handler.path_push_back("../test/data/");
+        handler.prefetch({"image.png#SCALED", "missing.png"});
+
+        auto image = handler.getImage("image.png#SCALED");
+        ASSERT_EQUAL("load", true, image != nullptr);
+        ASSERT_EQUAL("load", 1, handler.getStats().decodes);
+        ASSERT_EQUAL("load", 1, handler.getStats().prefetched);
+        ASSERT_EQUAL("type", IMAGE_TYPE_SCALED, image->getType());
+        handler.prefetchDone();
+
+        // loaded images are not prefetched again
+        handler.prefetch({"image.png"});
+        auto image2 = handler.getImage("image.png");
+        ASSERT_EQUAL("cached", image, image2);
+        ASSERT_EQUAL("cached", 1, handler.getStats().prefetched);
+        handler.prefetchDone();
+
+        handler.returnImage(image2);
+        handler.returnImage(image);
+    }
+};
@@ -0,0 +1,153 @@
+//
+// test_PFont.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "PFont.hh"
+
+/**
+ * Font without X11 resources, characters are 5 to 11 pixels wide.
+ */
+class PFontTest : public PFont {
+public:
+    PFontTest(uint offset_x)
+        : PFont(),
+          calls(0)
+    {
+        _offset_x = offset_x;
+    }
+
+    virtual uint getWidth(const std::wstring &text, uint max_chars = 0) {
+        calls++;
+        if (! max_chars || max_chars > text.size()) {
+            max_chars = text.size();
+        }
+        if (max_chars == 0) {
+            return 0;
+        }
+
+        uint width = _offset_x;
+        for (uint i = 0; i < max_chars; i++) {
+            width += 5 + text[i] % 7;
+        }
+        return width;
+    }
+
+    uint calls;
+};
+
+class TestPFont : public TestSuite {
+public:
+    TestPFont()
+        : TestSuite("PFont")
+    {
+        register_test("trimEnd", TestPFont::testTrimEnd);
+        register_test("trimMiddle", TestPFont::testTrimMiddle);
+    }
+
+    static void testTrimEnd(void) {
+        std::wstring text(L"Long title of a web page - Web Browser");
+        for (uint offset = 0; offset < 3; offset++) {
+            PFontTest font(offset);
+            for (uint max_width = 0; max_width < 320; max_width++) {
+                std::wstring expected(text), trimmed(text);
+                trimEndLinear(font, expected, max_width);
+                font.trimEnd(trimmed, max_width);
+                ASSERT_EQUAL("trimEnd " + std::to_string(max_width),
+                             expected.size(), trimmed.size());
+                ASSERT_EQUAL("trimEnd " + std::to_string(max_width),
+                             true, expected == trimmed);
+            }
+        }
+
+        // character widths are cached
+        PFontTest font(0);
+        std::wstring trimmed(text);
+        font.trimEnd(trimmed, 100);
+        font.calls = 0;
+        trimmed = text;
+        font.trimEnd(trimmed, 100);
+        ASSERT_EQUAL("cached", 1, font.calls);
+    }
+
+    static void testTrimMiddle(void) {
+        PFont::setTrimString("...");
+        std::wstring text(L"Long title of a web page - Web Browser");
+        for (uint offset = 0; offset < 3; offset++) {
+            PFontTest font(offset);
+            for (uint max_width = 0; max_width < 320; max_width++) {
+                std::wstring expected(text), trimmed(text);
+                trimMiddleLinear(font, expected, max_width);
+                font.trimMiddle(trimmed, max_width);
+                ASSERT_EQUAL("trimMiddle " + std::to_string(max_width),
+                             expected.size(), trimmed.size());
+                ASSERT_EQUAL("trimMiddle " + std::to_string(max_width),
+                             true, expected == trimmed);
+            }
+        }
+        PFont::setTrimString("");
+    }
+
+    /**
+     * Reference implementation, shortens the text one character at a
+     * time.
+     */
+    static void trimEndLinear(PFont &font, std::wstring &text,
+                              uint max_width) {
+        for (uint i = text.size(); i > 0; --i) {
+            if (font.getWidth(text, i) <= max_width) {
+                text = text.substr(0, i);
+                break;
+            }
+        }
+    }
+
+    /**
+     * Reference implementation, shortens both halves one character at
+     * a time.
+     */
+    static void trimMiddleLinear(PFont &font, std::wstring &text,
+                                 uint max_width) {
+        std::wstring trim_string(L"...");
+        uint max_side = (max_width / 2);
+        uint sep_width = font.getWidth(trim_string.c_str(),
+                                       trim_string.size() / 2
+                                       + trim_string.size() % 2);
+        if (max_side <= sep_width) {
+            return;
+        }
+        max_side -= sep_width;
+
+        uint pos = 0;
+        std::wstring dest;
+        for (uint i = text.size(); i > 0; --i) {
+            if (font.getWidth(text, i) < max_side) {
+                pos = i;
+                dest.insert(0, text.substr(0, i));
+                break;
+            }
+        }
+
+        if (pos < text.size()) {
+            for (uint i = pos; i < text.size(); ++i) {
+                std::wstring second_part(text.substr(i, text.size() - i));
+                if (font.getWidth(second_part, 0) < max_side) {
+                    dest.insert(dest.size(), second_part);
+                    break;
+                }
+            }
+
+            if (dest.size() > 1) {
+                if ((font.getWidth(dest) + font.getWidth(trim_string))
+                    < max_width) {
+                    dest.insert(pos, trim_string);
+                }
+                text = dest;
+            }
+        }
+    }
+};
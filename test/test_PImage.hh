@@ -0,0 +1,185 @@
+//
+// test_PImage.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "PImage.hh"
+
+#include <cstdlib>
+#include <vector>
+
+class TestPImage : public TestSuite {
+public:
+    TestPImage()
+        : TestSuite("PImage")
+    {
+        register_test("scaleBilinear", TestPImage::testScaleBilinear);
+        register_test("scaleArea", TestPImage::testScaleArea);
+        register_test("scaleSinglePixel", TestPImage::testScaleSinglePixel);
+        register_test("drawAlphaFixed32", TestPImage::testDrawAlphaFixed32);
+        register_test("drawAlphaFixed16", TestPImage::testDrawAlphaFixed16);
+    }
+
+    static void initImage(XImage &ximage, char *data, uint width,
+                          int depth, int bpp) {
+        static const uint16_t one = 1;
+        memset(&ximage, 0, sizeof(ximage));
+        ximage.width = width;
+        ximage.height = 1;
+        ximage.format = ZPixmap;
+        ximage.data = data;
+        ximage.byte_order =
+            *reinterpret_cast<const uchar*>(&one) == 1 ? LSBFirst : MSBFirst;
+        ximage.bitmap_unit = 32;
+        ximage.bitmap_bit_order = ximage.byte_order;
+        ximage.bitmap_pad = 32;
+        ximage.depth = depth;
+        ximage.bits_per_pixel = bpp;
+        ximage.bytes_per_line = width * bpp / 8;
+        if (depth == 24) {
+            ximage.red_mask = 0xff0000;
+            ximage.green_mask = 0xff00;
+            ximage.blue_mask = 0xff;
+        } else {
+            ximage.red_mask = 0xf800;
+            ximage.green_mask = 0x07e0;
+            ximage.blue_mask = 0x1f;
+        }
+        XInitImage(&ximage);
+    }
+
+    static std::vector<uchar> image(uint width, uint height) {
+        std::vector<uchar> data(width * height * 4);
+        for (uint i = 0; i < data.size(); i++) {
+            data[i] = static_cast<uchar>((i * 7919) >> 3);
+        }
+        return data;
+    }
+
+    /**
+     * Floating point scaler the fixed point scaler replaced, per
+     * channel and pixel.
+     */
+    static void scaleReference(const uchar *src, uint width, uint height,
+                               uchar *dst, uint dwidth, uint dheight) {
+        float x_ratio = static_cast<float>(width - 1) / dwidth;
+        float y_ratio = static_cast<float>(height - 1) / dheight;
+        for (uint dy = 0; dy < dheight; dy++) {
+            for (uint dx = 0; dx < dwidth; dx++) {
+                uint sx = static_cast<uint>(x_ratio * dx);
+                uint sy = static_cast<uint>(y_ratio * dy);
+                float x_diff = (x_ratio * dx) - sx;
+                float y_diff = (y_ratio * dy) - sy;
+                for (uint c = 0; c < 4; c++) {
+                    const uchar *p = src + (sy * width + sx) * 4 + c;
+                    float res = p[0] * (1 - x_diff) * (1 - y_diff)
+                        + p[4] * x_diff * (1 - y_diff)
+                        + p[width * 4] * y_diff * (1 - x_diff)
+                        + p[width * 4 + 4] * x_diff * y_diff;
+                    *dst++ = static_cast<uchar>(res);
+                }
+            }
+        }
+    }
+
+    static void testScaleBilinear(void) {
+        uint sizes[][4] = {{16, 16, 40, 40}, {31, 17, 64, 20},
+                           {100, 60, 70, 50}, {8, 8, 9, 13}};
+        for (auto &size : sizes) {
+            auto src = image(size[0], size[1]);
+            std::vector<uchar> ref(size[2] * size[3] * 4);
+            std::vector<uchar> dst(ref.size());
+            scaleReference(src.data(), size[0], size[1],
+                           ref.data(), size[2], size[3]);
+            PImage::scaleData(src.data(), size[0], size[1],
+                              dst.data(), size[2], size[3]);
+
+            // fixed point weights round differently, allow off by two
+            int max_diff = 0;
+            for (uint i = 0; i < ref.size(); i++) {
+                max_diff = std::max(max_diff, std::abs(ref[i] - dst[i]));
+            }
+            ASSERT_EQUAL("max diff", true, max_diff <= 2);
+        }
+    }
+
+    static void testScaleArea(void) {
+        // 4x2 to 2x1, each destination pixel the average of 2x2
+        uchar src[] = {255, 0, 0, 0,   255, 100, 0, 0,
+                       255, 10, 20, 30, 255, 30, 40, 50,
+                       255, 0, 0, 0,   255, 50, 0, 0,
+                       255, 10, 20, 30, 255, 50, 60, 70};
+        uchar dst[8];
+        PImage::scaleData(src, 4, 2, dst, 2, 1);
+        ASSERT_EQUAL("A", 255, dst[0]);
+        ASSERT_EQUAL("R", 38, dst[1]);
+        ASSERT_EQUAL("G", 0, dst[2]);
+        ASSERT_EQUAL("B", 0, dst[3]);
+        ASSERT_EQUAL("A", 255, dst[4]);
+        ASSERT_EQUAL("R", 25, dst[5]);
+        ASSERT_EQUAL("G", 35, dst[6]);
+        ASSERT_EQUAL("B", 45, dst[7]);
+
+        // uniform color stays the same regardless of size
+        std::vector<uchar> uniform(97 * 53 * 4);
+        for (uint i = 0; i < uniform.size(); i += 4) {
+            uniform[i] = 200;
+            uniform[i + 1] = 10;
+            uniform[i + 2] = 20;
+            uniform[i + 3] = 30;
+        }
+        std::vector<uchar> small(13 * 7 * 4);
+        PImage::scaleData(uniform.data(), 97, 53, small.data(), 13, 7);
+        for (uint i = 0; i < small.size(); i += 4) {
+            ASSERT_EQUAL("uniform", 200, small[i]);
+            ASSERT_EQUAL("uniform", 10, small[i + 1]);
+            ASSERT_EQUAL("uniform", 20, small[i + 2]);
+            ASSERT_EQUAL("uniform", 30, small[i + 3]);
+        }
+    }
+
+    static void testScaleSinglePixel(void) {
+        // no neighbours to read outside of the image
+        uchar src[] = {255, 1, 2, 3};
+        std::vector<uchar> dst(5 * 3 * 4);
+        PImage::scaleData(src, 1, 1, dst.data(), 5, 3);
+        for (uint i = 0; i < dst.size(); i += 4) {
+            ASSERT_EQUAL("pixel", 255, dst[i]);
+            ASSERT_EQUAL("pixel", 1, dst[i + 1]);
+            ASSERT_EQUAL("pixel", 2, dst[i + 2]);
+            ASSERT_EQUAL("pixel", 3, dst[i + 3]);
+        }
+    }
+
+    static void testDrawAlphaFixed32(void) {
+        uint32_t pixels[] = {0x102030, 0x102030, 0x102030};
+        XImage ximage;
+        initImage(ximage, reinterpret_cast<char*>(pixels), 3, 24, 32);
+
+        uchar data[] = {255, 0xff, 0x80, 0x00,
+                        0, 0xff, 0xff, 0xff,
+                        128, 0xf0, 0xe0, 0xd0};
+        PImage::drawAlphaFixed(&ximage, &ximage, 0, 0, 3, 1, data);
+        ASSERT_EQUAL("opaque", 0xff8000, XGetPixel(&ximage, 0, 0));
+        ASSERT_EQUAL("transparent", 0x102030, XGetPixel(&ximage, 1, 0));
+        // (0xf0 * 128 + 0x10 * 127) / 255 = 0x80, same for G and B
+        ASSERT_EQUAL("blend", 0x808080, XGetPixel(&ximage, 2, 0));
+    }
+
+    static void testDrawAlphaFixed16(void) {
+        uint16_t pixels[] = {0xffff, 0x0000};
+        XImage ximage;
+        initImage(ximage, reinterpret_cast<char*>(pixels), 2, 16, 16);
+
+        uchar data[] = {0, 0x00, 0x00, 0x00,
+                        128, 0xff, 0xff, 0xff};
+        PImage::drawAlphaFixed(&ximage, &ximage, 0, 0, 2, 1, data);
+        ASSERT_EQUAL("transparent", 0xffff, XGetPixel(&ximage, 0, 0));
+        // 0xff * 128 / 255 = 0x80, 5 bits 0x10 6 bits 0x20
+        ASSERT_EQUAL("blend", 0x8410, XGetPixel(&ximage, 1, 0));
+    }
+};
@@ -0,0 +1,71 @@
+//
+// test_Reactor.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "Reactor.hh"
+
+extern "C" {
+#include <signal.h>
+#include <unistd.h>
+}
+
+class TestReactor : public TestSuite {
+public:
+    TestReactor()
+        : TestSuite("Reactor")
+    {
+        register_test("fd", TestReactor::testFd);
+        register_test("timer", TestReactor::testTimer);
+        register_test("signal", TestReactor::testSignal);
+    }
+
+    static void testFd(void) {
+        Reactor reactor;
+        int fd[2];
+        ASSERT_EQUAL("pipe", 0, pipe(fd));
+        reactor.addFd(fd[0]);
+
+        std::vector<Reactor::Event> events;
+        ASSERT_EQUAL("timeout", false, reactor.wait(events, 0));
+
+        ASSERT_EQUAL("write", 1, write(fd[1], "x", 1));
+        ASSERT_EQUAL("ready", true, reactor.wait(events, 0));
+        ASSERT_EQUAL("events", 1, events.size());
+        ASSERT_EQUAL("type", Reactor::EVENT_FD, events[0].type);
+        ASSERT_EQUAL("fd", fd[0], events[0].value);
+
+        reactor.removeFd(fd[0]);
+        ASSERT_EQUAL("removed", false, reactor.wait(events, 0));
+
+        close(fd[0]);
+        close(fd[1]);
+    }
+
+    static void testTimer(void) {
+        Reactor reactor;
+        int id = reactor.addTimer(10, false);
+
+        std::vector<Reactor::Event> events;
+        ASSERT_EQUAL("not expired", false, reactor.wait(events, 0));
+        ASSERT_EQUAL("expired", true, reactor.wait(events, 1000));
+        ASSERT_EQUAL("type", Reactor::EVENT_TIMER, events[0].type);
+        ASSERT_EQUAL("id", id, events[0].value);
+        ASSERT_EQUAL("one shot", false, reactor.wait(events, 20));
+    }
+
+    static void testSignal(void) {
+        Reactor reactor;
+        reactor.addSignal(SIGUSR1);
+        raise(SIGUSR1);
+
+        std::vector<Reactor::Event> events;
+        ASSERT_EQUAL("ready", true, reactor.wait(events, 0));
+        ASSERT_EQUAL("type", Reactor::EVENT_SIGNAL, events[0].type);
+        ASSERT_EQUAL("signal", SIGUSR1, events[0].value);
+    }
+};
@@ -0,0 +1,89 @@
+//
+// test_SnapIndex.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "SnapIndex.hh"
+
+class TestSnapIndex : public TestSuite {
+public:
+    TestSnapIndex()
+        : TestSuite("SnapIndex")
+    {
+        register_test("find", TestSnapIndex::testFind);
+        register_test("findMany", TestSnapIndex::testFindMany);
+    }
+
+    static void testFind(void) {
+        SnapIndex index;
+        index.add(Geometry(0, 0, 100, 100));
+        index.add(Geometry(300, 0, 100, 100));
+        index.add(Geometry(250, 300, 100, 100));
+
+        std::vector<size_t> entries;
+        // right edge of the first entry
+        index.find(Geometry(105, 0, 50, 50), 10, 0, entries);
+        ASSERT_EQUAL("right", 1, entries.size());
+        ASSERT_EQUAL("right", 0, entries[0]);
+
+        // left edge of the second, bottom edge of the first entry
+        index.find(Geometry(200, 105, 95, 50), 10, 0, entries);
+        ASSERT_EQUAL("left/bottom", 2, entries.size());
+        ASSERT_EQUAL("left/bottom", 0, entries[0]);
+        ASSERT_EQUAL("left/bottom", 1, entries[1]);
+
+        // nothing within distance
+        index.find(Geometry(150, 150, 50, 50), 10, 10, entries);
+        ASSERT_EQUAL("none", 0, entries.size());
+
+        index.clear();
+        index.find(Geometry(105, 0, 50, 50), 10, 0, entries);
+        ASSERT_EQUAL("cleared", 0, entries.size());
+    }
+
+    /**
+     * Compare the index with checking all entries.
+     */
+    static void testFindMany(void) {
+        SnapIndex index;
+        std::vector<Geometry> gms;
+        for (uint i = 0; i < 200; i++) {
+            Geometry gm((i * 7919) % 1900, (i * 104729) % 1100,
+                        20 + (i * 31) % 300, 20 + (i * 17) % 200);
+            gms.push_back(gm);
+            index.add(gm);
+        }
+
+        std::vector<size_t> entries;
+        for (int x = -50; x < 2000; x += 37) {
+            for (int y = -50; y < 1200; y += 41) {
+                Geometry gm(x, y, 120, 80);
+                index.find(gm, 10, 5, entries);
+
+                std::vector<size_t> expected;
+                for (size_t i = 0; i < gms.size(); i++) {
+                    if (isClose(gm, gms[i], 10, 5)) {
+                        expected.push_back(i);
+                    }
+                }
+                ASSERT_EQUAL("find", true, expected == entries);
+            }
+        }
+    }
+
+    static bool isClose(const Geometry &gm, const Geometry &o,
+                        int attract, int resist) {
+        int x = gm.x + gm.width;
+        int y = gm.y + gm.height;
+        int rx = o.x + o.width;
+        int by = o.y + o.height;
+        return (x >= o.x - attract && x <= o.x + resist)
+            || (gm.x >= rx - resist && gm.x <= rx + attract)
+            || (y >= o.y - attract && y <= o.y + resist)
+            || (gm.y >= by - resist && gm.y <= by + attract);
+    }
+};
@@ -0,0 +1,158 @@
+//
+// test_StackingList.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "StackingList.hh"
+
+class TestStackingList : public TestSuite {
+public:
+    TestStackingList()
+        : TestSuite("StackingList")
+    {
+        register_test("insert", TestStackingList::testInsert);
+        register_test("findFirst", TestStackingList::testFindFirst);
+        register_test("setLayer", TestStackingList::testSetLayer);
+        register_test("renumber", TestStackingList::testRenumber);
+        register_test("raiseLower", TestStackingList::testRaiseLower);
+    }
+
+    static void testInsert(void) {
+        int o[4];
+        StackingList<int*> list;
+        list.insertBelow(&o[0], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[1], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[2], LAYER_NORMAL, &o[1]);
+        list.insertAbove(&o[3], LAYER_NORMAL, &o[1]);
+        assertOrder("insert", list, {&o[0], &o[2], &o[1], &o[3]});
+
+        ASSERT_EQUAL("above", &o[1], list.getAbove(&o[2]));
+        ASSERT_EQUAL("above top", static_cast<int*>(nullptr),
+                     list.getAbove(&o[3]));
+        ASSERT_EQUAL("below", true, list.isBelow(&o[2], &o[1]));
+        ASSERT_EQUAL("not below", false, list.isBelow(&o[3], &o[0]));
+
+        // re-inserting moves the object
+        list.insertBelow(&o[3], LAYER_NORMAL, &o[0]);
+        assertOrder("move", list, {&o[3], &o[0], &o[2], &o[1]});
+
+        ASSERT_EQUAL("remove", true, list.remove(&o[0]));
+        ASSERT_EQUAL("remove again", false, list.remove(&o[0]));
+        ASSERT_EQUAL("contains", false, list.contains(&o[0]));
+        assertOrder("remove", list, {&o[3], &o[2], &o[1]});
+    }
+
+    static void testFindFirst(void) {
+        int o[4];
+        StackingList<int*> list;
+        list.insertBelow(&o[0], LAYER_BELOW, nullptr);
+        list.insertBelow(&o[1], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[2], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[3], LAYER_ONTOP, nullptr);
+
+        ASSERT_EQUAL("above desktop", &o[0],
+                     list.findFirstAbove(LAYER_DESKTOP));
+        ASSERT_EQUAL("above normal", &o[3], list.findFirstAbove(LAYER_NORMAL));
+        ASSERT_EQUAL("above ontop", static_cast<int*>(nullptr),
+                     list.findFirstAbove(LAYER_ONTOP));
+        ASSERT_EQUAL("from normal", &o[1], list.findFirstFrom(LAYER_NORMAL));
+        ASSERT_EQUAL("from menu", static_cast<int*>(nullptr),
+                     list.findFirstFrom(LAYER_MENU));
+    }
+
+    static void testSetLayer(void) {
+        int o[3];
+        StackingList<int*> list;
+        list.insertBelow(&o[0], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[1], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[2], LAYER_ONTOP, nullptr);
+
+        // position is kept, but found by layer
+        list.setLayer(&o[1], LAYER_ONTOP);
+        assertOrder("order", list, {&o[0], &o[1], &o[2]});
+        ASSERT_EQUAL("above normal", &o[1], list.findFirstAbove(LAYER_NORMAL));
+    }
+
+    static void testRenumber(void) {
+        int o[100];
+        StackingList<int*> list;
+        list.insertBelow(&o[0], LAYER_NORMAL, nullptr);
+        list.insertBelow(&o[1], LAYER_NORMAL, nullptr);
+        // always inserting directly above o[0] halves the gap
+        for (int i = 2; i < 100; i++) {
+            list.insertAbove(&o[i], LAYER_NORMAL, &o[0]);
+        }
+
+        ASSERT_EQUAL("size", 100, list.size());
+        ASSERT_EQUAL("bottom", &o[0], *list.begin());
+        ASSERT_EQUAL("second", &o[99], list.getAbove(&o[0]));
+        ASSERT_EQUAL("top", &o[1], *list.rbegin());
+        int *prev = nullptr;
+        for (auto obj : list) {
+            if (prev) {
+                ASSERT_EQUAL("ordered", true, list.isBelow(prev, obj));
+            }
+            prev = obj;
+        }
+    }
+
+    /**
+     * Raise and lower objects the same way as Workspaces, comparing
+     * with a plain vector.
+     */
+    static void testRaiseLower(void) {
+        const int num = 200;
+        int o[num];
+        Layer layers[num];
+        StackingList<int*> list;
+        std::vector<int*> expected;
+        for (int i = 0; i < num; i++) {
+            layers[i] = static_cast<Layer>(i % 4 ? LAYER_NORMAL : i % 7);
+            list.insertBelow(&o[i], layers[i], list.findFirstAbove(layers[i]));
+            insertVector(expected, layers, o, &o[i], true);
+        }
+        assertOrder("initial", list, expected);
+
+        for (int i = 0; i < 5000; i++) {
+            int *obj = &o[(i * 7919) % num];
+            bool raise = i % 3;
+            Layer layer = layers[obj - o];
+            list.remove(obj);
+            int *top = raise ? list.findFirstAbove(layer)
+                             : list.findFirstFrom(layer);
+            list.insertBelow(obj, layer, top);
+            insertVector(expected, layers, o, obj, raise);
+        }
+        assertOrder("raise/lower", list, expected);
+    }
+
+    static void insertVector(std::vector<int*> &v, Layer *layers, int *o,
+                             int *obj, bool raise) {
+        auto it = std::find(v.begin(), v.end(), obj);
+        if (it != v.end()) {
+            v.erase(it);
+        }
+        Layer layer = layers[obj - o];
+        for (it = v.begin(); it != v.end(); ++it) {
+            Layer it_layer = layers[*it - o];
+            if (raise ? it_layer > layer : it_layer >= layer) {
+                break;
+            }
+        }
+        v.insert(it, obj);
+    }
+
+    static void assertOrder(const std::string &msg,
+                            const StackingList<int*> &list,
+                            const std::vector<int*> &expected) {
+        ASSERT_EQUAL(msg + " size", expected.size(), list.size());
+        auto it = list.begin();
+        for (size_t i = 0; i < expected.size(); i++, ++it) {
+            ASSERT_EQUAL(msg + " " + std::to_string(i), expected[i], *it);
+        }
+    }
+};
@@ -0,0 +1,34 @@
+//
+// test_TextureHandler.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "TextureHandler.hh"
+
+class TestTextureHandler : public TestSuite {
+public:
+    TestTextureHandler()
+        : TestSuite("TextureHandler")
+    {
+        register_test("normalizeName", TestTextureHandler::testNormalizeName);
+    }
+
+    static void testNormalizeName(void) {
+        ASSERT_EQUAL("empty", "", TextureHandler::normalizeName(" \t"));
+        ASSERT_EQUAL("type", "EMPTY", TextureHandler::normalizeName("Empty"));
+        ASSERT_EQUAL("solid", "SOLID #aabbcc 10x10",
+                     TextureHandler::normalizeName(" Solid  #AABBCC\t10x10 "));
+        ASSERT_EQUAL("same", TextureHandler::normalizeName("solid #aabbcc"),
+                     TextureHandler::normalizeName("SOLID  #AABBCC"));
+
+        // image file names are case sensitive and can contain spaces
+        ASSERT_EQUAL("image", "IMAGE My Image.png#Scaled",
+                     TextureHandler::normalizeName("image  My Image.png#Scaled "));
+        ASSERT_EQUAL("mapped", "IMAGEMAPPED Map Image.png",
+                     TextureHandler::normalizeName("ImageMapped Map Image.png"));
+    }
+};
@@ -45,6 +45,7 @@ public:
         : TestSuite("Util")
     {
         register_test("splitString", TestUtil::testSplitString);
+        register_test("timeDiff", TestUtil::testTimeDiff);
     }
 
     static void testSplitString(void) {
@@ -54,6 +55,14 @@ public:
                           "1,2,3", ",");
     }
 
+    static void testTimeDiff(void) {
+        struct timespec t1 = {10, 500000000};
+        struct timespec t2 = {9, 750000000};
+        ASSERT_EQUAL("ms", 750, Util::timeDiffMs(t1, t2));
+        ASSERT_EQUAL("us", 750000, Util::timeDiffUs(t1, t2));
+        ASSERT_EQUAL("negative ms", -750, Util::timeDiffMs(t2, t1));
+    }
+
     static void assertSplitString(std::string msg,
                                   uint e_ret, std::vector<std::string> e_toks,
                                   const std::string str, const char *sep,
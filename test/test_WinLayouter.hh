@@ -0,0 +1,159 @@
+//
+// test_WinLayouter.hh for pekwm
+// Copyright (C) 2021 Claes Nästén <pekdon@gmail.com>
+//
+// This program is licensed under the GNU GPL.
+// See the LICENSE file for more information.
+//
+
+#include "test.hh"
+#include "WinLayouter.hh"
+
+class TestSmartPlacement : public TestSuite {
+public:
+    TestSmartPlacement()
+        : TestSuite("SmartPlacement")
+    {
+        register_test("place", TestSmartPlacement::testPlace);
+        register_test("placeScan", TestSmartPlacement::testPlaceScan);
+    }
+
+    static void testPlace(void) {
+        Geometry head(0, 0, 1000, 800);
+        SmartPlacement row(head, true, true, true, 0, 0);
+        row.addObstacle(Geometry(0, 0, 400, 300));
+        row.addObstacle(Geometry(400, 0, 400, 100));
+
+        int x, y;
+        ASSERT_EQUAL("row", true, row.place(200, 200, x, y));
+        ASSERT_EQUAL("row x", 800, x);
+        ASSERT_EQUAL("row y", 0, y);
+        ASSERT_EQUAL("row wide", true, row.place(300, 200, x, y));
+        ASSERT_EQUAL("row wide x", 400, x);
+        ASSERT_EQUAL("row wide y", 100, y);
+        ASSERT_EQUAL("row too big", false, row.place(1000, 600, x, y));
+
+        SmartPlacement col(head, false, true, true, 0, 0);
+        col.addObstacle(Geometry(0, 0, 400, 300));
+        col.addObstacle(Geometry(400, 0, 400, 100));
+        ASSERT_EQUAL("col", true, col.place(200, 200, x, y));
+        ASSERT_EQUAL("col x", 0, x);
+        ASSERT_EQUAL("col y", 300, y);
+
+        SmartPlacement offset(head, true, false, false, 10, 20);
+        ASSERT_EQUAL("offset", true, offset.place(200, 200, x, y));
+        ASSERT_EQUAL("offset x", 1000 - 210 - 10, x);
+        ASSERT_EQUAL("offset y", 800 - 220 - 20, y);
+    }
+
+    /**
+     * Compare with checking every row, the way placement used to be
+     * done, for all directions.
+     */
+    static void testPlaceScan(void) {
+        Geometry head(10, 20, 640, 480);
+        std::vector<Geometry> gms;
+        for (uint i = 0; i < 12; i++) {
+            gms.push_back(Geometry(10 + (i * 7919) % 600,
+                                   20 + (i * 104729) % 440,
+                                   30 + (i * 31) % 200,
+                                   30 + (i * 17) % 150));
+        }
+
+        for (int opts = 0; opts < 8; opts++) {
+            bool row = opts & 1;
+            bool ltr = opts & 2;
+            bool ttb = opts & 4;
+            for (int offset = 0; offset < 20; offset += 7) {
+                SmartPlacement placement(head, row, ltr, ttb,
+                                         offset, offset / 2);
+                for (auto &gm : gms) {
+                    placement.addObstacle(gm);
+                }
+
+                for (uint size = 20; size < 400; size += 23) {
+                    int x = 0, y = 0, s_x = 0, s_y = 0;
+                    bool placed =
+                        placement.place(size, size / 2 + 10, x, y);
+                    bool s_placed =
+                        placeScan(head, gms, row, ltr, ttb, offset,
+                                  offset / 2, size, size / 2 + 10,
+                                  s_x, s_y);
+                    std::string msg = "opts " + std::to_string(opts)
+                        + " offset " + std::to_string(offset)
+                        + " size " + std::to_string(size);
+                    ASSERT_EQUAL(msg, s_placed, placed);
+                    ASSERT_EQUAL(msg + " x", s_x, x);
+                    ASSERT_EQUAL(msg + " y", s_y, y);
+                }
+            }
+        }
+    }
+
+    static const Geometry *findObstacle(const std::vector<Geometry> &gms,
+                                        int x, int y,
+                                        uint width, uint height) {
+        for (auto &gm : gms) {
+            if ((gm.x < signed(x + width))
+                && (signed(gm.x + gm.width) > x)
+                && (gm.y < signed(y + height))
+                && (signed(gm.y + gm.height) > y)) {
+                return &gm;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool placeScan(const Geometry &head,
+                          const std::vector<Geometry> &gms,
+                          bool row, bool ltr, bool ttb,
+                          int off_x, int off_y, uint width, uint height,
+                          int &x, int &y) {
+        int step_x = ltr ? 1 : -1;
+        int step_y = ttb ? 1 : -1;
+        int offset_x = ltr ? off_x : -off_x;
+        int offset_y = ttb ? off_y : -off_y;
+        uint wo_width = width + off_x;
+        uint wo_height = height + off_y;
+        int start_x = ltr ? head.x : head.x + head.width - wo_width;
+        int start_y = ttb ? head.y : head.y + head.height - wo_height;
+
+        const Geometry *gm;
+        if (row) {
+            for (int test_y = start_y;
+                 ttb ? test_y + wo_height <= head.y + head.height
+                     : test_y >= head.y;
+                 test_y += step_y) {
+                int test_x = start_x;
+                while (ltr ? test_x + wo_width <= head.x + head.width
+                           : test_x >= head.x) {
+                    gm = findObstacle(gms, test_x, test_y, width, height);
+                    if (! gm) {
+                        x = test_x + offset_x;
+                        y = test_y + offset_y;
+                        return true;
+                    }
+                    test_x = ltr ? gm->x + gm->width : gm->x - wo_width;
+                }
+            }
+        } else {
+            for (int test_x = start_x;
+                 ltr ? test_x + wo_width <= head.x + head.width
+                     : test_x >= head.x;
+                 test_x += step_x) {
+                int test_y = start_y;
+                while (ttb ? test_y + wo_height <= head.y + head.height
+                           : test_y >= head.y) {
+                    gm = findObstacle(gms, test_x, test_y, width, height);
+                    if (! gm) {
+                        x = test_x + offset_x;
+                        y = test_y + offset_y;
+                        return true;
+                    }
+                    test_y = ttb ? gm->y + gm->height : gm->y - wo_height;
+                }
+            }
+        }
+        return false;
+    }
+};
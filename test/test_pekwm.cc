@@ -12,11 +12,21 @@
 
 #include "test_Action.hh"
 #include "test_CfgParser.hh"
+#include "test_CfgParserCache.hh"
 #include "test_Config.hh"
 #include "test_Frame.hh"
+#include "test_ImageDiskCache.hh"
+#include "test_ImageHandler.hh"
 #include "test_ManagerWindows.hh"
+#include "test_PFont.hh"
+#include "test_PImage.hh"
+#include "test_Reactor.hh"
+#include "test_SnapIndex.hh"
+#include "test_StackingList.hh"
+#include "test_TextureHandler.hh"
 #include "test_Theme.hh"
 #include "test_Util.hh"
+#include "test_WinLayouter.hh"
 #include "test_WindowManager.hh"
 #include "test_x11.hh"
 
@@ -36,15 +46,42 @@ main(int argc, char *argv[])
     // CfgParser
     TestCfgParser testCfgParser;
 
+    // CfgParserCache
+    TestCfgParserCache testCfgParserCache;
+
     // Config
     TestConfig testConfig;
 
     // Frame
     TestFrame testFrame;
 
+    // ImageDiskCache
+    TestImageDiskCache testImageDiskCache;
+
+    // ImageHandler
+    TestImageHandler testImageHandler;
+
     // ManagerWindows
     TestRootWO testRootWO(&hint_wo, &cfg);
 
+    // PFont
+    TestPFont testPFont;
+
+    // PImage
+    TestPImage testPImage;
+
+    // Reactor
+    TestReactor testReactor;
+
+    // SnapIndex
+    TestSnapIndex testSnapIndex;
+
+    // StackingList
+    TestStackingList testStackingList;
+
+    // TextureHandler
+    TestTextureHandler testTextureHandler;
+
     // Theme
     TestTheme testTheme;
 
@@ -52,11 +89,15 @@ main(int argc, char *argv[])
     TestString testString;
     TestUtil testUtil;
 
+    // WinLayouter
+    TestSmartPlacement testSmartPlacement;
+
     // WindowManager
     TestWindowManager testWindowManager;
 
     // x11
     TestX11 testX11;
+    TestEventBatch testEventBatch;
 
     TestSuite::main(argc, argv);
 }
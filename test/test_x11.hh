@@ -20,6 +20,7 @@ public:
     {
         register_test("parseGeometry", TestX11::testParseGeometry);
         register_test("parseGeometryVal", TestX11::testParseGeometryVal);
+        register_test("setTrueColorPixel", TestX11::testSetTrueColorPixel);
     }
 
     static void testParseGeometry(void) {
@@ -72,4 +73,196 @@ public:
         ASSERT_EQUAL(msg + " ret", e_ret, ret);
         ASSERT_EQUAL(msg + " val", e_val, val);
     }
+
+    static void testSetTrueColorPixel(void) {
+        Visual visual;
+        visual.c_class = TrueColor;
+        visual.red_mask = 0xff0000;
+        visual.green_mask = 0x00ff00;
+        visual.blue_mask = 0x0000ff;
+
+        XColor xc;
+        xc.red = 0x1234;
+        xc.green = 0xff00;
+        xc.blue = 0x00ff;
+        ASSERT_EQUAL("rgb888", true, setTrueColorPixel(xc, &visual));
+        ASSERT_EQUAL("rgb888", 0x12fe01, xc.pixel);
+        ASSERT_EQUAL("rgb888 red", 0x1212, xc.red);
+        ASSERT_EQUAL("rgb888 green", 0xfefe, xc.green);
+        ASSERT_EQUAL("rgb888 blue", 0x0101, xc.blue);
+
+        visual.red_mask = 0xf800;
+        visual.green_mask = 0x07e0;
+        visual.blue_mask = 0x001f;
+        xc.red = 0xffff;
+        xc.green = 0x8000;
+        xc.blue = 0x0800;
+        ASSERT_EQUAL("rgb565", true, setTrueColorPixel(xc, &visual));
+        ASSERT_EQUAL("rgb565", 0xfc01, xc.pixel);
+
+        visual.c_class = PseudoColor;
+        ASSERT_EQUAL("pseudo", false, setTrueColorPixel(xc, &visual));
+    }
 };
+
+class TestEventBatch : public TestSuite {
+public:
+    TestEventBatch()
+        : TestSuite("EventBatch")
+    {
+        register_test("coalesceMotion", TestEventBatch::testCoalesceMotion);
+        register_test("coalesceExpose", TestEventBatch::testCoalesceExpose);
+        register_test("coalesceConfigure",
+                      TestEventBatch::testCoalesceConfigure);
+        register_test("coalesceProperty",
+                      TestEventBatch::testCoalesceProperty);
+        register_test("checkTypedEvent", TestEventBatch::testCheckTypedEvent);
+    }
+
+    static void testCoalesceMotion(void) {
+        EventBatch batch;
+        batch.push(motion(1, 10));
+        batch.push(motion(1, 20));
+        batch.push(motion(2, 30));
+        batch.push(button(1, ButtonRelease));
+        batch.push(motion(1, 40));
+        batch.push(motion(1, 50));
+        ASSERT_EQUAL("size", 4, batch.size());
+
+        XEvent ev;
+        assertPop("motion 1", batch, MotionNotify, 1);
+        ASSERT_EQUAL("motion 1 x", 20, ev_last.xmotion.x);
+        assertPop("motion 2", batch, MotionNotify, 2);
+        assertPop("release", batch, ButtonRelease, 1);
+        assertPop("motion 1 after release", batch, MotionNotify, 1);
+        ASSERT_EQUAL("motion 1 x", 50, ev_last.xmotion.x);
+        ASSERT_EQUAL("empty", false, batch.pop(ev));
+        ASSERT_EQUAL("coalesced", 2, batch.getStats().motion);
+    }
+
+    static void testCoalesceExpose(void) {
+        EventBatch batch;
+        batch.push(expose(1, 10, 10, 10, 10));
+        batch.push(expose(1, 0, 15, 5, 20));
+        ASSERT_EQUAL("size", 1, batch.size());
+
+        assertPop("expose", batch, Expose, 1);
+        ASSERT_EQUAL("x", 0, ev_last.xexpose.x);
+        ASSERT_EQUAL("y", 10, ev_last.xexpose.y);
+        ASSERT_EQUAL("width", 20, ev_last.xexpose.width);
+        ASSERT_EQUAL("height", 25, ev_last.xexpose.height);
+    }
+
+    static void testCoalesceConfigure(void) {
+        EventBatch batch;
+        XEvent ev = configure(1, CWX | CWWidth, 10, 100);
+        batch.push(ev);
+        ev = configure(1, CWWidth, 0, 200);
+        batch.push(ev);
+        ASSERT_EQUAL("size", 1, batch.size());
+
+        assertPop("configure", batch, ConfigureRequest, 1);
+        ASSERT_EQUAL("mask", CWX | CWWidth,
+                     ev_last.xconfigurerequest.value_mask);
+        ASSERT_EQUAL("x", 10, ev_last.xconfigurerequest.x);
+        ASSERT_EQUAL("width", 200, ev_last.xconfigurerequest.width);
+    }
+
+    static void testCoalesceProperty(void) {
+        EventBatch batch;
+        batch.push(property(1, 100));
+        batch.push(property(1, 101));
+        batch.push(property(2, 100));
+        batch.push(property(1, 100));
+        ASSERT_EQUAL("size", 3, batch.size());
+
+        // other event for the window prevents coalescing
+        batch.push(configure(1, CWX, 0, 0));
+        batch.push(property(1, 100));
+        ASSERT_EQUAL("size barrier", 5, batch.size());
+
+        assertPop("property 1 101", batch, PropertyNotify, 1);
+        ASSERT_EQUAL("atom", 101, ev_last.xproperty.atom);
+        assertPop("property 2 100", batch, PropertyNotify, 2);
+        assertPop("property 1 100", batch, PropertyNotify, 1);
+        ASSERT_EQUAL("atom", 100, ev_last.xproperty.atom);
+    }
+
+    static void testCheckTypedEvent(void) {
+        EventBatch batch;
+        batch.push(motion(1, 10));
+        batch.push(button(1, ButtonRelease));
+        batch.push(motion(2, 10));
+
+        XEvent ev;
+        ASSERT_EQUAL("check", true,
+                     batch.checkMaskEvent(ButtonReleaseMask, ev));
+        ASSERT_EQUAL("check type", ButtonRelease, ev.type);
+        ASSERT_EQUAL("removed", 2, batch.size());
+        ASSERT_EQUAL("remove motion", 2,
+                     batch.removeTypedEvents(MotionNotify));
+        ASSERT_EQUAL("empty", true, batch.size() == 0);
+
+        batch.putBack(ev);
+        ASSERT_EQUAL("put back", 1, batch.size());
+        assertPop("put back", batch, ButtonRelease, 1);
+        ASSERT_EQUAL("popped", 0, batch.size());
+    }
+
+private:
+    static void assertPop(const std::string &msg, EventBatch &batch,
+                          int type, Window win) {
+        ASSERT_EQUAL(msg + " pop", true, batch.pop(ev_last));
+        ASSERT_EQUAL(msg + " type", type, ev_last.type);
+        ASSERT_EQUAL(msg + " window", win,
+                     EventBatch::getEventWindow(ev_last));
+    }
+
+    static XEvent motion(Window win, int x) {
+        XEvent ev = {0};
+        ev.xmotion.type = MotionNotify;
+        ev.xmotion.window = win;
+        ev.xmotion.x = x;
+        return ev;
+    }
+
+    static XEvent button(Window win, int type) {
+        XEvent ev = {0};
+        ev.xbutton.type = type;
+        ev.xbutton.window = win;
+        return ev;
+    }
+
+    static XEvent expose(Window win, int x, int y, int width, int height) {
+        XEvent ev = {0};
+        ev.xexpose.type = Expose;
+        ev.xexpose.window = win;
+        ev.xexpose.x = x;
+        ev.xexpose.y = y;
+        ev.xexpose.width = width;
+        ev.xexpose.height = height;
+        return ev;
+    }
+
+    static XEvent configure(Window win, ulong mask, int x, int width) {
+        XEvent ev = {0};
+        ev.xconfigurerequest.type = ConfigureRequest;
+        ev.xconfigurerequest.window = win;
+        ev.xconfigurerequest.value_mask = mask;
+        ev.xconfigurerequest.x = x;
+        ev.xconfigurerequest.width = width;
+        return ev;
+    }
+
+    static XEvent property(Window win, Atom atom) {
+        XEvent ev = {0};
+        ev.xproperty.type = PropertyNotify;
+        ev.xproperty.window = win;
+        ev.xproperty.atom = atom;
+        return ev;
+    }
+
+    static XEvent ev_last;
+};
+
+XEvent TestEventBatch::ev_last;